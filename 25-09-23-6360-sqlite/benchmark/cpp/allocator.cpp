@@ -0,0 +1,403 @@
+#include "shared.hpp"
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+int measure(
+    sqlite3 *db,
+    Config &config,
+    std::mt19937 &rng,
+    const std::function<int(sqlite3 *, const Entry &, uint64_t, const std::string &)> &f,
+    const std::string &report_name,
+    const int create_entry, // Percentage probability of creating a new entry
+    const std::vector<Entry> &entries)
+{
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    uint64_t next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_warmup; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[i % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (f(db, entry, i, "Warmup") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    std::vector<uint64_t> times;
+    next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_repetitions; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()];
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        if (f(db, entry, i, "Actual") != 0)
+            return -1;
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    report_stats(config, times, report_name);
+
+    return 0;
+}
+
+int measure_select(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string sql = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare select statement"))
+        return -1;
+
+    auto select_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_text(stmt, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt), db, prefix + " query execution " + std::to_string(i)))
+            return -1;
+        if (!assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt, 0), prefix + " ID check"))
+            return -1;
+        sqlite3_reset(stmt);
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, select_inner, report_name, -1, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt);
+
+    return 0;
+}
+
+int measure_xor1(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string
+        sql_select = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_insert = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);";
+    sqlite3_stmt *stmt_select, *stmt_insert;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor select statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert.c_str(), -1, &stmt_insert, nullptr), db, "Prepare xor insert statement"))
+        return -1;
+
+    auto xor_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_select, 2, entry.size);
+        auto rc = sqlite3_step(stmt_select);
+        if (!assert_sqlite_return_code(rc, db, prefix + " xor1 query execution " + std::to_string(i)))
+            return -1;
+        auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_select, 0) : -1;
+        sqlite3_reset(stmt_select);
+
+        if (found_id == -1)
+        {
+            // Not found, insert
+            sqlite3_bind_int64(stmt_insert, 1, entry.id);
+            sqlite3_bind_text(stmt_insert, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_insert, 3, entry.size);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_insert), db, prefix + " xor1 insert " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_insert);
+        }
+        else
+        {
+            if (!assert_value_matches(entry.id, (uint64_t)found_id, prefix + " xor1 ID check"))
+                return -1;
+        }
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, xor_inner, report_name, 50, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt_select);
+    sqlite3_finalize(stmt_insert);
+
+    return 0;
+}
+
+sqlite3 *open_connection(const Config &config)
+{
+    sqlite3 *db;
+    if (!assert_sqlite_return_code(sqlite3_open(DBPATH.c_str(), &db), db, "Open connection"))
+        return nullptr;
+    if (!configure_lookaside(db, config.lookaside))
+        return nullptr;
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "PRAGMA cache_size = -64000;", nullptr, nullptr, nullptr), db, "Set cache_size"))
+        return nullptr;
+    if (!apply_file_controls(db, config))
+        return nullptr;
+    return db;
+}
+
+// Runs the select workload on num_threads connections at once, and returns the time from the common start until the last thread is done.
+// The connections are opened before the start, so only the queries are timed.
+int measure_scaling(Config &config, const std::vector<Entry> &entries, uint64_t num_threads, uint64_t &time_us)
+{
+    std::barrier start(num_threads + 1), done(num_threads + 1);
+    std::vector<std::thread> threads;
+    std::vector<int> return_codes(num_threads, 0);
+    uint64_t runs = config.num_repetitions / num_threads;
+
+    for (uint64_t tid = 0; tid < num_threads; tid++)
+    {
+        threads.emplace_back([&, tid]()
+                             {
+            std::mt19937 rng(~2025'07'08 + tid);
+            sqlite3 *db = open_connection(config);
+            sqlite3_stmt *stmt = nullptr;
+            if (db == nullptr || !assert_sqlite_return_code(sqlite3_prepare_v2(db, "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;", -1, &stmt, nullptr), db, "Prepare scaling select"))
+                return_codes[tid] = -1;
+            start.arrive_and_wait();
+
+            for (uint64_t i = 0; i < runs && return_codes[tid] == 0; i++)
+            {
+                auto &entry = entries[rng() % entries.size()];
+                sqlite3_bind_text(stmt, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+                sqlite3_bind_int64(stmt, 2, entry.size);
+                int rc;
+                do
+                {
+                    rc = sqlite3_step(stmt);
+                } while (rc == SQLITE_BUSY);
+                if (!assert_sqlite_return_code(rc, db, "Scaling select " + std::to_string(i)) ||
+                    !assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt, 0), "Scaling select ID check"))
+                    return_codes[tid] = -1;
+                sqlite3_reset(stmt);
+            }
+
+            done.arrive_and_wait();
+            sqlite3_finalize(stmt);
+            sqlite3_close(db); });
+    }
+
+    start.arrive_and_wait();
+    auto begin = std::chrono::high_resolution_clock::now();
+    done.arrive_and_wait();
+    auto end = std::chrono::high_resolution_clock::now();
+    for (auto &thread : threads)
+        thread.join();
+
+    time_us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    for (auto return_code : return_codes)
+        if (return_code != 0)
+            return -1;
+
+    return 0;
+}
+
+int report_scaling(Config &config, const std::string &setting, uint64_t num_threads, uint64_t time_us)
+{
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    std::string path = "reports/allocator_scaling.csv";
+    bool emit_header = !std::filesystem::exists(path);
+    std::ofstream report_file(path, std::ios::app);
+    if (emit_header)
+        report_file << "num_entries,num_warmup,num_repetitions,setting,num_threads,time_us,kop_s" << std::endl;
+
+    uint64_t rows = config.num_repetitions / num_threads * num_threads;
+    report_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << setting << ","
+                << num_threads << ","
+                << time_us << ","
+                << (double)rows / time_us * 1000
+                << std::endl;
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    // Each setting is an allocator, whether memory statistics are kept, and the lookaside buffer of every connection
+    std::vector<std::tuple<std::string, bool>> allocators = {
+        {"default", true},
+        {"default", false},
+        {"pool", true},
+        {"pool", false}};
+    std::vector<std::string> lookasides = {"default", "off", "64x256", "128x512", "512x128", "1200x500"};
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    auto db = setup_database(table_queries, config);
+
+    sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetBlocksetID ON Blockset(ID);", nullptr, nullptr, nullptr);
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(db, rng, entries, config.num_entries) != 0)
+        return -1;
+    sqlite3_close(db);
+
+    for (auto &[allocator, memstatus] : allocators)
+    {
+        // The allocator and memory statistics can only be changed while SQLite is shut down
+        sqlite3_shutdown();
+        config.allocator = allocator;
+        config.memstatus = memstatus;
+        if (!configure_memory(config) || sqlite3_initialize() != SQLITE_OK || !slow_vfs::install())
+            return -1;
+
+        for (auto &lookaside : lookasides)
+        {
+            config.lookaside = lookaside;
+            std::string setting = allocator + (memstatus ? "_memstatus_on" : "_memstatus_off") + "_lookaside_" + lookaside;
+
+            db = open_connection(config);
+            if (db == nullptr)
+                return -1;
+            rng.seed(~2025'07'08);
+            if (measure_select(db, config, rng, entries, "allocator_select_" + setting) != 0)
+                return -1;
+            if (measure_xor1(db, config, rng, entries, "allocator_xor1_" + setting) != 0)
+                return -1;
+            sqlite3_close(db);
+
+            for (uint64_t num_threads = 1; num_threads <= config.num_threads; num_threads *= 2)
+            {
+                uint64_t time_us;
+                if (measure_scaling(config, entries, num_threads, time_us) != 0)
+                    return -1;
+                report_scaling(config, setting, num_threads, time_us);
+            }
+        }
+    }
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
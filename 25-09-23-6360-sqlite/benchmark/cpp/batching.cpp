@@ -1,4 +1,5 @@
 #include "shared.hpp"
+#include "uring_vfs.hpp"
 
 const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
 
@@ -10,11 +11,148 @@ struct Entry
     uint64_t blockset_id;
 };
 
+// VFS used by the benchmark connections, nullptr for the default one
+const char *connection_vfs = nullptr;
+
+// Chunk size and size hints for the benchmark connections, from the command line
+Config connection_file_config;
+
+// Commit latencies of the insert workload, and the time of the checkpoint it runs before closing
+std::vector<uint64_t> commit_times;
+uint64_t checkpoint_time_us = 0;
+int checkpoint_frames = 0;
+
+const uint64_t
+    ADAPTIVE_WINDOW = 4,             // Least commits the throughput of a decision is measured over
+    ADAPTIVE_WINDOW_NS = 20'000'000, // Least time the throughput of a decision is measured over
+    ADAPTIVE_HISTORY = 100,          // Latest commits, across batch sizes, the p99 latency is taken over once there are that many
+    ADAPTIVE_HOLD = 4,               // Windows the controller keeps the batch size after backing off
+    ADAPTIVE_MAX_BATCH = 65536;
+
+// Decides when the workloads commit. static commits every --num-batch operations (never when 0), time commits every
+// --commit-interval-ms, and adaptive hill climbs the batch size: it doubles the batch while throughput improves, and halves
+// it when throughput drops, a commit hits SQLITE_BUSY, or the p99 latency of the last ADAPTIVE_HISTORY commits exceeds
+// --commit-target-us.
+struct CommitPolicy
+{
+    std::string policy = "static";
+    uint64_t batch = 0, interval_ns = 0, target_ns = 0;
+    uint64_t pending = 0;              // Operations since the last commit
+    std::vector<uint64_t> latencies;   // Of every commit, in ns
+    std::vector<uint64_t> batch_trace; // Batch size after each adaptive decision
+    std::chrono::high_resolution_clock::time_point last_commit;
+
+    // State of the adaptive controller
+    uint64_t window_ops = 0, window_commits = 0, busy = 0, hold = 0;
+    double last_throughput = 0;
+    bool grew = false;
+    std::chrono::high_resolution_clock::time_point window_begin;
+
+    void reset(Config &config)
+    {
+        policy = config.batch_policy;
+        batch = policy == "adaptive" ? 1 : policy == "static" ? config.num_batch : 0;
+        interval_ns = config.commit_interval_ms * 1'000'000;
+        target_ns = config.commit_target_us * 1000;
+        pending = window_ops = window_commits = busy = hold = 0;
+        last_throughput = 0;
+        grew = false;
+        latencies.clear();
+        batch_trace.clear();
+        last_commit = window_begin = std::chrono::high_resolution_clock::now();
+    }
+
+    // Counts an operation, and returns whether the transaction should be committed after it
+    bool operation_done()
+    {
+        pending++;
+        if (policy == "time")
+            return std::chrono::high_resolution_clock::now() - last_commit >= std::chrono::nanoseconds(interval_ns);
+        return batch > 0 && pending >= batch;
+    }
+
+    // Commits the open transaction, timing the commit
+    void finish(sqlite3 *db)
+    {
+        auto commit_begin = std::chrono::high_resolution_clock::now();
+        while (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_BUSY)
+            busy++;
+        last_commit = std::chrono::high_resolution_clock::now();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(last_commit - commit_begin).count());
+        window_ops += pending;
+        window_commits++;
+        pending = 0;
+    }
+
+    // Commits the open transaction and starts the next one
+    void commit(sqlite3 *db)
+    {
+        finish(db);
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        if (policy == "adaptive" && window_commits >= ADAPTIVE_WINDOW && last_commit - window_begin >= std::chrono::nanoseconds(ADAPTIVE_WINDOW_NS))
+            adapt();
+    }
+
+    void adapt()
+    {
+        // With fewer commits, the p99 would be the slowest one, such as a single commit running the autocheckpoint
+        bool over_target = false;
+        if (latencies.size() >= ADAPTIVE_HISTORY)
+        {
+            std::vector<uint64_t> history(latencies.end() - ADAPTIVE_HISTORY, latencies.end());
+            auto p99 = history.begin() + (ADAPTIVE_HISTORY * 99 + 99) / 100 - 1;
+            std::nth_element(history.begin(), p99, history.end());
+            over_target = *p99 > target_ns;
+        }
+        double throughput = window_ops / std::chrono::duration<double>(last_commit - window_begin).count();
+
+        // The history still holds commits from before a back off, so the latency is not acted on again until the hold ends
+        if (busy > 0 || (over_target && hold == 0))
+        {
+            batch = std::max<uint64_t>(1, batch / 2);
+            hold = ADAPTIVE_HOLD;
+            grew = false;
+        }
+        else if (grew && throughput <= last_throughput)
+        {
+            // The last doubling did not pay off, so go back and stay there for a while
+            batch = std::max<uint64_t>(1, batch / 2);
+            hold = ADAPTIVE_HOLD;
+            grew = false;
+        }
+        else if (hold > 0)
+        {
+            hold--;
+            grew = false;
+        }
+        else
+        {
+            grew = batch < ADAPTIVE_MAX_BATCH;
+            batch = std::min(ADAPTIVE_MAX_BATCH, batch * 2);
+        }
+
+        batch_trace.push_back(batch);
+        last_throughput = throughput;
+        window_ops = window_commits = busy = 0;
+        window_begin = std::chrono::high_resolution_clock::now();
+    }
+};
+
+CommitPolicy commit_policy;
+
+// Result of the last measured run, for comparing the policies
+struct RunResult
+{
+    double kop_s;
+    double p99_commit_us;
+};
+RunResult last_run;
+
 sqlite3 *open_connection(const std::vector<std::string> &pragmas)
 {
     sqlite3 *db;
     // sqlite3_open_v2(DBPATH.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
-    sqlite3_open(DBPATH.c_str(), &db);
+    sqlite3_open_v2(DBPATH.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, connection_vfs);
 
     // Read the current timeout
     if (!assert_sqlite_return_code(sqlite3_exec(db, "PRAGMA busy_timeout;", nullptr, nullptr, nullptr), db, "Get busy_timeout"))
@@ -31,6 +169,9 @@ sqlite3 *open_connection(const std::vector<std::string> &pragmas)
             return nullptr;
     }
 
+    if (!apply_file_controls(db, connection_file_config))
+        return nullptr;
+
     // Reset timeout
     std::string busy_timeout_sql = "PRAGMA busy_timeout = " + std::to_string(busy_timeout) + ";";
     if (!assert_sqlite_return_code(sqlite3_exec(db, busy_timeout_sql.c_str(), nullptr, nullptr, nullptr), db, "Reset busy_timeout"))
@@ -174,16 +315,27 @@ void measure_insert(int tid, uint64_t runs, std::vector<std::string> &pragmas, C
         }
         sqlite3_reset(stmt);
 
-        if (config.num_batch > 0 && (i + 1) % config.num_batch == 0)
+        if (commit_policy.operation_done())
         {
-            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-            sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+            commit_policy.commit(db);
+            commit_times.push_back(commit_policy.latencies.back());
         }
     }
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    commit_policy.finish(db);
+    commit_times.push_back(commit_policy.latencies.back());
 
     sqlite3_finalize(stmt);
 
+    // Checkpoint explicitly, as the one SQLite runs when the connection closes cannot be timed on its own
+    auto checkpoint_begin = std::chrono::high_resolution_clock::now();
+    if (!assert_sqlite_return_code(sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, &checkpoint_frames, nullptr), db, "Checkpoint after insert"))
+    {
+        return_code = -1;
+        return;
+    }
+    auto checkpoint_end = std::chrono::high_resolution_clock::now();
+    checkpoint_time_us = std::chrono::duration_cast<std::chrono::microseconds>(checkpoint_end - checkpoint_begin).count();
+
     sqlite3_close(db);
 
     num_rows = runs; // Number of rows inserted
@@ -255,13 +407,10 @@ void measure_select(int tid, uint64_t runs, std::vector<std::string> &pragmas, C
         }
         sqlite3_reset(stmt);
 
-        if (config.num_batch > 0 && (i + 1) % config.num_batch == 0)
-        {
-            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-            sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
-        }
+        if (commit_policy.operation_done())
+            commit_policy.commit(db);
     }
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    commit_policy.finish(db);
 
     sqlite3_finalize(stmt);
     sqlite3_close(db);
@@ -353,6 +502,7 @@ void measure_xor1(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
                 {
                     // Connection is busy, another statement is inserting, which means the read value is no longer valid
                     sqlite3_reset(stmt_insert);
+                    commit_policy.busy++;
                     if (!assert_sqlite_return_code(sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr), db, "xor1 rollback"))
                     {
                         return_code = -1;
@@ -377,13 +527,10 @@ void measure_xor1(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
             }
         }
 
-        if (config.num_batch > 0 && (i + 1) % config.num_batch == 0)
-        {
-            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-            sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
-        }
+        if (commit_policy.operation_done())
+            commit_policy.commit(db);
     }
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    commit_policy.finish(db);
 
     sqlite3_finalize(stmt_select);
     sqlite3_finalize(stmt_insert);
@@ -461,14 +608,11 @@ void measure_xor2(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
             return;
         }
         sqlite3_reset(stmt_select);
-        if (config.num_batch > 0 && (i + 1) % config.num_batch == 0)
-        {
-            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-            sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
-        }
+        if (commit_policy.operation_done())
+            commit_policy.commit(db);
         num_rows += 2;
     };
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    commit_policy.finish(db);
 
     sqlite3_finalize(stmt_insert);
     sqlite3_finalize(stmt_select);
@@ -478,6 +622,166 @@ void measure_xor2(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
     return;
 }
 
+void measure_xor3(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string
+        sql_insert = "INSERT INTO Block (Hash, Size) VALUES (?, ?) ON CONFLICT (Hash, Size) DO NOTHING RETURNING ID;",
+        sql_select = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt_insert, *stmt_select;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert.c_str(), -1, &stmt_insert, nullptr), db, "Prepare xor3 insert statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor3 select statement"))
+    {
+        return_code = -1;
+        return;
+    }
+
+    sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        Entry entry;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+        sqlite3_bind_text(stmt_insert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_insert, 2, entry.size);
+        int rc;
+        do
+        {
+            rc = sqlite3_step(stmt_insert);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "xor3 insert query execution " + std::to_string(i)))
+        {
+            return_code = -1;
+            return;
+        }
+        auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_insert, 0) : -1;
+        sqlite3_reset(stmt_insert);
+        num_rows++;
+
+        if (found_id == -1)
+        {
+            // Conflict, so the block already exists
+            sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_select, 2, entry.size);
+            do
+            {
+                rc = sqlite3_step(stmt_select);
+            } while (rc == SQLITE_BUSY);
+            if (!assert_sqlite_return_code(rc, db, "xor3 select query execution " + std::to_string(i)))
+            {
+                return_code = -1;
+                return;
+            }
+            found_id = sqlite3_column_int64(stmt_select, 0);
+            sqlite3_reset(stmt_select);
+            if (!assert_value_matches(entry.id, (uint64_t)found_id, "xor3 ID check"))
+            {
+                return_code = -1;
+                return;
+            }
+            num_rows++;
+        }
+        if (commit_policy.operation_done())
+            commit_policy.commit(db);
+    }
+    commit_policy.finish(db);
+
+    sqlite3_finalize(stmt_insert);
+    sqlite3_finalize(stmt_select);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+void measure_xor3_update(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string sql_upsert = "INSERT INTO Block (Hash, Size) VALUES (?, ?) ON CONFLICT (Hash, Size) DO UPDATE SET ID = ID RETURNING ID;";
+    sqlite3_stmt *stmt_upsert;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_upsert.c_str(), -1, &stmt_upsert, nullptr), db, "Prepare xor3 upsert statement"))
+    {
+        return_code = -1;
+        return;
+    }
+
+    sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        Entry entry;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+        sqlite3_bind_text(stmt_upsert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_upsert, 2, entry.size);
+        int rc;
+        do
+        {
+            rc = sqlite3_step(stmt_upsert);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "xor3 upsert query execution " + std::to_string(i)))
+        {
+            return_code = -1;
+            return;
+        }
+        if (!create_new && !assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt_upsert, 0), "xor3 upsert ID check"))
+        {
+            return_code = -1;
+            return;
+        }
+        sqlite3_reset(stmt_upsert);
+        if (commit_policy.operation_done())
+            commit_policy.commit(db);
+        num_rows++;
+    }
+    commit_policy.finish(db);
+
+    sqlite3_finalize(stmt_upsert);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
 uint64_t blockset_count(uint64_t blockset_id, const std::vector<Entry> &entries)
 {
     uint64_t count = 0;
@@ -549,11 +853,8 @@ void measure_join(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
             count++;
         }
         sqlite3_reset(stmt);
-        if (config.num_batch > 0 && (i + 1) % config.num_batch == 0)
-        {
-            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-            sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
-        }
+        if (commit_policy.operation_done())
+            commit_policy.commit(db);
         // TODO this check is for verification
         // if (!assert_value_matches(expected_count, count, "Blockset count check"))
         //{
@@ -565,7 +866,7 @@ void measure_join(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
         if (num_rows > runs)
             break;
     };
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    commit_policy.finish(db);
 
     sqlite3_finalize(stmt);
     sqlite3_close(db);
@@ -653,6 +954,7 @@ void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &prag
                 if (rc == SQLITE_BUSY)
                 {
                     // Statement is busy, the read values could be invalid
+                    commit_policy.busy++;
                     sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
                     continue;
                 }
@@ -753,14 +1055,10 @@ void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &prag
                 return;
             }
         }
-        if (config.num_batch > 0 && (i + 1) % config.num_batch == 0)
-        {
-            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-            sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
-        }
+        if (commit_policy.operation_done())
+            commit_policy.commit(db);
     }
-    if (config.num_batch == 0 || config.num_batch != 0)
-        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    commit_policy.finish(db);
 
     sqlite3_finalize(stmt_start_blockset);
     sqlite3_finalize(stmt_last_row);
@@ -774,14 +1072,14 @@ void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &prag
     return;
 }
 
-int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config &, const std::vector<Entry> &, int &, int &)> f, std::vector<Entry> &entries, Config &config, std::string report_name, std::vector<std::string> &pragmas)
+int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config &, const std::vector<Entry> &, int &, int &)> f, std::vector<Entry> &entries, Config &config, std::string report_name, std::vector<std::string> &pragmas, const std::string &backup = DBPATH + ".backup")
 {
     // Copy the backed up database
-    auto copy_db = []()
+    auto copy_db = [&backup]()
     {
         std::filesystem::remove(DBPATH + "-shm");
         std::filesystem::remove(DBPATH + "-wal");
-        std::filesystem::copy_file(DBPATH + ".backup", DBPATH, std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::copy_file(backup, DBPATH, std::filesystem::copy_options::overwrite_existing);
         sqlite3 *db;
         sqlite3_open(DBPATH.c_str(), &db);
         sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
@@ -794,13 +1092,21 @@ int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config
     int num_rows = 0;
     std::vector<std::thread> threads;
 
+    commit_policy.reset(config);
     f(0, config.num_warmup, pragmas, config, entries, return_code, num_rows);
     if (return_code != 0)
         return -1;
 
     copy_db();
 
+    commit_times.clear();
+    checkpoint_time_us = 0;
     num_rows = 0;
+    uint64_t warmup_batch = commit_policy.batch;
+    commit_policy.reset(config);
+    // The adaptive controller continues from the batch size it reached during the warmup
+    if (config.batch_policy == "adaptive")
+        commit_policy.batch = warmup_batch;
     auto begin = std::chrono::high_resolution_clock::now();
     f(0, config.num_repetitions, pragmas, config, entries, return_code, num_rows);
     auto end = std::chrono::high_resolution_clock::now();
@@ -816,7 +1122,60 @@ int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config
     if (!std::filesystem::exists("reports"))
         std::filesystem::create_directory("reports");
 
-    bool emit_header = !std::filesystem::exists("reports/batching_" + report_name + ".csv");
+    uint64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    std::vector<uint64_t> latencies = commit_policy.latencies;
+    std::sort(latencies.begin(), latencies.end());
+    last_run = {float(num_rows) / (float(time_us) / 1000), latencies[latencies.size() * 99 / 100] / 1000.0};
+
+    std::string policy_name = config.batch_policy == "time"       ? "time_" + std::to_string(config.commit_interval_ms) + "ms"
+                              : config.batch_policy == "adaptive" ? "adaptive"
+                                                                  : "batch_" + std::to_string(config.num_batch);
+
+    // Commit latencies and batch sizes of every policy, next to each other
+    bool emit_header = !std::filesystem::exists("reports/batching_policy_" + report_name + ".csv");
+    std::ofstream policy_file("reports/batching_policy_" + report_name + ".csv", std::ios::app);
+    if (emit_header)
+        policy_file << "num_entries,num_warmup,num_repetitions,policy,num_batch,commit_interval_ms,commit_target_us,rows,commits,ops_per_commit,final_batch,time_us,kop_s,median_commit_us,p99_commit_us,max_commit_us\n";
+    policy_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << config.batch_policy << ","
+                << config.num_batch << ","
+                << config.commit_interval_ms << ","
+                << config.commit_target_us << ","
+                << num_rows << ","
+                << latencies.size() << ","
+                << float(config.num_repetitions) / latencies.size() << ","
+                << commit_policy.batch << ","
+                << time_us << ","
+                << last_run.kop_s << ","
+                << latencies[latencies.size() / 2] / 1000.0 << ","
+                << last_run.p99_commit_us << ","
+                << latencies.back() / 1000.0 << "\n";
+
+    if (config.batch_policy == "adaptive")
+    {
+        emit_header = !std::filesystem::exists("reports/batching_adaptive_" + report_name + ".csv");
+        std::ofstream trace_file("reports/batching_adaptive_" + report_name + ".csv", std::ios::app);
+        if (emit_header)
+            trace_file << "num_entries,num_warmup,num_repetitions,commit_target_us,decision,batch\n";
+        for (size_t i = 0; i < commit_policy.batch_trace.size(); i++)
+            trace_file << config.num_entries << ","
+                       << config.num_warmup << ","
+                       << config.num_repetitions << ","
+                       << config.commit_target_us << ","
+                       << i << ","
+                       << commit_policy.batch_trace[i] << "\n";
+    }
+
+    if (!commit_times.empty())
+        report_stats(config, commit_times, "batching_commit_" + report_name + "_" + policy_name);
+
+    // The remaining reports are keyed on the batch size
+    if (config.batch_policy != "static")
+        return 0;
+
+    emit_header = !std::filesystem::exists("reports/batching_" + report_name + ".csv");
     std::ofstream report_file("reports/batching_" + report_name + ".csv", std::ios::app);
     if (emit_header)
     {
@@ -831,28 +1190,125 @@ int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config
                 << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << ","
                 << float(num_rows) / (float(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / 1000) << "\n";
 
+    if (!commit_times.empty())
+    {
+        bool emit_checkpoint_header = !std::filesystem::exists("reports/batching_checkpoint_" + report_name + ".csv");
+        std::ofstream checkpoint_file("reports/batching_checkpoint_" + report_name + ".csv", std::ios::app);
+        if (emit_checkpoint_header)
+            checkpoint_file << "num_entries,num_warmup,num_repetitions,num_batch,wal_frames,time_us\n";
+        checkpoint_file << config.num_entries << ","
+                        << config.num_warmup << ","
+                        << config.num_repetitions << ","
+                        << config.num_batch << ","
+                        << checkpoint_frames << ","
+                        << checkpoint_time_us << "\n";
+    }
+
+    return 0;
+}
+
+const std::vector<uint64_t> COMPARE_BATCHES = {0, 1, 4, 16, 64, 256, 1024, 4096, 16384, 65536};
+
+// Runs a workload with each static batch size in COMPARE_BATCHES, and then with the time and adaptive policies. The policies are
+// reported against the fastest static batch size that keeps the p99 commit latency under --commit-target-us, or the fastest one
+// if none does.
+int measure_compare(std::function<void(int, uint64_t, std::vector<std::string> &, Config &, const std::vector<Entry> &, int &, int &)> f, std::vector<Entry> &entries, Config &config, std::string report_name, std::vector<std::string> &pragmas, const std::string &backup)
+{
+    Config run_config = config;
+    run_config.batch_policy = "static";
+    RunResult best = {0, 0};
+    uint64_t best_batch = 0;
+    bool best_meets_target = false;
+    for (auto batch : COMPARE_BATCHES)
+    {
+        run_config.num_batch = batch;
+        if (measure(f, entries, run_config, report_name, pragmas, backup) != 0)
+            return -1;
+        bool meets_target = last_run.p99_commit_us <= config.commit_target_us;
+        if ((meets_target && !best_meets_target) || (meets_target == best_meets_target && last_run.kop_s > best.kop_s))
+        {
+            best = last_run;
+            best_batch = batch;
+            best_meets_target = meets_target;
+        }
+    }
+
+    run_config.num_batch = 0;
+    run_config.batch_policy = "time";
+    if (measure(f, entries, run_config, report_name, pragmas, backup) != 0)
+        return -1;
+    RunResult time = last_run;
+
+    run_config.batch_policy = "adaptive";
+    if (measure(f, entries, run_config, report_name, pragmas, backup) != 0)
+        return -1;
+    RunResult adaptive = last_run;
+    uint64_t adaptive_batch = commit_policy.batch;
+
+    std::cout << "Batching " << report_name << ": best static batch " << best_batch << " " << best.kop_s << " kop/s, time "
+              << time.kop_s << " kop/s, adaptive " << adaptive.kop_s << " kop/s ending at batch " << adaptive_batch << std::endl;
+
+    bool emit_header = !std::filesystem::exists("reports/batching_compare.csv");
+    std::ofstream report_file("reports/batching_compare.csv", std::ios::app);
+    if (emit_header)
+        report_file << "num_entries,num_warmup,num_repetitions,workload,commit_interval_ms,commit_target_us,policy,num_batch,kop_s,p99_commit_us,meets_target\n";
+    std::vector<std::tuple<std::string, uint64_t, RunResult>> rows = {
+        {"best_static", best_batch, best},
+        {"time", 0, time},
+        {"adaptive", adaptive_batch, adaptive}};
+    for (auto &[policy, batch, result] : rows)
+        report_file << config.num_entries << ","
+                    << config.num_warmup << ","
+                    << config.num_repetitions << ","
+                    << report_name << ","
+                    << config.commit_interval_ms << ","
+                    << config.commit_target_us << ","
+                    << policy << ","
+                    << batch << ","
+                    << result.kop_s << ","
+                    << result.p99_commit_us << ","
+                    << (result.p99_commit_us <= config.commit_target_us) << "\n";
+
     return 0;
 }
 
 int measure_all(std::vector<Entry> &entries, Config &config, std::string &report_name, std::vector<std::string> &pragmas)
 {
+    // Runs on another VFS are reported separately
+    std::string suffix = config.vfs == "default" ? "" : "_" + config.vfs;
+
+    auto run = [&](auto f, const std::string &name, const std::string &backup)
+    {
+        if (config.batch_policy == "compare")
+            return measure_compare(f, entries, config, name, pragmas, backup);
+        return measure(f, entries, config, name, pragmas, backup);
+    };
+
+    if (run(measure_insert, "insert" + suffix, DBPATH + ".backup") != 0)
+        return -1;
+
+    if (run(measure_select, "select" + suffix, DBPATH + ".backup") != 0)
+        return -1;
 
-    if (measure(measure_insert, entries, config, "insert", pragmas) != 0)
+    if (run(measure_xor1, "xor1" + suffix, DBPATH + ".backup") != 0)
         return -1;
 
-    if (measure(measure_select, entries, config, "select", pragmas) != 0)
+    if (run(measure_xor2, "xor2" + suffix, DBPATH + ".backup") != 0)
         return -1;
 
-    if (measure(measure_xor1, entries, config, "xor1", pragmas) != 0)
+    if (run(measure_insert, "insert_unique" + suffix, DBPATH + ".unique") != 0)
         return -1;
 
-    if (measure(measure_xor2, entries, config, "xor2", pragmas) != 0)
+    if (run(measure_xor3, "xor3" + suffix, DBPATH + ".unique") != 0)
         return -1;
 
-    if (measure(measure_join, entries, config, "join", pragmas) != 0)
+    if (run(measure_xor3_update, "xor3_update" + suffix, DBPATH + ".unique") != 0)
         return -1;
 
-    if (measure(measure_new_blockset, entries, config, "new_blockset", pragmas) != 0)
+    if (run(measure_join, "join" + suffix, DBPATH + ".backup") != 0)
+        return -1;
+
+    if (run(measure_new_blockset, "new_blockset" + suffix, DBPATH + ".backup") != 0)
         return -1;
 
     return 0;
@@ -862,6 +1318,23 @@ int main(int argc, char *argv[])
 {
     auto config = parse_args(argc, argv);
 
+    if (config.vfs != "default")
+    {
+        if (!register_uring_vfs() || sqlite3_vfs_find(config.vfs.c_str()) == nullptr)
+        {
+            std::cerr << "Unable to use VFS: " << config.vfs << std::endl;
+            return -1;
+        }
+        if (!check_vfs_visibility(config.vfs.c_str(), DBPATH + ".check"))
+        {
+            std::cerr << "Commits on VFS " << config.vfs << " are not visible to other connections" << std::endl;
+            return -1;
+        }
+        connection_vfs = config.vfs.c_str();
+    }
+
+    connection_file_config = config;
+
     std::vector<std::tuple<std::string, std::vector<std::string>>> pragmas_to_run = {
         // {"normal", {}},
         // {"synch_off", {"PRAGMA synchronous = OFF;"}},
@@ -909,7 +1382,7 @@ int main(int argc, char *argv[])
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
     sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
@@ -923,6 +1396,13 @@ int main(int argc, char *argv[])
 
     std::filesystem::copy(DBPATH, DBPATH + ".backup", std::filesystem::copy_options::overwrite_existing);
 
+    // The upsert workloads need a UNIQUE (Hash, Size) index, so they get their own copy of the database.
+    std::filesystem::copy(DBPATH, DBPATH + ".unique", std::filesystem::copy_options::overwrite_existing);
+    sqlite3_open((DBPATH + ".unique").c_str(), &db);
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "DROP INDEX BlockHashSize; CREATE UNIQUE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr), db, "Create unique index"))
+        return -1;
+    sqlite3_close(db);
+
     for (auto &[report_name, pragmas] : pragmas_to_run)
     {
         int ret = measure_all(entries, config, report_name, pragmas);
@@ -933,7 +1413,7 @@ int main(int argc, char *argv[])
         }
     }
 
-    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal", DBPATH + ".backup"};
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal", DBPATH + ".backup", DBPATH + ".unique"};
     for (const auto &f : files)
     {
         if (std::filesystem::exists(f))
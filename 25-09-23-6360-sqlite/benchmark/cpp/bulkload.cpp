@@ -0,0 +1,333 @@
+#include "shared.hpp"
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+const std::vector<std::string> CREATE_INDEXES = {
+    "CREATE INDEX BlockHashSize ON Block(Hash, Size);",
+    "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);"};
+
+// Ways of building the database from scratch, all ending with the same indexes:
+//   index_first        the indexes are created on the empty tables, and the blocks inserted in generation order
+//   index_after_<n>    the blocks are inserted into bare tables, and the indexes created afterwards with PRAGMA threads = n, which
+//                      lets the sorter of CREATE INDEX use up to n helper threads
+//   presorted          the indexes are created first, and the blocks inserted in Hash order, numbered in that order
+struct Approach
+{
+    std::string name;
+    bool index_first;
+    bool presorted;
+    int threads;
+};
+
+// Generates the same blocks and blocksets as fill does in the other benchmarks, without inserting them
+std::vector<Entry> generate_entries(std::mt19937 &rng, uint64_t num_entries)
+{
+    std::vector<Entry> entries;
+    entries.reserve(num_entries);
+    uint64_t blockset_id = 1;
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        entries.push_back({i, random_hash_string(rng, 44), rng() % 1000, blockset_id});
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+            blockset_id++;
+    }
+    return entries;
+}
+
+// Inserts the blocks in the given order, followed by their blockset entries and the blocksets
+int load(sqlite3 *db, const std::vector<Entry> &entries, const std::vector<uint64_t> &order)
+{
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    std::vector<uint64_t> blockset_counts(entries.empty() ? 1 : entries.back().blockset_id + 1, 0);
+    for (uint64_t i : order)
+    {
+        const Entry &entry = entries[i];
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+    }
+
+    // The blockset entries are always inserted in BlocksetID order, so only the Block index depends on the order
+    for (uint64_t i = 0; i < entries.size(); i++)
+    {
+        const Entry &entry = entries[i];
+        sqlite3_bind_int64(stmt_blockset_entry, 1, entry.blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_counts[entry.blockset_id]++;
+    }
+
+    for (uint64_t blockset_id = 1; blockset_id < blockset_counts.size(); blockset_id++)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_counts[blockset_id]);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr), db, "Commit load"))
+        return -1;
+
+    return 0;
+}
+
+int create_indexes(sqlite3 *db)
+{
+    for (const auto &sql : CREATE_INDEXES)
+    {
+        if (!assert_sqlite_return_code(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr), db, sql))
+            return -1;
+    }
+    return 0;
+}
+
+int64_t query_int(sqlite3 *db, const std::string &sql)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return -1;
+    int64_t value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+// Leaf pages of a B-tree, and how full they are on average in percent. Both are -1 when SQLite is built without the dbstat table.
+void leaf_fill(sqlite3 *db, const std::string &name, int64_t &pages, double &fill_pct)
+{
+    pages = -1;
+    fill_pct = -1;
+    sqlite3_stmt *stmt;
+    std::string sql = "SELECT count(*), sum(pgsize - unused), sum(pgsize) FROM dbstat WHERE name = ? AND pagetype = 'leaf';";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return;
+    sqlite3_bind_text(stmt, 1, name.c_str(), name.size(), SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int64(stmt, 2) > 0)
+    {
+        pages = sqlite3_column_int64(stmt, 0);
+        fill_pct = 100.0 * sqlite3_column_int64(stmt, 1) / sqlite3_column_int64(stmt, 2);
+    }
+    sqlite3_finalize(stmt);
+}
+
+int measure(
+    sqlite3 *db,
+    Config &config,
+    std::mt19937 &rng,
+    const std::function<int(sqlite3 *, const Entry &, uint64_t, const std::string &)> &f,
+    const std::string &report_name,
+    const int create_entry, // Percentage probability of creating a new entry
+    const std::vector<Entry> &entries)
+{
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    uint64_t next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_warmup; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[i % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (f(db, entry, i, "Warmup") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    std::vector<uint64_t> times;
+    next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_repetitions; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()];
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        if (f(db, entry, i, "Actual") != 0)
+            return -1;
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    report_stats(config, times, report_name);
+
+    return 0;
+}
+
+int measure_select(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string sql = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare select statement"))
+        return -1;
+
+    auto select_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_text(stmt, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt), db, prefix + " query execution " + std::to_string(i)))
+            return -1;
+        if (!assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt, 0), prefix + " ID check"))
+            return -1;
+        sqlite3_reset(stmt);
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, select_inner, report_name, -1, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    std::vector<Approach> approaches = {{"index_first", true, false, 0}};
+    for (int threads : {0, 1, 2, 4, 8, 16, 32})
+        approaches.push_back({"index_after_" + std::to_string(threads), false, false, threads});
+    approaches.push_back({"presorted", true, true, 0});
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    std::mt19937 rng(2025'07'08);
+    auto entries = generate_entries(rng, config.num_entries);
+
+    // Blocks numbered in generation order, and in Hash order
+    std::vector<uint64_t> generated(entries.size()), by_hash(entries.size());
+    std::iota(generated.begin(), generated.end(), 0);
+    std::iota(by_hash.begin(), by_hash.end(), 0);
+    std::sort(by_hash.begin(), by_hash.end(), [&](uint64_t a, uint64_t b)
+              { return std::tie(entries[a].hash, entries[a].size) < std::tie(entries[b].hash, entries[b].size); });
+
+    for (auto &approach : approaches)
+    {
+        auto db = setup_database(table_queries, config);
+        sqlite3_exec(db, "PRAGMA cache_size = -64000;", nullptr, nullptr, nullptr);
+        std::string pragma = "PRAGMA threads = " + std::to_string(approach.threads) + ";";
+        sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr);
+        // Read back, as SQLite caps it at its compile-time SQLITE_MAX_WORKER_THREADS
+        int64_t threads = query_int(db, "PRAGMA threads;");
+
+        // The presorted blocks get their IDs in Hash order, so both the table and the index are appended to
+        const auto &order = approach.presorted ? by_hash : generated;
+        for (uint64_t i = 0; i < order.size(); i++)
+            entries[order[i]].id = i;
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        if (approach.index_first && create_indexes(db) != 0)
+            return -1;
+        if (load(db, entries, order) != 0)
+            return -1;
+        auto loaded = std::chrono::high_resolution_clock::now();
+        if (!approach.index_first && create_indexes(db) != 0)
+            return -1;
+        auto end = std::chrono::high_resolution_clock::now();
+        sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+        uint64_t
+            load_us = std::chrono::duration_cast<std::chrono::microseconds>(loaded - begin).count(),
+            index_us = std::chrono::duration_cast<std::chrono::microseconds>(end - loaded).count(),
+            total_us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+        int64_t hash_pages, blockset_pages;
+        double hash_fill, blockset_fill;
+        leaf_fill(db, "BlockHashSize", hash_pages, hash_fill);
+        leaf_fill(db, "BlocksetEntryBlocksetID", blockset_pages, blockset_fill);
+        sqlite3_close(db);
+
+        std::cout << "Bulk load " << approach.name << " took " << total_us / 1000 << " ms (" << index_us / 1000 << " ms indexing), "
+                  << "BlockHashSize " << hash_pages << " leaf pages " << hash_fill << "% full" << std::endl;
+
+        if (!std::filesystem::exists("reports"))
+            std::filesystem::create_directory("reports");
+
+        bool emit_header = !std::filesystem::exists("reports/bulkload.csv");
+        std::ofstream report_file("reports/bulkload.csv", std::ios::app);
+        if (emit_header)
+            report_file << "num_entries,approach,threads,effective_threads,load_us,index_us,total_us,db_bytes,hash_index_leaf_pages,hash_index_fill_pct,blockset_index_leaf_pages,blockset_index_fill_pct\n";
+        report_file << config.num_entries << ","
+                    << approach.name << ","
+                    << approach.threads << ","
+                    << threads << ","
+                    << load_us << ","
+                    << index_us << ","
+                    << total_us << ","
+                    << std::filesystem::file_size(DBPATH) << ","
+                    << hash_pages << ","
+                    << hash_fill << ","
+                    << blockset_pages << ","
+                    << blockset_fill << "\n";
+
+        // Lookups on the finished database, with a cold connection
+        sqlite3_open(DBPATH.c_str(), &db);
+        rng.seed(~2025'07'08);
+        if (measure_select(db, config, rng, entries, "bulkload_select_" + approach.name) != 0)
+            return -1;
+        sqlite3_close(db);
+    }
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
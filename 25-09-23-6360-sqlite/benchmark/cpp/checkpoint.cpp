@@ -0,0 +1,511 @@
+#include "shared.hpp"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+const uint64_t
+    WAL_RESTART_BYTES = 16 << 20,  // WAL size that makes the checkpointer wait for the writer and readers, so the WAL is restarted
+    WAL_TRUNCATE_BYTES = 64 << 20, // WAL size that makes the checkpointer also truncate the WAL file
+    JOURNAL_SIZE_LIMIT = 4 << 20,  // Size the WAL file is truncated to when the writer restarts it
+    MAX_BLOCKSET_LENGTH = 64;
+
+const std::chrono::milliseconds
+    CHECKPOINT_INTERVAL(10),
+    FSYNC_INTERVAL(100), // Bounds the commits lost on power failure when durability is deferred
+    SAMPLE_INTERVAL(10);
+
+// How the WAL is checkpointed and made durable. The autocheckpoint mode is SQLite's default, where the committing connection checkpoints
+// once the WAL exceeds 1000 pages. The background modes disable that, and leave checkpointing to a dedicated thread and connection. With
+// deferred durability, commits are not synced, and a separate thread syncs the WAL periodically instead.
+struct Mode
+{
+    std::string name;
+    bool background;
+    bool deferred;
+};
+
+struct CheckpointStats
+{
+    uint64_t passive = 0, restart = 0, truncate = 0, busy = 0;
+    uint64_t restart_busy = 0, truncate_busy = 0; // Escalations that did not complete, so the WAL was not bounded
+    uint64_t fsyncs = 0, max_fsync_gap_us = 0;
+};
+
+struct WalSample
+{
+    uint64_t elapsed_us;
+    uint64_t wal_bytes;
+};
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+uint64_t file_size(const std::string &path)
+{
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+// Flushes a file to stable storage through a descriptor of its own, so it does not interfere with the connections using it. SQLite
+// holds no POSIX locks on the WAL file, so closing the descriptor does not release any of its locks.
+bool sync_file(const std::string &path)
+{
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0)
+        return false;
+    bool ok = _commit(fd) == 0;
+    _close(fd);
+#else
+    int fd = open(path.c_str(), O_RDWR);
+    if (fd < 0)
+        return false;
+#ifdef __APPLE__
+    bool ok = fcntl(fd, F_FULLFSYNC) == 0;
+#else
+    bool ok = fsync(fd) == 0;
+#endif
+    close(fd);
+#endif
+    return ok;
+}
+
+// Sleeps for the interval, waking early when the benchmark stops
+void sleep_while(const std::atomic<bool> &running, std::chrono::milliseconds interval)
+{
+    auto deadline = std::chrono::steady_clock::now() + interval;
+    while (running.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+// Checkpoints passively every interval, which never blocks the writer. The writer only starts over from the beginning of the WAL when
+// everything in it has been checkpointed as its transaction begins, which a writer committing back to back rarely sees, so the WAL keeps
+// growing even when the checkpoints keep up. Past a size, the checkpoint escalates to RESTART, which waits for the writer and readers so
+// the next transaction restarts the WAL, and further to TRUNCATE, which also shrinks the file. A writer committing back to back would
+// win the write lock against those every time, so it is held at its next transaction boundary while an escalation is pending.
+void run_checkpointer(const std::atomic<bool> &running, std::atomic<bool> &escalating, CheckpointStats &stats, int &return_code)
+{
+    sqlite3 *db;
+    if (!assert_sqlite_return_code(sqlite3_open_v2(DBPATH.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr), db, "Open checkpointer connection"))
+    {
+        return_code = -1;
+        return;
+    }
+    // The checkpointer syncs the WAL before copying it, and the database before restarting the WAL, regardless of the writer's setting.
+    // Passive checkpoints never wait, the timeout covers the escalations waiting for the writer to finish its transaction.
+    std::vector<std::string> pragmas = {"PRAGMA synchronous = FULL;", "PRAGMA wal_autocheckpoint = 0;", "PRAGMA busy_timeout = 5000;",
+                                        "PRAGMA journal_size_limit = " + std::to_string(JOURNAL_SIZE_LIMIT) + ";"};
+    for (const auto &pragma : pragmas)
+    {
+        if (!assert_sqlite_return_code(sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr), db, "Checkpointer " + pragma))
+        {
+            sqlite3_close(db);
+            return_code = -1;
+            return;
+        }
+    }
+    int mode = SQLITE_CHECKPOINT_PASSIVE;
+    while (running.load(std::memory_order_relaxed))
+    {
+        if (mode != SQLITE_CHECKPOINT_PASSIVE)
+            escalating = true;
+        int rc = sqlite3_wal_checkpoint_v2(db, nullptr, mode, nullptr, nullptr);
+        if (mode != SQLITE_CHECKPOINT_PASSIVE)
+        {
+            escalating = false;
+            escalating.notify_all();
+        }
+        if (rc == SQLITE_BUSY && mode == SQLITE_CHECKPOINT_RESTART)
+            stats.restart_busy++;
+        else if (rc == SQLITE_BUSY && mode == SQLITE_CHECKPOINT_TRUNCATE)
+            stats.truncate_busy++;
+        else if (rc == SQLITE_BUSY)
+            stats.busy++;
+        else if (!assert_sqlite_return_code(rc, db, "Checkpoint"))
+        {
+            return_code = -1;
+            break;
+        }
+        else if (mode == SQLITE_CHECKPOINT_PASSIVE)
+            stats.passive++;
+        else if (mode == SQLITE_CHECKPOINT_RESTART)
+            stats.restart++;
+        else
+            stats.truncate++;
+
+        uint64_t wal_bytes = file_size(DBPATH + "-wal");
+        if (wal_bytes > WAL_TRUNCATE_BYTES)
+            mode = SQLITE_CHECKPOINT_TRUNCATE;
+        else if (wal_bytes > WAL_RESTART_BYTES)
+            mode = SQLITE_CHECKPOINT_RESTART;
+        else
+            mode = SQLITE_CHECKPOINT_PASSIVE;
+        sleep_while(running, CHECKPOINT_INTERVAL);
+    }
+
+    escalating = false;
+    escalating.notify_all();
+    sqlite3_close(db);
+}
+
+// Syncs the WAL every interval, so at most the commits of the last interval are lost on power failure. The gap between the syncs is the
+// actual loss window, which exceeds the interval when the syncs themselves are slow.
+void run_fsync(const std::atomic<bool> &running, CheckpointStats &stats)
+{
+    auto last = std::chrono::high_resolution_clock::now();
+    while (running.load(std::memory_order_relaxed))
+    {
+        sleep_while(running, FSYNC_INTERVAL);
+        if (sync_file(DBPATH + "-wal"))
+            stats.fsyncs++;
+        auto now = std::chrono::high_resolution_clock::now();
+        stats.max_fsync_gap_us = std::max(stats.max_fsync_gap_us, (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - last).count());
+        last = now;
+    }
+}
+
+void run_sampler(const std::atomic<bool> &running, std::vector<WalSample> &samples)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    while (running.load(std::memory_order_relaxed))
+    {
+        auto now = std::chrono::high_resolution_clock::now();
+        samples.push_back({(uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - begin).count(), file_size(DBPATH + "-wal")});
+        sleep_while(running, SAMPLE_INTERVAL);
+    }
+}
+
+// Writes a transaction of max(1, num_batch) new blocks
+int transaction_insert(sqlite3 *db, std::mt19937 &rng, Config &config, const std::vector<Entry> &entries, std::vector<sqlite3_stmt *> &stmts)
+{
+    sqlite3_stmt *stmt = stmts[0];
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr), db, "Begin insert"))
+        return -1;
+    for (uint64_t i = 0; i < std::max<uint64_t>(1, config.num_batch); i++)
+    {
+        std::string hash = random_hash_string(rng, 44);
+        sqlite3_bind_text(stmt, 1, hash.c_str(), hash.size(), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, rng() % 1000);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt), db, "Insert block"))
+            return -1;
+        sqlite3_reset(stmt);
+    }
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr), db, "Commit insert"))
+        return -1;
+    return 0;
+}
+
+// Writes a transaction creating a blockset, where half of the blocks are new, and the rest already exist
+int transaction_new_blockset(sqlite3 *db, std::mt19937 &rng, Config &config, const std::vector<Entry> &entries, std::vector<sqlite3_stmt *> &stmts)
+{
+    sqlite3_stmt
+        *stmt_blockset = stmts[1],
+        *stmt_block = stmts[0],
+        *stmt_blockset_entry = stmts[2];
+    uint64_t length = 1 + rng() % MAX_BLOCKSET_LENGTH;
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr), db, "Begin new blockset"))
+        return -1;
+    sqlite3_bind_int64(stmt_blockset, 1, length);
+    if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert blockset"))
+        return -1;
+    sqlite3_reset(stmt_blockset);
+    uint64_t blockset_id = sqlite3_last_insert_rowid(db);
+
+    for (uint64_t i = 0; i < length; i++)
+    {
+        uint64_t block_id;
+        if (rng() % 2 == 0)
+        {
+            std::string hash = random_hash_string(rng, 44);
+            sqlite3_bind_text(stmt_block, 1, hash.c_str(), hash.size(), SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt_block, 2, rng() % 1000);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert block"))
+                return -1;
+            sqlite3_reset(stmt_block);
+            block_id = sqlite3_last_insert_rowid(db);
+        }
+        else
+        {
+            block_id = entries[rng() % entries.size()].id;
+        }
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, block_id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert blockset entry"))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+    }
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr), db, "Commit new blockset"))
+        return -1;
+    return 0;
+}
+
+int measure(std::function<int(sqlite3 *, std::mt19937 &, Config &, const std::vector<Entry> &, std::vector<sqlite3_stmt *> &)> f, const std::vector<Entry> &entries, Config &config, const std::string &workload, const Mode &mode)
+{
+    std::filesystem::remove(DBPATH + "-shm");
+    std::filesystem::remove(DBPATH + "-wal");
+    std::filesystem::copy_file(DBPATH + ".backup", DBPATH, std::filesystem::copy_options::overwrite_existing);
+
+    sqlite3 *db;
+    if (!assert_sqlite_return_code(sqlite3_open_v2(DBPATH.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr), db, "Open writer connection"))
+        return -1;
+    std::vector<std::string> pragmas = {
+        "PRAGMA journal_mode = WAL;",
+        "PRAGMA busy_timeout = 5000;",
+        mode.deferred ? "PRAGMA synchronous = OFF;" : "PRAGMA synchronous = FULL;"};
+    if (mode.background)
+    {
+        pragmas.push_back("PRAGMA wal_autocheckpoint = 0;");
+        pragmas.push_back("PRAGMA journal_size_limit = " + std::to_string(JOURNAL_SIZE_LIMIT) + ";");
+    }
+    for (const auto &pragma : pragmas)
+    {
+        if (!assert_sqlite_return_code(sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr), db, "Writer " + pragma))
+            return -1;
+    }
+
+    std::vector<std::string> sqls = {
+        "INSERT INTO Block(Hash, Size) VALUES (?, ?);",
+        "INSERT INTO Blockset(Length) VALUES (?);",
+        "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);"};
+    std::vector<sqlite3_stmt *> stmts(sqls.size());
+    for (size_t i = 0; i < sqls.size(); i++)
+    {
+        if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sqls[i].c_str(), -1, &stmts[i], nullptr), db, "Prepare " + sqls[i]))
+            return -1;
+    }
+
+    std::atomic<bool> running = true, escalating = false;
+    CheckpointStats stats;
+    std::vector<WalSample> samples;
+    int checkpointer_rc = 0;
+    std::thread checkpointer, fsyncer;
+    if (mode.background)
+        checkpointer = std::thread(run_checkpointer, std::cref(running), std::ref(escalating), std::ref(stats), std::ref(checkpointer_rc));
+    if (mode.deferred)
+        fsyncer = std::thread(run_fsync, std::cref(running), std::ref(stats));
+    std::thread sampler(run_sampler, std::cref(running), std::ref(samples));
+
+    std::mt19937 rng(2025'07'08);
+    int rc = 0;
+    for (uint64_t i = 0; i < config.num_warmup && rc == 0; i++)
+    {
+        escalating.wait(true);
+        rc = f(db, rng, config, entries, stmts);
+    }
+
+    std::vector<uint64_t> times;
+    times.reserve(config.num_repetitions);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < config.num_repetitions && rc == 0; i++)
+    {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        escalating.wait(true); // Counted in the latency, as the writer is stalled by the checkpoint
+        rc = f(db, rng, config, entries, stmts);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    running = false;
+    if (checkpointer.joinable())
+        checkpointer.join();
+    if (fsyncer.joinable())
+        fsyncer.join();
+    sampler.join();
+
+    uint64_t wal_bytes = file_size(DBPATH + "-wal");
+    for (auto stmt : stmts)
+        sqlite3_finalize(stmt);
+    // Always revert journal mode to delete prior to closing, so that others won't be in WAL mode.
+    sqlite3_exec(db, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+    if (rc != 0 || checkpointer_rc == -1 || times.empty())
+        return -1;
+
+    std::string report_name = "checkpoint_" + workload + "_" + mode.name;
+    auto sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    int64_t total_us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    uint64_t max_wal_bytes = wal_bytes;
+    for (const auto &sample : samples)
+        max_wal_bytes = std::max(max_wal_bytes, sample.wal_bytes);
+
+    std::cout << "Checkpoint " << workload << " " << mode.name << ": " << float(config.num_repetitions) / (float(total_us) / 1000) << " kop/s, p99.9 "
+              << sorted[sorted.size() * 999 / 1000] / 1000 << " us, max WAL " << max_wal_bytes / 1024 << " KiB, "
+              << stats.passive << "/" << stats.restart << "/" << stats.truncate << " passive/restart/truncate checkpoints, "
+              << stats.restart_busy << "/" << stats.truncate_busy << " restart/truncate busy" << std::endl;
+    report_stats(config, times, report_name);
+
+    bool emit_header = !std::filesystem::exists("reports/checkpoint.csv");
+    std::ofstream report_file("reports/checkpoint.csv", std::ios::app);
+    if (emit_header)
+        report_file << "num_entries,num_warmup,num_repetitions,num_batch,workload,mode,total_us,kop_s,median_ns,99th_ns,99.9th_ns,max_ns,passive,restart,truncate,busy,restart_busy,truncate_busy,fsyncs,max_fsync_gap_us,max_wal_bytes,final_wal_bytes\n";
+    report_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << config.num_batch << ","
+                << workload << ","
+                << mode.name << ","
+                << total_us << ","
+                << float(config.num_repetitions) / (float(total_us) / 1000) << ","
+                << sorted[sorted.size() / 2] << ","
+                << sorted[sorted.size() * 99 / 100] << ","
+                << sorted[sorted.size() * 999 / 1000] << ","
+                << sorted.back() << ","
+                << stats.passive << ","
+                << stats.restart << ","
+                << stats.truncate << ","
+                << stats.busy << ","
+                << stats.restart_busy << ","
+                << stats.truncate_busy << ","
+                << stats.fsyncs << ","
+                << stats.max_fsync_gap_us << ","
+                << max_wal_bytes << ","
+                << wal_bytes << "\n";
+
+    emit_header = !std::filesystem::exists("reports/" + report_name + "_wal.csv");
+    std::ofstream wal_file("reports/" + report_name + "_wal.csv", std::ios::app);
+    if (emit_header)
+        wal_file << "num_entries,num_batch,elapsed_us,wal_bytes\n";
+    for (const auto &sample : samples)
+        wal_file << config.num_entries << "," << config.num_batch << "," << sample.elapsed_us << "," << sample.wal_bytes << "\n";
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    std::vector<Mode> modes = {
+        {"autocheckpoint", false, false},
+        {"background", true, false},
+        {"background_deferred", true, true}};
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    auto db = setup_database(table_queries, config);
+    sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(db, rng, entries, config.num_entries) != 0)
+        return -1;
+    sqlite3_close(db);
+    std::filesystem::copy(DBPATH, DBPATH + ".backup", std::filesystem::copy_options::overwrite_existing);
+
+    for (const auto &mode : modes)
+    {
+        if (measure(transaction_insert, entries, config, "insert", mode) != 0)
+            return -1;
+        if (measure(transaction_new_blockset, entries, config, "new_blockset", mode) != 0)
+            return -1;
+    }
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal", DBPATH + ".backup"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
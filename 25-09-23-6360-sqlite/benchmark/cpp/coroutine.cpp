@@ -0,0 +1,505 @@
+#include "shared.hpp"
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+const std::vector<uint64_t> CLIENT_COUNTS = {1, 16, 256, 4096};
+const uint64_t
+    MAX_BATCH = 64,            // Requests a connection thread takes from the queue at a time, and runs in one transaction
+    MAX_THREAD_CLIENTS = 256;  // Thread per client needs a connection, and three file descriptors, per client, so larger counts are skipped
+
+enum class Workload
+{
+    Select,
+    Xor1,
+    Join
+};
+
+// Connection with the statements of all the workloads, owned by a single thread.
+struct Connection
+{
+    sqlite3 *db = nullptr;
+    sqlite3_stmt *stmt_select = nullptr, *stmt_insert = nullptr, *stmt_join = nullptr;
+
+    bool open(const std::vector<std::string> &pragmas)
+    {
+        if (!assert_sqlite_return_code(sqlite3_open_v2(DBPATH.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr), db, "Open connection"))
+            return false;
+        for (const auto &pragma : pragmas)
+        {
+            if (!assert_sqlite_return_code(sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr), db, "Set pragma " + pragma))
+                return false;
+        }
+        std::string
+            sql_select = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+            sql_insert = "INSERT INTO Block (Hash, Size) VALUES (?, ?);",
+            sql_join = "SELECT Block.ID, Block.Hash, Block.Size FROM Block JOIN BlocksetEntry ON BlocksetEntry.BlockID = Block.ID WHERE BlocksetEntry.BlocksetID = ?;";
+        if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare select statement"))
+            return false;
+        if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert.c_str(), -1, &stmt_insert, nullptr), db, "Prepare insert statement"))
+            return false;
+        if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_join.c_str(), -1, &stmt_join, nullptr), db, "Prepare join statement"))
+            return false;
+        return true;
+    }
+
+    void close()
+    {
+        sqlite3_finalize(stmt_select);
+        sqlite3_finalize(stmt_insert);
+        sqlite3_finalize(stmt_join);
+        sqlite3_close(db);
+        db = nullptr;
+    }
+};
+
+// One operation from a logical client. The entry is looked up for select, looked up and inserted when missing for xor1, and gives the
+// blockset for join. Returns the number of rows touched, or -1 on error. Transactions are left to the caller.
+int execute(Connection &connection, Workload workload, const Entry &entry)
+{
+    sqlite3 *db = connection.db;
+    int rc, rows = 0;
+    if (workload == Workload::Join)
+    {
+        sqlite3_bind_int64(connection.stmt_join, 1, entry.blockset_id);
+        while ((rc = sqlite3_step(connection.stmt_join)) == SQLITE_ROW)
+            rows++;
+        sqlite3_reset(connection.stmt_join);
+        return assert_sqlite_return_code(rc, db, "Join blockset") ? rows : -1;
+    }
+
+    sqlite3_bind_text(connection.stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(connection.stmt_select, 2, entry.size);
+    rc = sqlite3_step(connection.stmt_select);
+    sqlite3_reset(connection.stmt_select);
+    if (!assert_sqlite_return_code(rc, db, "Select block"))
+        return -1;
+    rows++;
+    if (workload == Workload::Xor1 && rc == SQLITE_DONE)
+    {
+        sqlite3_bind_text(connection.stmt_insert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(connection.stmt_insert, 2, entry.size);
+        rc = sqlite3_step(connection.stmt_insert);
+        sqlite3_reset(connection.stmt_insert);
+        if (!assert_sqlite_return_code(rc, db, "Insert block"))
+            return -1;
+        rows++;
+    }
+    return rows;
+}
+
+// Picks the argument of the next operation: an existing entry, or for xor1 a new one half of the time
+Entry next_entry(Workload workload, std::mt19937 &rng, const std::vector<Entry> &entries)
+{
+    if (workload == Workload::Xor1 && rng() % 2 == 0)
+        return {(uint64_t)-1, random_hash_string(rng, 44), rng() % 1000, 0};
+    return entries[rng() % entries.size()];
+}
+
+// Coroutine executor: the logical clients are coroutines, which suspend on every operation until a connection thread has run it. The
+// connection threads take the queued operations in batches, run each batch in one transaction, and resume the clients of the batch,
+// which run until their next operation on that thread.
+struct Request
+{
+    std::coroutine_handle<> handle;
+    Entry entry;
+    int rows = 0;
+};
+
+struct Executor
+{
+    Workload workload;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::deque<Request *> queue;
+    bool stopping = false;
+    std::atomic<bool> failed = false;
+
+    void submit(Request *request)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(request);
+        }
+        available.notify_one();
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+    }
+
+    void run(const std::vector<std::string> &pragmas, int &return_code)
+    {
+        return_code = -1;
+        Connection connection;
+        if (!connection.open(pragmas))
+            return;
+        std::string begin_sql = workload == Workload::Xor1 ? "BEGIN IMMEDIATE;" : "BEGIN DEFERRED;";
+        std::vector<Request *> batch;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [&]
+                               { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    break;
+                while (!queue.empty() && batch.size() < MAX_BATCH)
+                {
+                    batch.push_back(queue.front());
+                    queue.pop_front();
+                }
+            }
+
+            if (!assert_sqlite_return_code(sqlite3_exec(connection.db, begin_sql.c_str(), nullptr, nullptr, nullptr), connection.db, "Begin batch"))
+                return;
+            for (auto request : batch)
+            {
+                request->rows = execute(connection, workload, request->entry);
+                if (request->rows < 0)
+                    return;
+            }
+            if (!assert_sqlite_return_code(sqlite3_exec(connection.db, "COMMIT;", nullptr, nullptr, nullptr), connection.db, "Commit batch"))
+                return;
+
+            for (auto request : batch)
+                request->handle.resume();
+            batch.clear();
+        }
+        connection.close();
+        return_code = 0;
+    }
+
+    // Runs the connection thread, and flags the executor when it fails
+    void run_or_fail(const std::vector<std::string> &pragmas, int &return_code)
+    {
+        run(pragmas, return_code);
+        if (return_code != 0)
+            failed = true;
+    }
+};
+
+struct Operation
+{
+    Executor &executor;
+    Request request;
+
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        request.handle = handle;
+        executor.submit(&request);
+    }
+    int await_resume() { return request.rows; }
+};
+
+// Fire and forget coroutine, which starts right away and frees itself when it returns
+struct ClientTask
+{
+    struct promise_type
+    {
+        ClientTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+struct ClientResult
+{
+    uint64_t rows = 0;
+    std::vector<uint64_t> latencies;
+};
+
+ClientTask run_client(Executor &executor, uint64_t client, uint64_t runs, const std::vector<Entry> &entries, ClientResult &result, std::atomic<uint64_t> &remaining, std::promise<void> &done)
+{
+    std::mt19937 rng(~2025'07'08 + client);
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        Operation operation{executor, {nullptr, next_entry(executor.workload, rng, entries)}};
+        auto begin = std::chrono::high_resolution_clock::now();
+        int rows = co_await operation;
+        auto end = std::chrono::high_resolution_clock::now();
+        result.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+        result.rows += rows;
+    }
+    if (remaining.fetch_sub(1) == 1)
+        done.set_value();
+}
+
+int run_coroutines(Workload workload, uint64_t num_clients, uint64_t runs, Config &config, const std::vector<Entry> &entries, const std::vector<std::string> &pragmas, std::vector<ClientResult> &results)
+{
+    Executor executor;
+    executor.workload = workload;
+    std::vector<std::thread> threads;
+    std::vector<int> return_codes(config.num_threads);
+    for (uint64_t i = 0; i < config.num_threads; i++)
+        threads.emplace_back([&, i]()
+                             { executor.run_or_fail(pragmas, return_codes[i]); });
+
+    results.assign(num_clients, ClientResult());
+    std::atomic<uint64_t> remaining = num_clients;
+    std::promise<void> done;
+    auto finished = done.get_future();
+    for (uint64_t client = 0; client < num_clients; client++)
+        run_client(executor, client, runs, entries, results[client], remaining, done);
+
+    // A connection thread that fails never resumes the clients of its batch, so the wait also ends on a failure
+    while (finished.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready && !executor.failed)
+        ;
+    executor.stop();
+    for (auto &thread : threads)
+        thread.join();
+    for (auto return_code : return_codes)
+        if (return_code != 0)
+            return -1;
+    return 0;
+}
+
+// Thread per client: every client has its own thread and connection, and runs each operation in its own transaction, as in parallel.
+int run_threads(Workload workload, uint64_t num_clients, uint64_t runs, Config &config, const std::vector<Entry> &entries, const std::vector<std::string> &pragmas, std::vector<ClientResult> &results)
+{
+    results.assign(num_clients, ClientResult());
+    std::vector<int> return_codes(num_clients);
+    std::vector<std::thread> threads;
+    for (uint64_t client = 0; client < num_clients; client++)
+    {
+        threads.emplace_back([&, client]()
+                             {
+            return_codes[client] = -1;
+            Connection connection;
+            if (!connection.open(pragmas))
+                return;
+            std::mt19937 rng(~2025'07'08 + client);
+            std::string begin_sql = workload == Workload::Xor1 ? "BEGIN IMMEDIATE;" : "BEGIN DEFERRED;";
+            for (uint64_t i = 0; i < runs; i++)
+            {
+                Entry entry = next_entry(workload, rng, entries);
+                auto begin = std::chrono::high_resolution_clock::now();
+                if (!assert_sqlite_return_code(sqlite3_exec(connection.db, begin_sql.c_str(), nullptr, nullptr, nullptr), connection.db, "Begin operation"))
+                    return;
+                int rows = execute(connection, workload, entry);
+                if (rows < 0)
+                    return;
+                if (!assert_sqlite_return_code(sqlite3_exec(connection.db, "COMMIT;", nullptr, nullptr, nullptr), connection.db, "Commit operation"))
+                    return;
+                auto end = std::chrono::high_resolution_clock::now();
+                results[client].latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+                results[client].rows += rows;
+            }
+            connection.close();
+            return_codes[client] = 0; });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    for (auto return_code : return_codes)
+        if (return_code != 0)
+            return -1;
+    return 0;
+}
+
+int measure(Workload workload, const std::string &workload_name, const std::string &design, uint64_t num_clients, std::vector<Entry> &entries, Config &config, const std::vector<std::string> &pragmas)
+{
+    // Copy the backed up database
+    auto copy_db = []()
+    {
+        std::filesystem::remove(DBPATH + "-shm");
+        std::filesystem::remove(DBPATH + "-wal");
+        std::filesystem::copy_file(DBPATH + ".backup", DBPATH, std::filesystem::copy_options::overwrite_existing);
+        sqlite3 *db;
+        sqlite3_open(DBPATH.c_str(), &db);
+        sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+        sqlite3_wal_checkpoint(db, nullptr);
+        sqlite3_close(db);
+    };
+    auto run = design == "coroutine" ? run_coroutines : run_threads;
+    std::vector<ClientResult> results;
+
+    copy_db();
+    if (run(workload, num_clients, std::max<uint64_t>(1, config.num_warmup / num_clients), config, entries, pragmas, results) != 0)
+        return -1;
+
+    copy_db();
+    auto begin = std::chrono::high_resolution_clock::now();
+    if (run(workload, num_clients, std::max<uint64_t>(1, config.num_repetitions / num_clients), config, entries, pragmas, results) != 0)
+        return -1;
+    auto end = std::chrono::high_resolution_clock::now();
+    int64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+
+    uint64_t total_rows = 0;
+    std::vector<uint64_t> latencies;
+    for (auto &result : results)
+    {
+        total_rows += result.rows;
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "Coroutine " << workload_name << " " << design << " with " << num_clients << " clients took " << time_us / 1000 << " ms ("
+              << float(total_rows) / (float(time_us) / 1000) << " kop/s)" << std::endl;
+
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    bool emit_header = !std::filesystem::exists("reports/coroutine_" + workload_name + ".csv");
+    std::ofstream report_file("reports/coroutine_" + workload_name + ".csv", std::ios::app);
+    if (emit_header)
+        report_file << "num_entries,num_warmup,num_repetitions,num_threads,num_clients,design,rows,time_us,kop_s,median_ns,99th_ns,max_ns\n";
+    report_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << (design == "coroutine" ? config.num_threads : num_clients) << ","
+                << num_clients << ","
+                << design << ","
+                << total_rows << ","
+                << time_us << ","
+                << float(total_rows) / (float(time_us) / 1000) << ","
+                << latencies[latencies.size() / 2] << ","
+                << latencies[latencies.size() * 99 / 100] << ","
+                << latencies.back() << "\n";
+
+    return 0;
+}
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    // The timeout goes first, as the pragmas can lock the database while many connections open at once
+    std::vector<std::string> pragmas = {"PRAGMA busy_timeout = 5000;", "PRAGMA synchronous = NORMAL;", "PRAGMA temp_store = MEMORY;", "PRAGMA cache_size = -64000;"};
+
+    std::vector<std::tuple<std::string, Workload>> workloads = {
+        {"select", Workload::Select},
+        {"xor1", Workload::Xor1},
+        {"join", Workload::Join}};
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    auto db = setup_database(table_queries, config);
+    sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(db, rng, entries, config.num_entries) != 0)
+        return -1;
+    sqlite3_close(db);
+    std::filesystem::copy(DBPATH, DBPATH + ".backup", std::filesystem::copy_options::overwrite_existing);
+
+    for (auto &[name, workload] : workloads)
+    {
+        for (auto num_clients : CLIENT_COUNTS)
+        {
+            if (measure(workload, name, "coroutine", num_clients, entries, config, pragmas) != 0)
+                return -1;
+            if (num_clients <= MAX_THREAD_CLIENTS && measure(workload, name, "thread", num_clients, entries, config, pragmas) != 0)
+                return -1;
+        }
+    }
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal", DBPATH + ".backup"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
@@ -0,0 +1,508 @@
+#include "shared.hpp"
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+const uint64_t
+    BACKOFF_MIN_US = 1,        // First sleep of the busy handler
+    BACKOFF_MAX_US = 1000,     // Longest sleep of the busy handler
+    BACKOFF_MAX_RETRIES = 200, // Invocations before the handler gives up, and the transaction is restarted
+    MIXED_SELECT_PCT = 90;     // Share of read-only lookups in the mixed workload
+
+// How the workers deal with contention on the write lock:
+//   spin       DEFERRED transactions, rolled back and restarted right away on SQLITE_BUSY, as parallel does
+//   backoff    DEFERRED transactions, sleeping exponentially longer between retries, both in the busy handler and before restarting
+//   immediate  BEGIN IMMEDIATE for the transactions that may write, with the backoff busy handler
+//   manager    The LockManager in front of the connections. Writers queue for the write lock before BEGIN IMMEDIATE, and a
+//              lookup that may insert reads in a DEFERRED transaction first, only taking the write lock when the block is missing.
+const std::vector<std::string> STRATEGIES = {"spin", "backoff", "immediate", "manager"};
+const std::vector<std::string> WORKLOADS = {"insert", "xor1", "mixed"};
+
+// Per thread contention counters
+struct alignas(64) LockStats
+{
+    uint64_t transactions = 0;
+    uint64_t busy_retries = 0;  // Busy handler invocations
+    uint64_t busy_wait_ns = 0;  // Time spent backing off and in transactions that were aborted
+    uint64_t queue_wait_ns = 0; // Time spent waiting for the lock manager
+    uint64_t aborts = 0;        // Transactions rolled back and restarted after SQLITE_BUSY
+};
+
+std::vector<LockStats> lock_stats;
+
+uint64_t elapsed_ns(std::chrono::high_resolution_clock::time_point begin)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - begin).count();
+}
+
+// Grants the write lock in the order it was asked for (a ticket lock), and admits at most max_readers read transactions at a
+// time. In WAL mode readers do not block the writer, so the two are admitted independently.
+struct LockManager
+{
+    std::mutex mutex;
+    std::condition_variable writer_turn, reader_slot;
+    uint64_t next_ticket = 0, now_serving = 0;
+    uint64_t readers = 0, max_readers = 1;
+
+    void lock_write(LockStats &stats)
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t ticket = next_ticket++;
+        writer_turn.wait(lock, [&]()
+                         { return now_serving == ticket; });
+        stats.queue_wait_ns += elapsed_ns(begin);
+    }
+
+    void unlock_write()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            now_serving++;
+        }
+        writer_turn.notify_all();
+    }
+
+    void lock_read(LockStats &stats)
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        reader_slot.wait(lock, [&]()
+                         { return readers < max_readers; });
+        readers++;
+        stats.queue_wait_ns += elapsed_ns(begin);
+    }
+
+    void unlock_read()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readers--;
+        }
+        reader_slot.notify_one();
+    }
+};
+
+LockManager lock_manager;
+
+// Sleeps BACKOFF_MIN_US on the first retry, doubling up to BACKOFF_MAX_US
+void backoff_sleep(LockStats &stats, uint64_t retry)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    std::this_thread::sleep_for(std::chrono::microseconds(std::min<uint64_t>(BACKOFF_MAX_US, BACKOFF_MIN_US << std::min<uint64_t>(retry, 20))));
+    stats.busy_wait_ns += elapsed_ns(begin);
+}
+
+// Backs off between retries, and gives up after BACKOFF_MAX_RETRIES
+int backoff_busy_handler(void *arg, int count)
+{
+    LockStats &stats = *(LockStats *)arg;
+    if ((uint64_t)count >= BACKOFF_MAX_RETRIES)
+        return 0;
+    backoff_sleep(stats, count);
+    stats.busy_retries++;
+    return 1;
+}
+
+struct Worker
+{
+    int tid;
+    std::string strategy;
+    sqlite3 *db = nullptr;
+    sqlite3_stmt *stmt_select = nullptr, *stmt_insert = nullptr, *stmt_insert_id = nullptr;
+};
+
+bool open_worker(Worker &worker, const std::vector<std::string> &pragmas)
+{
+    sqlite3_open_v2(DBPATH.c_str(), &worker.db, SQLITE_OPEN_READWRITE, nullptr);
+
+    // Timeout is needed for some of the pragmas, as they can lock the database.
+    if (!assert_sqlite_return_code(sqlite3_exec(worker.db, "PRAGMA busy_timeout = 100;", nullptr, nullptr, nullptr), worker.db, "Set busy_timeout"))
+        return false;
+    for (const auto &pragma : pragmas)
+    {
+        if (!assert_sqlite_return_code(sqlite3_exec(worker.db, pragma.c_str(), nullptr, nullptr, nullptr), worker.db, "Set pragma " + pragma))
+            return false;
+    }
+
+    // Replaces the timeout
+    if (worker.strategy == "spin")
+        sqlite3_busy_timeout(worker.db, 0);
+    else
+        sqlite3_busy_handler(worker.db, backoff_busy_handler, &lock_stats[worker.tid]);
+
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(worker.db, "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;", -1, &worker.stmt_select, nullptr), worker.db, "Prepare select statement"))
+        return false;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(worker.db, "INSERT INTO Block(Hash, Size) VALUES (?, ?);", -1, &worker.stmt_insert, nullptr), worker.db, "Prepare insert statement"))
+        return false;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(worker.db, "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);", -1, &worker.stmt_insert_id, nullptr), worker.db, "Prepare insert with ID statement"))
+        return false;
+    return true;
+}
+
+void close_worker(Worker &worker)
+{
+    sqlite3_finalize(worker.stmt_select);
+    sqlite3_finalize(worker.stmt_insert);
+    sqlite3_finalize(worker.stmt_insert_id);
+    sqlite3_close(worker.db);
+}
+
+// Runs body in a transaction until it gets through without SQLITE_BUSY. body returns SQLITE_DONE when done, SQLITE_BUSY to
+// have the transaction rolled back and restarted, or any other code on failure. Returns -1 on failure.
+int run_transaction(Worker &worker, bool may_write, const std::function<int()> &body)
+{
+    LockStats &stats = lock_stats[worker.tid];
+    bool managed = worker.strategy == "manager";
+    bool immediate = may_write && (worker.strategy == "immediate" || managed);
+    if (managed)
+        may_write ? lock_manager.lock_write(stats) : lock_manager.lock_read(stats);
+
+    int rc;
+    for (uint64_t attempt = 0;; attempt++)
+    {
+        auto attempt_begin = std::chrono::high_resolution_clock::now();
+        uint64_t handler_wait_ns = stats.busy_wait_ns;
+        rc = sqlite3_exec(worker.db, immediate ? "BEGIN IMMEDIATE TRANSACTION;" : "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        if (rc == SQLITE_OK)
+        {
+            rc = body();
+            if (rc == SQLITE_DONE)
+                rc = sqlite3_exec(worker.db, "COMMIT;", nullptr, nullptr, nullptr);
+        }
+        if (rc != SQLITE_BUSY)
+            break;
+
+        // A statement in an explicit transaction cannot be retried after SQLITE_BUSY, so the whole transaction is
+        if (!sqlite3_get_autocommit(worker.db))
+            sqlite3_exec(worker.db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        stats.aborts++;
+        // The busy handler has already counted its own sleeps
+        handler_wait_ns = stats.busy_wait_ns - handler_wait_ns;
+        stats.busy_wait_ns += elapsed_ns(attempt_begin) - handler_wait_ns;
+
+        // A stale snapshot (SQLITE_BUSY_SNAPSHOT) fails the upgrade to a write transaction without calling the busy handler, so
+        // the restart backs off as well
+        if (worker.strategy != "spin")
+            backoff_sleep(stats, attempt);
+    }
+
+    if (managed)
+        may_write ? lock_manager.unlock_write() : lock_manager.unlock_read();
+    if (!assert_sqlite_return_code(rc, worker.db, "Transaction"))
+        return -1;
+    stats.transactions++;
+    return 0;
+}
+
+// Looks up the ID of the entry, -1 when it is missing
+int select_block(Worker &worker, const Entry &entry, int64_t &id)
+{
+    sqlite3_bind_text(worker.stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(worker.stmt_select, 2, entry.size);
+    int rc = sqlite3_step(worker.stmt_select);
+    id = rc == SQLITE_ROW ? sqlite3_column_int64(worker.stmt_select, 0) : -1;
+    sqlite3_reset(worker.stmt_select);
+    return rc == SQLITE_ROW ? SQLITE_DONE : rc;
+}
+
+int insert_block(Worker &worker, const Entry &entry)
+{
+    sqlite3_bind_text(worker.stmt_insert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(worker.stmt_insert, 2, entry.size);
+    int rc = sqlite3_step(worker.stmt_insert);
+    sqlite3_reset(worker.stmt_insert);
+    return rc;
+}
+
+// Inserts the entry unless it exists, as in xor1
+int select_or_insert(Worker &worker, const Entry &entry)
+{
+    int64_t id;
+    if (worker.strategy == "manager")
+    {
+        // Most lookups hit, so they run as readers, and a miss is checked again once the write lock is held
+        if (run_transaction(worker, false, [&]()
+                            { return select_block(worker, entry, id); }) != 0)
+            return -1;
+        if (id != -1)
+            return 0;
+    }
+    return run_transaction(worker, true, [&]()
+                           {
+        int rc = select_block(worker, entry, id);
+        if (rc != SQLITE_DONE || id != -1)
+            return rc;
+        return insert_block(worker, entry); });
+}
+
+void run_worker(int tid, uint64_t runs, const std::string &workload, const std::string &strategy, const std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code)
+{
+    return_code = -1;
+    std::mt19937 rng(~2025'07'08 + tid);
+    Worker worker = {tid, strategy};
+    if (!open_worker(worker, pragmas))
+        return;
+
+    uint64_t next_id = config.num_entries + tid * runs; // Ensure no id clash
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        int rc;
+        if (workload == "insert")
+        {
+            Entry entry = {next_id++, random_hash_string(rng, 44), rng() % 1000, 0};
+            rc = run_transaction(worker, true, [&]()
+                                 {
+                sqlite3_bind_int64(worker.stmt_insert_id, 1, entry.id);
+                sqlite3_bind_text(worker.stmt_insert_id, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+                sqlite3_bind_int64(worker.stmt_insert_id, 3, entry.size);
+                int rc = sqlite3_step(worker.stmt_insert_id);
+                sqlite3_reset(worker.stmt_insert_id);
+                return rc; });
+        }
+        else if (workload == "mixed" && rng() % 100 < MIXED_SELECT_PCT)
+        {
+            const Entry &entry = entries[rng() % entries.size()];
+            int64_t id;
+            rc = run_transaction(worker, false, [&]()
+                                 { return select_block(worker, entry, id); });
+            if (rc == 0 && !assert_value_matches(entry.id, (uint64_t)id, "Mixed select ID check"))
+                rc = -1;
+        }
+        else
+        {
+            // 50% chance of a new block
+            Entry entry = rng() % 2 == 0 ? entries[rng() % entries.size()] : Entry{(uint64_t)-1, random_hash_string(rng, 44), rng() % 1000, 0};
+            rc = select_or_insert(worker, entry);
+        }
+        if (rc != 0)
+            return;
+    }
+
+    close_worker(worker);
+    return_code = 0;
+}
+
+int measure(std::vector<Entry> &entries, Config &config, const std::string &workload, const std::string &strategy, const std::vector<std::string> &pragmas)
+{
+    // Copy the backed up database
+    auto copy_db = []()
+    {
+        std::filesystem::remove(DBPATH + "-shm");
+        std::filesystem::remove(DBPATH + "-wal");
+        std::filesystem::copy_file(DBPATH + ".backup", DBPATH, std::filesystem::copy_options::overwrite_existing);
+        sqlite3 *db;
+        sqlite3_open(DBPATH.c_str(), &db);
+        sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+        sqlite3_wal_checkpoint(db, nullptr);
+        sqlite3_close(db);
+    };
+
+    std::vector<int> return_codes(config.num_threads);
+    auto run_threads = [&](uint64_t runs) -> int
+    {
+        lock_stats.assign(config.num_threads, LockStats());
+        std::vector<std::thread> threads;
+        for (int i = 0; i < config.num_threads; i++)
+            threads.emplace_back(run_worker, i, runs / config.num_threads, std::cref(workload), std::cref(strategy), std::cref(pragmas), std::ref(config), std::cref(entries), std::ref(return_codes[i]));
+        for (auto &thread : threads)
+            thread.join();
+        for (auto &return_code : return_codes)
+            if (return_code != 0)
+                return -1;
+        return 0;
+    };
+
+    copy_db();
+    if (run_threads(config.num_warmup) != 0)
+        return -1;
+
+    copy_db();
+    // CPU time of the process, which includes the time burnt spinning on SQLITE_BUSY
+    std::clock_t cpu_begin = std::clock();
+    auto begin = std::chrono::high_resolution_clock::now();
+    if (run_threads(config.num_repetitions) != 0)
+        return -1;
+    uint64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - begin).count();
+    uint64_t cpu_us = uint64_t(std::clock() - cpu_begin) * 1'000'000 / CLOCKS_PER_SEC;
+
+    LockStats total;
+    for (auto &stats : lock_stats)
+    {
+        total.transactions += stats.transactions;
+        total.busy_retries += stats.busy_retries;
+        total.busy_wait_ns += stats.busy_wait_ns;
+        total.queue_wait_ns += stats.queue_wait_ns;
+        total.aborts += stats.aborts;
+    }
+    uint64_t ops = config.num_repetitions / config.num_threads * config.num_threads;
+
+    std::cout << "Lock manager " << workload << " " << strategy << " with " << config.num_threads << " threads: "
+              << float(ops) / (float(time_us) / 1000) << " kop/s, "
+              << total.busy_retries << " busy retries, "
+              << total.aborts << " aborts, "
+              << total.busy_wait_ns / 1000 << " us busy, "
+              << total.queue_wait_ns / 1000 << " us queued, "
+              << cpu_us << " us CPU" << std::endl;
+
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    bool emit_header = !std::filesystem::exists("reports/lockmanager.csv");
+    std::ofstream report_file("reports/lockmanager.csv", std::ios::app);
+    if (emit_header)
+        report_file << "num_entries,num_warmup,num_repetitions,num_threads,workload,strategy,ops,time_us,cpu_us,kop_s,transactions,busy_retries,busy_wait_us,queue_wait_us,aborts\n";
+    report_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << config.num_threads << ","
+                << workload << ","
+                << strategy << ","
+                << ops << ","
+                << time_us << ","
+                << cpu_us << ","
+                << float(ops) / (float(time_us) / 1000) << ","
+                << total.transactions << ","
+                << total.busy_retries << ","
+                << total.busy_wait_ns / 1000 << ","
+                << total.queue_wait_ns / 1000 << ","
+                << total.aborts << "\n";
+
+    return 0;
+}
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    std::vector<std::string> pragmas = {"PRAGMA synchronous = NORMAL;", "PRAGMA temp_store = MEMORY;", "PRAGMA cache_size = -64000;"};
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    auto db = setup_database(table_queries, config);
+    sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(db, rng, entries, config.num_entries) != 0)
+        return -1;
+    sqlite3_close(db);
+    std::filesystem::copy(DBPATH, DBPATH + ".backup", std::filesystem::copy_options::overwrite_existing);
+
+    // One reader per core, as more only adds context switches
+    lock_manager.max_readers = std::max(1u, std::thread::hardware_concurrency());
+
+    for (const auto &workload : WORKLOADS)
+    {
+        for (const auto &strategy : STRATEGIES)
+        {
+            if (measure(entries, config, workload, strategy, pragmas) != 0)
+            {
+                std::cerr << "Error during " << workload << " with " << strategy << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal", DBPATH + ".backup"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
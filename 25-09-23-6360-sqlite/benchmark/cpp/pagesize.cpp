@@ -0,0 +1,422 @@
+#include "shared.hpp"
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+int measure(
+    sqlite3 *db,
+    Config &config,
+    std::mt19937 &rng,
+    const std::function<int(sqlite3 *, const Entry &, uint64_t, const std::string &)> &f,
+    const std::string &report_name,
+    const int create_entry, // Percentage probability of creating a new entry
+    const std::vector<Entry> &entries)
+{
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    uint64_t next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_warmup; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[i % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (f(db, entry, i, "Warmup") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    std::vector<uint64_t> times;
+    next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_repetitions; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()];
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        if (f(db, entry, i, "Actual") != 0)
+            return -1;
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    report_stats(config, times, report_name);
+
+    return 0;
+}
+
+int measure_select(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string sql = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare select statement"))
+        return -1;
+
+    auto select_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_text(stmt, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt), db, prefix + " query execution " + std::to_string(i)))
+            return -1;
+        if (!assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt, 0), prefix + " ID check"))
+            return -1;
+        sqlite3_reset(stmt);
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, select_inner, report_name, -1, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt);
+
+    return 0;
+}
+
+int measure_xor1(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string
+        sql_select = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_insert = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);";
+    sqlite3_stmt *stmt_select, *stmt_insert;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor select statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert.c_str(), -1, &stmt_insert, nullptr), db, "Prepare xor insert statement"))
+        return -1;
+
+    auto xor_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_select, 2, entry.size);
+        auto rc = sqlite3_step(stmt_select);
+        if (!assert_sqlite_return_code(rc, db, prefix + " xor1 query execution " + std::to_string(i)))
+            return -1;
+        auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_select, 0) : -1;
+        sqlite3_reset(stmt_select);
+
+        if (found_id == -1)
+        {
+            // Not found, insert
+            sqlite3_bind_int64(stmt_insert, 1, entry.id);
+            sqlite3_bind_text(stmt_insert, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_insert, 3, entry.size);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_insert), db, prefix + " xor1 insert " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_insert);
+        }
+        else
+        {
+            if (!assert_value_matches(entry.id, (uint64_t)found_id, prefix + " xor1 ID check"))
+                return -1;
+        }
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, xor_inner, report_name, 50, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt_select);
+    sqlite3_finalize(stmt_insert);
+
+    return 0;
+}
+
+uint64_t blockset_count(uint64_t blockset_id, const std::vector<Entry> &entries)
+{
+    uint64_t count = 0;
+    for (const auto &entry : entries)
+    {
+        if (entry.blockset_id == blockset_id)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+int measure_join(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string sql = "SELECT Block.ID, Block.Hash, Block.Size FROM Block JOIN BlocksetEntry ON BlocksetEntry.BlockID = Block.ID WHERE BlocksetEntry.BlocksetID = ?;";
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare join statement"))
+        return -1;
+
+    uint64_t max_blockset = 0;
+    for (auto &entry : entries)
+    {
+        max_blockset = std::max(max_blockset, entry.blockset_id);
+    }
+
+    auto join_inner = [=](sqlite3 *db, uint64_t blockset_id, uint64_t expected_count, const std::string &prefix) -> int
+    {
+        sqlite3_bind_int64(stmt, 1, blockset_id);
+        uint64_t count = 0;
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            // Process the row
+            auto found_id = sqlite3_column_int64(stmt, 0);
+            auto found_hash = std::string((const char *)sqlite3_column_text(stmt, 1));
+            auto found_size = (uint64_t)sqlite3_column_int64(stmt, 2);
+            auto entry = entries[found_id];
+            if (!assert_value_matches(entry.hash, found_hash, "Hash check"))
+                return -1;
+            if (!assert_value_matches(entry.size, found_size, "Size check"))
+                return -1;
+            if (!assert_value_matches(entry.blockset_id, blockset_id, "Blockset ID check"))
+                return -1;
+            count++;
+        }
+        if (!assert_value_matches(expected_count, count, "Blockset count check"))
+            return -1;
+        sqlite3_reset(stmt);
+
+        return 0;
+    };
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    for (uint64_t i = 0; i < config.num_warmup; i++)
+    {
+        uint64_t blockset_id = (rng() % max_blockset) + 1;
+        uint64_t expected_count = blockset_count(blockset_id, entries);
+        if (join_inner(db, blockset_id, expected_count, "Warmup") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    std::vector<uint64_t> times;
+    uint64_t total_rows = 0;
+    while (total_rows < config.num_repetitions)
+    {
+        uint64_t blockset_id = (rng() % max_blockset) + 1;
+        uint64_t expected_count = blockset_count(blockset_id, entries);
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        if (join_inner(db, blockset_id, expected_count, "Actual") != 0)
+            return -1;
+        auto end = std::chrono::high_resolution_clock::now();
+
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / expected_count);
+        total_rows += expected_count;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_finalize(stmt);
+
+    report_stats(config, times, report_name);
+
+    return 0;
+}
+int report_dataset(Config &config, const std::string &dataset, int64_t page_size, int64_t fill_us)
+{
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    bool emit_header = !std::filesystem::exists("reports/pagesize_datasets.csv");
+    std::ofstream report_file("reports/pagesize_datasets.csv", std::ios::app);
+    if (emit_header)
+        report_file << "num_entries,dataset,page_size,fill_us,db_bytes\n";
+    report_file << config.num_entries << ","
+                << dataset << ","
+                << page_size << ","
+                << fill_us << ","
+                << std::filesystem::file_size(DBPATH) << "\n";
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    // Each dataset is built from scratch with its creation pragmas, and its name is part of every report name. auto_vacuum is only
+    // varied at the default page size, to keep the number of rebuilds down.
+    std::vector<std::tuple<std::string, std::vector<std::string>>> datasets = {
+        {"page_1K", {"PRAGMA page_size = 1024;"}},
+        {"page_2K", {"PRAGMA page_size = 2048;"}},
+        {"page_4K", {"PRAGMA page_size = 4096;"}},
+        {"page_8K", {"PRAGMA page_size = 8192;"}},
+        {"page_16K", {"PRAGMA page_size = 16384;"}},
+        {"page_32K", {"PRAGMA page_size = 32768;"}},
+        {"page_64K", {"PRAGMA page_size = 65536;"}},
+        {"page_4K_auto_vacuum_full", {"PRAGMA page_size = 4096;", "PRAGMA auto_vacuum = FULL;"}},
+        {"page_4K_auto_vacuum_incremental", {"PRAGMA page_size = 4096;", "PRAGMA auto_vacuum = INCREMENTAL;"}}};
+
+    // Given in KiB, so every page size gets the same amount of memory
+    std::vector<std::tuple<std::string, int>> cache_sizes = {
+        {"cache_size_2M", -2000},
+        {"cache_size_8M", -8000},
+        {"cache_size_32M", -32000},
+        {"cache_size_128M", -128000}};
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    for (auto &[dataset, creation_pragmas] : datasets)
+    {
+        auto db = setup_database(table_queries, config, creation_pragmas);
+
+        sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+        sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+        sqlite3_exec(db, "CREATE INDEX BlocksetBlocksetID ON Blockset(ID);", nullptr, nullptr, nullptr);
+
+        std::vector<Entry> entries;
+        std::mt19937 rng(2025'07'08);
+        auto fill_begin = std::chrono::high_resolution_clock::now();
+        if (fill(db, rng, entries, config.num_entries) != 0)
+            return -1;
+        auto fill_end = std::chrono::high_resolution_clock::now();
+
+        // Read back, as SQLite silently ignores a page size it cannot use
+        sqlite3_stmt *stmt;
+        sqlite3_prepare_v2(db, "PRAGMA page_size;", -1, &stmt, nullptr);
+        sqlite3_step(stmt);
+        int64_t page_size = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        report_dataset(config, dataset, page_size, std::chrono::duration_cast<std::chrono::microseconds>(fill_end - fill_begin).count());
+
+        for (auto &[cache_name, cache_size] : cache_sizes)
+        {
+            sqlite3_open(DBPATH.c_str(), &db);
+            rng.seed(~2025'07'08);
+            std::string pragma = "PRAGMA cache_size = " + std::to_string(cache_size) + ";";
+            sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr);
+
+            std::string suffix = dataset + "_" + cache_name;
+            if (measure_select(db, config, rng, entries, "pagesize_select_" + suffix) != 0)
+                return -1;
+            if (measure_xor1(db, config, rng, entries, "pagesize_xor1_" + suffix) != 0)
+                return -1;
+            if (measure_join(db, config, rng, entries, "pagesize_join_" + suffix) != 0)
+                return -1;
+
+            sqlite3_close(db);
+        }
+    }
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
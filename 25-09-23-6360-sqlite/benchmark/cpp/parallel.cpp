@@ -1,5 +1,11 @@
 #include "shared.hpp"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
 
 struct Entry
@@ -10,11 +16,90 @@ struct Entry
     uint64_t blockset_id;
 };
 
-sqlite3 *open_connection(const std::vector<std::string> &pragmas)
+// Per thread counters for the time spent holding the write lock, from the write being granted until COMMIT returns.
+struct alignas(64) ThreadStats
+{
+    uint64_t write_transactions = 0;
+    uint64_t write_lock_ns = 0;
+    std::vector<uint64_t> latencies; // Per operation latency, only recorded by the workloads compared against the writer thread
+};
+
+std::vector<ThreadStats> thread_stats;
+
+void record_write_lock(int tid, std::chrono::high_resolution_clock::time_point begin)
+{
+    auto end = std::chrono::high_resolution_clock::now();
+    thread_stats[tid].write_transactions++;
+    thread_stats[tid].write_lock_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+}
+
+void record_latency(int tid, std::chrono::high_resolution_clock::time_point begin)
+{
+    auto end = std::chrono::high_resolution_clock::now();
+    thread_stats[tid].latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+}
+
+// Shared ID counter for a table. Threads lease ranges of ID_LEASE_SIZE IDs from it, and the high-water mark is persisted in IdLease on every lease.
+struct IdAllocator
+{
+    std::string name;
+    std::atomic<uint64_t> next;
+};
+
+struct IdRange
+{
+    uint64_t next = 0;
+    uint64_t end = 0;
+};
+
+const uint64_t ID_LEASE_SIZE = 1024;
+const std::string CREATE_IDLEASE_TABLE = "CREATE TABLE IdLease (Name TEXT PRIMARY KEY, NextID INTEGER NOT NULL);";
+
+IdAllocator block_ids{"Block", 0}, blockset_ids{"Blockset", 0};
+
+// Makes sure that range.next is a usable ID, leasing a new range if the current one is exhausted. Must be called outside of a transaction.
+int lease_id(int tid, IdAllocator &allocator, IdRange &range, sqlite3 *db, sqlite3_stmt *stmt_persist)
+{
+    if (range.next < range.end)
+        return 0;
+
+    uint64_t start = allocator.next.fetch_add(ID_LEASE_SIZE);
+    sqlite3_bind_int64(stmt_persist, 1, start + ID_LEASE_SIZE);
+    sqlite3_bind_text(stmt_persist, 2, allocator.name.c_str(), allocator.name.size(), SQLITE_STATIC);
+    int rc;
+    std::chrono::high_resolution_clock::time_point lock_begin;
+    do
+    {
+        lock_begin = std::chrono::high_resolution_clock::now();
+        rc = sqlite3_step(stmt_persist);
+    } while (rc == SQLITE_BUSY);
+    if (!assert_sqlite_return_code(rc, db, "persist " + allocator.name + " lease"))
+        return -1;
+    sqlite3_reset(stmt_persist);
+    record_write_lock(tid, lock_begin);
+
+    range.next = start;
+    range.end = start + ID_LEASE_SIZE;
+
+    return 0;
+}
+
+// Open flags used by the reader workloads (select and join), varied by measure_reader_modes to compare the mutex and cache modes.
+int reader_open_flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+// Lookaside setting applied to every connection, from --lookaside
+std::string connection_lookaside = "default";
+
+// File growth settings applied to every connection, from --chunk-size, --size-hint and --wal-size-hint
+Config connection_file_config;
+
+sqlite3 *open_connection(const std::vector<std::string> &pragmas, int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)
 {
     sqlite3 *db;
-    // sqlite3_open_v2(DBPATH.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
-    sqlite3_open(DBPATH.c_str(), &db);
+    if (!assert_sqlite_return_code(sqlite3_open_v2(DBPATH.c_str(), &db, flags, nullptr), db, "Open connection"))
+        return nullptr;
+    if (!configure_lookaside(db, connection_lookaside))
+        return nullptr;
 
     // Read the current timeout
     if (!assert_sqlite_return_code(sqlite3_exec(db, "PRAGMA busy_timeout;", nullptr, nullptr, nullptr), db, "Get busy_timeout"))
@@ -31,6 +116,10 @@ sqlite3 *open_connection(const std::vector<std::string> &pragmas)
             return nullptr;
     }
 
+    // The file controls belong to this connection's file handles, not to the database
+    if (!apply_file_controls(db, connection_file_config))
+        return nullptr;
+
     // Reset timeout
     std::string busy_timeout_sql = "PRAGMA busy_timeout = " + std::to_string(busy_timeout) + ";";
     if (!assert_sqlite_return_code(sqlite3_exec(db, busy_timeout_sql.c_str(), nullptr, nullptr, nullptr), db, "Reset busy_timeout"))
@@ -39,6 +128,186 @@ sqlite3 *open_connection(const std::vector<std::string> &pragmas)
     return db;
 }
 
+// Writer thread mode: the worker threads only read on their own connections, and hand every write to a single writer thread,
+// which owns the only writing connection and commits the queued writes in groups. Requests are passed on an intrusive
+// lock-free multi-producer single-consumer queue (Vyukov), and completed through a promise once their group is committed.
+struct Writer;
+
+struct WriteRequest
+{
+    std::function<int64_t(Writer &)> apply; // Runs inside the writer's transaction, a negative result signals an error
+    std::promise<int64_t> done;
+    std::atomic<WriteRequest *> next = nullptr;
+};
+
+struct WriteQueue
+{
+    WriteRequest stub;
+    std::atomic<WriteRequest *> head = &stub;
+    WriteRequest *tail = &stub; // Only touched by the consumer
+
+    void push(WriteRequest *request)
+    {
+        request->next.store(nullptr, std::memory_order_relaxed);
+        WriteRequest *prev = head.exchange(request, std::memory_order_acq_rel);
+        prev->next.store(request, std::memory_order_release);
+    }
+
+    // Returns nullptr if the queue is empty, or if a producer is halfway through a push.
+    WriteRequest *pop()
+    {
+        WriteRequest *current = tail;
+        WriteRequest *next = current->next.load(std::memory_order_acquire);
+        if (current == &stub)
+        {
+            if (next == nullptr)
+                return nullptr;
+            tail = next;
+            current = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr)
+        {
+            tail = next;
+            return current;
+        }
+        if (current != head.load(std::memory_order_acquire))
+            return nullptr;
+        push(&stub);
+        next = current->next.load(std::memory_order_acquire);
+        if (next != nullptr)
+        {
+            tail = next;
+            return current;
+        }
+        return nullptr;
+    }
+};
+
+struct Writer
+{
+    sqlite3 *db = nullptr;
+    std::unordered_map<std::string, sqlite3_stmt *> statements;
+    WriteQueue queue;
+    std::atomic<bool> running = false;
+    std::atomic<uint64_t> signals = 0; // Bumped after every push and at the stop, the writer parks on it while the queue is empty
+    uint64_t groups = 0;
+    uint64_t requests = 0;
+
+    sqlite3_stmt *statement(const std::string &sql)
+    {
+        auto it = statements.find(sql);
+        if (it != statements.end())
+            return it->second;
+        sqlite3_stmt *stmt;
+        if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare writer statement " + sql))
+            return nullptr;
+        statements[sql] = stmt;
+        return stmt;
+    }
+
+    void signal()
+    {
+        signals.fetch_add(1, std::memory_order_release);
+        signals.notify_one();
+    }
+};
+
+const uint64_t WRITER_GROUP_SIZE = 256;
+
+Writer writer;
+
+// Drains the queue until stopped, committing up to WRITER_GROUP_SIZE requests per transaction. Closes the writer connection when done.
+void run_writer(int &return_code)
+{
+    return_code = 0;
+    std::vector<std::pair<std::promise<int64_t>, int64_t>> group;
+    while (true)
+    {
+        // Read the flag before popping, so requests queued before the stop are still drained. Likewise the signal count, so a push
+        // completing after the pop, including one a producer was halfway through, wakes the writer.
+        uint64_t signals = writer.signals.load(std::memory_order_acquire);
+        bool stopping = !writer.running.load();
+        WriteRequest *request = writer.queue.pop();
+        if (request == nullptr)
+        {
+            if (stopping)
+                break;
+            writer.signals.wait(signals, std::memory_order_acquire);
+            continue;
+        }
+
+        int rc;
+        do
+        {
+            rc = sqlite3_exec(writer.db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
+        } while (rc == SQLITE_BUSY);
+        while (request != nullptr)
+        {
+            int64_t result = request->apply(writer);
+            // The producer may return as soon as the promise is completed, so nothing is read from the request after this
+            group.emplace_back(std::move(request->done), result);
+            if (group.size() == WRITER_GROUP_SIZE)
+                break;
+            request = writer.queue.pop();
+        }
+        bool committed = assert_sqlite_return_code(sqlite3_exec(writer.db, "COMMIT;", nullptr, nullptr, nullptr), writer.db, "writer commit");
+        if (!committed)
+            return_code = -1;
+
+        writer.groups++;
+        writer.requests += group.size();
+        for (auto &[done, result] : group)
+            done.set_value(committed ? result : -1);
+        group.clear();
+    }
+
+    for (auto &[sql, stmt] : writer.statements)
+        sqlite3_finalize(stmt);
+    writer.statements.clear();
+    sqlite3_close(writer.db);
+    writer.db = nullptr;
+}
+
+// Queues a write and blocks until the group it ended up in has been committed.
+int64_t submit_write(std::function<int64_t(Writer &)> apply)
+{
+    WriteRequest request;
+    request.apply = std::move(apply);
+    auto result = request.done.get_future();
+    writer.queue.push(&request);
+    writer.signal();
+    return result.get();
+}
+
+// Inserts the block unless a request earlier in the queue already did, and returns its ID.
+int64_t writer_insert_block(Writer &w, const Entry &entry)
+{
+    sqlite3_stmt *stmt_select = w.statement("SELECT ID FROM Block WHERE Hash = ? AND Size = ?;");
+    sqlite3_stmt *stmt_insert = w.statement("INSERT INTO Block (Hash, Size) VALUES (?, ?);");
+    if (stmt_select == nullptr || stmt_insert == nullptr)
+        return -1;
+
+    sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt_select, 2, entry.size);
+    int rc = sqlite3_step(stmt_select);
+    int64_t id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_select, 0) : -1;
+    sqlite3_reset(stmt_select);
+    if (!assert_sqlite_return_code(rc, w.db, "writer check block"))
+        return -1;
+    if (id != -1)
+        return id;
+
+    sqlite3_bind_text(stmt_insert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt_insert, 2, entry.size);
+    rc = sqlite3_step(stmt_insert);
+    sqlite3_reset(stmt_insert);
+    if (!assert_sqlite_return_code(rc, w.db, "writer insert block"))
+        return -1;
+
+    return sqlite3_last_insert_rowid(w.db);
+}
+
 int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
 {
     auto begin = std::chrono::high_resolution_clock::now();
@@ -189,7 +458,7 @@ void measure_select(int tid, uint64_t runs, std::vector<std::string> &pragmas, C
 {
     num_rows = 0;
     std::mt19937 rng(~2025'07'08 + tid);
-    sqlite3 *db = open_connection(pragmas);
+    sqlite3 *db = open_connection(pragmas, reader_open_flags);
     if (db == nullptr)
     {
         return_code = -1;
@@ -285,7 +554,10 @@ void measure_xor1(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
 
     for (uint64_t i = 0; i < runs; i++)
     {
+        auto op_begin = std::chrono::high_resolution_clock::now();
         sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        std::chrono::high_resolution_clock::time_point lock_begin;
+        bool wrote = false;
         Entry entry;
         bool create_new = (rng() % 100) >= 50;
         if (create_new)
@@ -324,6 +596,7 @@ void measure_xor1(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
                 // Not found, insert
                 sqlite3_bind_text(stmt_insert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
                 sqlite3_bind_int64(stmt_insert, 2, entry.size);
+                lock_begin = std::chrono::high_resolution_clock::now();
                 rc = sqlite3_step(stmt_insert);
                 if (rc != SQLITE_BUSY)
                 {
@@ -334,6 +607,7 @@ void measure_xor1(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
                     }
                     sqlite3_reset(stmt_insert);
                     num_rows += 2;
+                    wrote = true;
                     break;
                 }
                 else
@@ -365,6 +639,9 @@ void measure_xor1(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
         }
 
         sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        if (wrote)
+            record_write_lock(tid, lock_begin);
+        record_latency(tid, op_begin);
     }
 
     sqlite3_finalize(stmt_select);
@@ -375,7 +652,8 @@ void measure_xor1(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
     return;
 }
 
-void measure_xor2(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+// xor1 with the ID of a new block taken from a leased range before the transaction starts, instead of being assigned by SQLite.
+void measure_xor1_leased(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
 {
     num_rows = 0;
     std::mt19937 rng(~2025'07'08 + tid);
@@ -386,9 +664,10 @@ void measure_xor2(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
         return;
     }
     std::string
-        sql_insert = "INSERT OR IGNORE INTO Block (Hash, Size) VALUES (?, ?);",
-        sql_select = "SELECT * FROM Block WHERE Hash = ? AND Size = ?;";
-    sqlite3_stmt *stmt_insert, *stmt_select;
+        sql_select = "SELECT ID FROM Block WHERE (Hash = ? AND Size = ?);",
+        sql_insert = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_persist = "UPDATE IdLease SET NextID = MAX(NextID, ?) WHERE Name = ?;";
+    sqlite3_stmt *stmt_select, *stmt_insert, *stmt_persist;
     if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor select statement"))
     {
         return_code = -1;
@@ -399,10 +678,25 @@ void measure_xor2(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
         return_code = -1;
         return;
     }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_persist.c_str(), -1, &stmt_persist, nullptr), db, "Prepare persist lease statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    IdRange range;
 
     for (uint64_t i = 0; i < runs; i++)
     {
+        // The ID is only consumed if the block ends up being inserted
+        if (lease_id(tid, block_ids, range, db, stmt_persist) != 0)
+        {
+            return_code = -1;
+            return;
+        }
+
         sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        std::chrono::high_resolution_clock::time_point lock_begin;
+        bool wrote = false;
         Entry entry;
         bool create_new = (rng() % 100) >= 50;
         if (create_new)
@@ -417,134 +711,820 @@ void measure_xor2(int tid, uint64_t runs, std::vector<std::string> &pragmas, Con
         {
             entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
         }
-        sqlite3_bind_text(stmt_insert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
-        sqlite3_bind_int64(stmt_insert, 2, entry.size);
-        int rc;
-        do
-        {
-            rc = sqlite3_step(stmt_insert);
-        } while (rc == SQLITE_BUSY);
-        if (!assert_sqlite_return_code(rc, db, "xor2 insert query execution " + std::to_string(i)))
-        {
-            return_code = -1;
-            return;
-        }
-        sqlite3_reset(stmt_insert);
-        sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
-        sqlite3_bind_int64(stmt_select, 2, entry.size);
-        do
-        {
-            rc = sqlite3_step(stmt_select);
-        } while (rc == SQLITE_BUSY);
 
-        if (!assert_sqlite_return_code(rc, db, "xor2 select query execution " + std::to_string(i)))
+        while (true)
         {
-            return_code = -1;
-            return;
+            sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_select, 2, entry.size);
+            int rc;
+            do
+            {
+                rc = sqlite3_step(stmt_select);
+            } while (rc == SQLITE_BUSY);
+
+            if (!assert_sqlite_return_code(rc, db, "xor1 leased query execution " + std::to_string(i)))
+            {
+                return_code = -1;
+                return;
+            }
+            auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_select, 0) : -1;
+            sqlite3_reset(stmt_select);
+
+            if (found_id == -1)
+            {
+                // Not found, insert with the leased ID
+                sqlite3_bind_int64(stmt_insert, 1, range.next);
+                sqlite3_bind_text(stmt_insert, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+                sqlite3_bind_int64(stmt_insert, 3, entry.size);
+                lock_begin = std::chrono::high_resolution_clock::now();
+                rc = sqlite3_step(stmt_insert);
+                if (rc != SQLITE_BUSY)
+                {
+                    if (!assert_sqlite_return_code(rc, db, "xor1 leased insert " + std::to_string(i)))
+                    {
+                        return_code = -1;
+                        return;
+                    }
+                    sqlite3_reset(stmt_insert);
+                    range.next++;
+                    num_rows += 2;
+                    wrote = true;
+                    break;
+                }
+                else
+                {
+                    // Connection is busy, another statement is inserting, which means the read value is no longer valid
+                    sqlite3_reset(stmt_insert);
+                    if (!assert_sqlite_return_code(sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr), db, "xor1 leased rollback"))
+                    {
+                        return_code = -1;
+                        return;
+                    }
+                    if (!assert_sqlite_return_code(sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr), db, "xor1 leased begin transaction"))
+                    {
+                        return_code = -1;
+                        return;
+                    }
+                }
+            }
+            else
+            {
+                if (!assert_value_matches(entry.id, (uint64_t)found_id, "xor1 leased ID check"))
+                {
+                    return_code = -1;
+                    return;
+                }
+                num_rows++;
+                break;
+            }
         }
-        sqlite3_reset(stmt_select);
+
         sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-        num_rows += 2;
-    };
+        if (wrote)
+            record_write_lock(tid, lock_begin);
+    }
 
-    sqlite3_finalize(stmt_insert);
     sqlite3_finalize(stmt_select);
+    sqlite3_finalize(stmt_insert);
+    sqlite3_finalize(stmt_persist);
     sqlite3_close(db);
 
     return_code = 0;
     return;
 }
 
-uint64_t blockset_count(uint64_t blockset_id, const std::vector<Entry> &entries)
+// Staged ingest: each thread inserts into its own TEMP table, which takes no lock on the main database, and merges it into Block
+// in one write transaction every STAGING_MERGE_ROWS rows and when done. The merge is an INSERT OR IGNORE, so it needs the UNIQUE
+// (Hash, Size) index, which is also what removes the blocks staged by more than one thread.
+const uint64_t STAGING_MERGE_ROWS = 4096;
+
+struct Staging
 {
-    uint64_t count = 0;
-    for (const auto &entry : entries)
+    sqlite3_stmt *stmt_stage = nullptr, *stmt_merge = nullptr, *stmt_clear = nullptr;
+    uint64_t rows = 0;
+};
+
+bool open_staging(sqlite3 *db, Staging &staging)
+{
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "CREATE TEMP TABLE Staging (ID INTEGER, Hash TEXT NOT NULL, Size INTEGER NOT NULL);", nullptr, nullptr, nullptr), db, "Create staging table"))
+        return false;
+    std::string
+        sql_stage = "INSERT INTO temp.Staging(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_merge = "INSERT OR IGNORE INTO main.Block(ID, Hash, Size) SELECT ID, Hash, Size FROM temp.Staging ORDER BY Hash;",
+        sql_clear = "DELETE FROM temp.Staging;";
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_stage.c_str(), -1, &staging.stmt_stage, nullptr), db, "Prepare stage statement"))
+        return false;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_merge.c_str(), -1, &staging.stmt_merge, nullptr), db, "Prepare merge statement"))
+        return false;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_clear.c_str(), -1, &staging.stmt_clear, nullptr), db, "Prepare clear staging statement"))
+        return false;
+    return true;
+}
+
+void close_staging(Staging &staging)
+{
+    sqlite3_finalize(staging.stmt_stage);
+    sqlite3_finalize(staging.stmt_merge);
+    sqlite3_finalize(staging.stmt_clear);
+}
+
+// Moves the staged rows into Block, holding the write lock for the duration of the merge only
+int merge_staging(int tid, sqlite3 *db, Staging &staging)
+{
+    if (staging.rows == 0)
+        return 0;
+    int rc;
+    do
     {
-        if (entry.blockset_id == blockset_id)
-        {
-            count++;
-        }
-    }
-    return count;
+        rc = sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
+    } while (rc == SQLITE_BUSY);
+    if (!assert_sqlite_return_code(rc, db, "Begin merge"))
+        return -1;
+    auto lock_begin = std::chrono::high_resolution_clock::now();
+    if (!assert_sqlite_return_code(sqlite3_step(staging.stmt_merge), db, "Merge staging"))
+        return -1;
+    sqlite3_reset(staging.stmt_merge);
+    if (!assert_sqlite_return_code(sqlite3_step(staging.stmt_clear), db, "Clear staging"))
+        return -1;
+    sqlite3_reset(staging.stmt_clear);
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr), db, "Commit merge"))
+        return -1;
+    record_write_lock(tid, lock_begin);
+    staging.rows = 0;
+    return 0;
 }
 
-void measure_join(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+// Stages a block, with the ID left to SQLite when id is -1, and merges when STAGING_MERGE_ROWS rows are staged
+int stage_block(int tid, sqlite3 *db, Staging &staging, int64_t id, const Entry &entry)
+{
+    if (id == -1)
+        sqlite3_bind_null(staging.stmt_stage, 1);
+    else
+        sqlite3_bind_int64(staging.stmt_stage, 1, id);
+    sqlite3_bind_text(staging.stmt_stage, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(staging.stmt_stage, 3, entry.size);
+    if (!assert_sqlite_return_code(sqlite3_step(staging.stmt_stage), db, "Stage block"))
+        return -1;
+    sqlite3_reset(staging.stmt_stage);
+    if (++staging.rows >= STAGING_MERGE_ROWS)
+        return merge_staging(tid, db, staging);
+    return 0;
+}
+
+// insert through the staging table
+void measure_insert_staged(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
 {
     num_rows = 0;
+    return_code = -1;
     std::mt19937 rng(~2025'07'08 + tid);
     sqlite3 *db = open_connection(pragmas);
     if (db == nullptr)
-    {
-        return_code = -1;
         return;
-    }
-    std::string sql = "SELECT Block.ID, Block.Hash, Block.Size FROM Block JOIN BlocksetEntry ON BlocksetEntry.BlockID = Block.ID WHERE BlocksetEntry.BlocksetID = ?;";
-    sqlite3_stmt *stmt;
-    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare join statement"))
-    {
-        return_code = -1;
+    Staging staging;
+    if (!open_staging(db, staging))
         return;
-    }
 
-    uint64_t max_blockset = 0;
-    for (auto &entry : entries)
+    uint64_t next_id = config.num_entries + tid * runs; // Ensure no id clash
+    for (uint64_t i = 0; i < runs; i++)
     {
-        max_blockset = std::max(max_blockset, entry.blockset_id);
+        Entry entry = {
+            next_id++,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            0};
+        if (stage_block(tid, db, staging, entry.id, entry) != 0)
+            return;
     }
+    if (merge_staging(tid, db, staging) != 0)
+        return;
 
-    while (true)
-    {
-        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
-        uint64_t blockset_id = (rng() % max_blockset) + 1;
-        // TODO when verifying (i.e. not benchmarking), uncomment the following line and the later check.
-        // uint64_t expected_count = blockset_count(blockset_id, entries);
-        sqlite3_bind_int64(stmt, 1, blockset_id);
+    close_staging(staging);
+    sqlite3_close(db);
+
+    num_rows = runs; // Number of rows inserted
+    return_code = 0;
+}
+
+// xor1 through the staging table. A missing block is staged instead of inserted, so its ID is only known after the merge.
+void measure_xor1_staged(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    return_code = -1;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+        return;
+    Staging staging;
+    if (!open_staging(db, staging))
+        return;
+    std::string sql_select = "SELECT ID FROM main.Block WHERE (Hash = ? AND Size = ?);";
+    sqlite3_stmt *stmt_select;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor staged select statement"))
+        return;
+
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        auto op_begin = std::chrono::high_resolution_clock::now();
+        Entry entry;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_select, 2, entry.size);
+        int rc;
+        do
+        {
+            rc = sqlite3_step(stmt_select);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "xor1 staged query execution " + std::to_string(i)))
+            return;
+        auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_select, 0) : -1;
+        sqlite3_reset(stmt_select);
+
+        if (found_id == -1)
+        {
+            if (stage_block(tid, db, staging, -1, entry) != 0)
+                return;
+            num_rows += 2;
+        }
+        else
+        {
+            if (!assert_value_matches(entry.id, (uint64_t)found_id, "xor1 staged ID check"))
+                return;
+            num_rows++;
+        }
+        record_latency(tid, op_begin);
+    }
+    if (merge_staging(tid, db, staging) != 0)
+        return;
+
+    sqlite3_finalize(stmt_select);
+    close_staging(staging);
+    sqlite3_close(db);
+
+    return_code = 0;
+}
+
+void measure_xor2(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string
+        sql_insert = "INSERT OR IGNORE INTO Block (Hash, Size) VALUES (?, ?);",
+        sql_select = "SELECT * FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt_insert, *stmt_select;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor select statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert.c_str(), -1, &stmt_insert, nullptr), db, "Prepare xor insert statement"))
+    {
+        return_code = -1;
+        return;
+    }
+
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        auto op_begin = std::chrono::high_resolution_clock::now();
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        Entry entry;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+        sqlite3_bind_text(stmt_insert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_insert, 2, entry.size);
+        int rc;
+        do
+        {
+            rc = sqlite3_step(stmt_insert);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "xor2 insert query execution " + std::to_string(i)))
+        {
+            return_code = -1;
+            return;
+        }
+        sqlite3_reset(stmt_insert);
+        sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_select, 2, entry.size);
+        do
+        {
+            rc = sqlite3_step(stmt_select);
+        } while (rc == SQLITE_BUSY);
+
+        if (!assert_sqlite_return_code(rc, db, "xor2 select query execution " + std::to_string(i)))
+        {
+            return_code = -1;
+            return;
+        }
+        sqlite3_reset(stmt_select);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        record_latency(tid, op_begin);
+        num_rows += 2;
+    };
+
+    sqlite3_finalize(stmt_insert);
+    sqlite3_finalize(stmt_select);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+// xor2 as one INSERT ... ON CONFLICT DO NOTHING, which only needs the select when the block exists. Runs on the .unique copy.
+void measure_xor3(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string
+        sql_insert = "INSERT INTO Block (Hash, Size) VALUES (?, ?) ON CONFLICT (Hash, Size) DO NOTHING RETURNING ID;",
+        sql_select = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt_insert, *stmt_select;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert.c_str(), -1, &stmt_insert, nullptr), db, "Prepare xor3 insert statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor3 select statement"))
+    {
+        return_code = -1;
+        return;
+    }
+
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        Entry entry;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+        sqlite3_bind_text(stmt_insert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_insert, 2, entry.size);
+        int rc;
+        do
+        {
+            rc = sqlite3_step(stmt_insert);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "xor3 insert query execution " + std::to_string(i)))
+        {
+            return_code = -1;
+            return;
+        }
+        auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_insert, 0) : -1;
+        sqlite3_reset(stmt_insert);
+        num_rows++;
+
+        if (found_id == -1)
+        {
+            // Conflict, so the block already exists
+            sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_select, 2, entry.size);
+            do
+            {
+                rc = sqlite3_step(stmt_select);
+            } while (rc == SQLITE_BUSY);
+            if (!assert_sqlite_return_code(rc, db, "xor3 select query execution " + std::to_string(i)))
+            {
+                return_code = -1;
+                return;
+            }
+            found_id = sqlite3_column_int64(stmt_select, 0);
+            sqlite3_reset(stmt_select);
+            if (!assert_value_matches(entry.id, (uint64_t)found_id, "xor3 ID check"))
+            {
+                return_code = -1;
+                return;
+            }
+            num_rows++;
+        }
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+
+    sqlite3_finalize(stmt_insert);
+    sqlite3_finalize(stmt_select);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+// xor3 with a no-op DO UPDATE, so RETURNING gives the ID of an existing block as well and the select is never needed.
+void measure_xor3_update(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string sql_upsert = "INSERT INTO Block (Hash, Size) VALUES (?, ?) ON CONFLICT (Hash, Size) DO UPDATE SET ID = ID RETURNING ID;";
+    sqlite3_stmt *stmt_upsert;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_upsert.c_str(), -1, &stmt_upsert, nullptr), db, "Prepare xor3 upsert statement"))
+    {
+        return_code = -1;
+        return;
+    }
+
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        Entry entry;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+        sqlite3_bind_text(stmt_upsert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_upsert, 2, entry.size);
+        int rc;
+        do
+        {
+            rc = sqlite3_step(stmt_upsert);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "xor3 upsert query execution " + std::to_string(i)))
+        {
+            return_code = -1;
+            return;
+        }
+        if (!create_new && !assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt_upsert, 0), "xor3 upsert ID check"))
+        {
+            return_code = -1;
+            return;
+        }
+        sqlite3_reset(stmt_upsert);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        num_rows++;
+    }
+
+    sqlite3_finalize(stmt_upsert);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+uint64_t blockset_count(uint64_t blockset_id, const std::vector<Entry> &entries)
+{
+    uint64_t count = 0;
+    for (const auto &entry : entries)
+    {
+        if (entry.blockset_id == blockset_id)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void measure_join(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas, reader_open_flags);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string sql = "SELECT Block.ID, Block.Hash, Block.Size FROM Block JOIN BlocksetEntry ON BlocksetEntry.BlockID = Block.ID WHERE BlocksetEntry.BlocksetID = ?;";
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare join statement"))
+    {
+        return_code = -1;
+        return;
+    }
+
+    uint64_t max_blockset = 0;
+    for (auto &entry : entries)
+    {
+        max_blockset = std::max(max_blockset, entry.blockset_id);
+    }
+
+    while (true)
+    {
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        uint64_t blockset_id = (rng() % max_blockset) + 1;
+        // TODO when verifying (i.e. not benchmarking), uncomment the following line and the later check.
+        // uint64_t expected_count = blockset_count(blockset_id, entries);
+        sqlite3_bind_int64(stmt, 1, blockset_id);
         uint64_t count = 0;
         while (sqlite3_step(stmt) == SQLITE_ROW)
         {
-            // Process the row
-            auto found_id = sqlite3_column_int64(stmt, 0);
-            auto found_hash = std::string((const char *)sqlite3_column_text(stmt, 1));
-            auto found_size = (uint64_t)sqlite3_column_int64(stmt, 2);
-            auto entry = entries[found_id];
-            if (!assert_value_matches(entry.hash, found_hash, "Hash check"))
-            {
-                return_code = -1;
-                return;
-            }
-            if (!assert_value_matches(entry.size, found_size, "Size check"))
-            {
-                return_code = -1;
-                return;
-            }
-            if (!assert_value_matches(entry.blockset_id, blockset_id, "Blockset ID check"))
+            // Process the row
+            auto found_id = sqlite3_column_int64(stmt, 0);
+            auto found_hash = std::string((const char *)sqlite3_column_text(stmt, 1));
+            auto found_size = (uint64_t)sqlite3_column_int64(stmt, 2);
+            auto entry = entries[found_id];
+            if (!assert_value_matches(entry.hash, found_hash, "Hash check"))
+            {
+                return_code = -1;
+                return;
+            }
+            if (!assert_value_matches(entry.size, found_size, "Size check"))
+            {
+                return_code = -1;
+                return;
+            }
+            if (!assert_value_matches(entry.blockset_id, blockset_id, "Blockset ID check"))
+            {
+                return_code = -1;
+                return;
+            }
+            count++;
+        }
+        sqlite3_reset(stmt);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        // TODO this check is for verification
+        // if (!assert_value_matches(expected_count, count, "Blockset count check"))
+        //{
+        //     return_code = -1;
+        //     return;
+        // }
+        num_rows += count;
+        if (num_rows > runs)
+            break;
+    };
+
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string
+        sql_start_blockset = "INSERT INTO Blockset (Length) VALUES (0);",
+        sql_last_row = "SELECT last_insert_rowid();",
+        sql_check_block = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_insert_block = "INSERT INTO Block (Hash, Size) VALUES (?, ?);",
+        sql_insert_blockset_entry = "INSERT OR IGNORE INTO BlocksetEntry (BlocksetID, BlockID) VALUES (?, ?);",
+        sql_update_blockset = "UPDATE Blockset SET Length = Length + 1 WHERE ID = ?;";
+    sqlite3_stmt *stmt_start_blockset, *stmt_last_row, *stmt_check_block, *stmt_insert_block, *stmt_insert_blockset_entry, *stmt_update_blockset;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_start_blockset.c_str(), -1, &stmt_start_blockset, nullptr), db, "Prepare start blockset statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_last_row.c_str(), -1, &stmt_last_row, nullptr), db, "Prepare last row statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_check_block.c_str(), -1, &stmt_check_block, nullptr), db, "Prepare check block statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_block.c_str(), -1, &stmt_insert_block, nullptr), db, "Prepare insert block statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_blockset_entry.c_str(), -1, &stmt_insert_blockset_entry, nullptr), db, "Prepare insert blockset entry statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_update_blockset.c_str(), -1, &stmt_update_blockset, nullptr), db, "Prepare update blockset statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    uint64_t blockset_id = 0;
+
+    auto add_to_blockset_inner = [&](Entry &entry) -> int
+    {
+        int rc;
+        uint64_t found_id = 0;
+        std::chrono::high_resolution_clock::time_point lock_begin;
+        while (true)
+        {
+            bool wrote = false;
+            sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+            // Check if the block exists
+            sqlite3_bind_text(stmt_check_block, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_check_block, 2, entry.size);
+            do
+            {
+                rc = sqlite3_step(stmt_check_block);
+            } while (rc == SQLITE_BUSY);
+            if (!assert_sqlite_return_code(rc, db, "check block"))
+                return -1;
+            found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_check_block, 0) : -1;
+            sqlite3_reset(stmt_check_block);
+
+            if (found_id == -1)
+            {
+                // Block does not exist, insert it
+                sqlite3_bind_text(stmt_insert_block, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+                sqlite3_bind_int64(stmt_insert_block, 2, entry.size);
+                lock_begin = std::chrono::high_resolution_clock::now();
+                rc = sqlite3_step(stmt_insert_block);
+                sqlite3_reset(stmt_insert_block);
+
+                if (rc == SQLITE_BUSY)
+                {
+                    // Statement is busy, the read values could be invalid
+                    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+                    continue;
+                }
+                if (!assert_sqlite_return_code(rc, db, "insert block"))
+                    return -1;
+                // Get the last inserted row ID
+                if (!assert_sqlite_return_code(sqlite3_step(stmt_last_row), db, "get last row ID"))
+                    return -1;
+                found_id = sqlite3_column_int64(stmt_last_row, 0);
+                sqlite3_reset(stmt_last_row);
+                num_rows += 2;
+                wrote = true;
+            }
+            num_rows++;
+            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+            if (wrote)
+                record_write_lock(tid, lock_begin);
+            break;
+        }
+
+        // Insert the blockset entry
+        sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
+        lock_begin = std::chrono::high_resolution_clock::now();
+        sqlite3_bind_int64(stmt_insert_blockset_entry, 1, entry.blockset_id);
+        sqlite3_bind_int64(stmt_insert_blockset_entry, 2, found_id);
+        do
+        {
+            rc = sqlite3_step(stmt_insert_blockset_entry);
+        } while (rc == SQLITE_BUSY);
+
+        if (!assert_sqlite_return_code(rc, db, "insert blockset entry"))
+            return -1;
+        sqlite3_reset(stmt_insert_blockset_entry);
+        num_rows++;
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        record_write_lock(tid, lock_begin);
+
+        // Increment the blockset
+        sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
+        lock_begin = std::chrono::high_resolution_clock::now();
+        sqlite3_bind_int64(stmt_update_blockset, 1, entry.blockset_id);
+        do
+        {
+            rc = sqlite3_step(stmt_update_blockset);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "update blockset"))
+            return -1;
+        sqlite3_reset(stmt_update_blockset);
+        num_rows++;
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        record_write_lock(tid, lock_begin);
+
+        return 0;
+    };
+
+    auto start_new_blockset = [&]() -> int
+    {
+        int rc;
+        do
+        {
+            rc = sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
+        } while (rc == SQLITE_BUSY);
+        auto lock_begin = std::chrono::high_resolution_clock::now();
+
+        // Start a new blockset
+        do
+        {
+            rc = sqlite3_step(stmt_start_blockset);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "insert blockset"))
+            return -1;
+        sqlite3_reset(stmt_start_blockset);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_last_row), db, "get last row ID"))
+            return -1;
+        blockset_id = sqlite3_column_int64(stmt_last_row, 0);
+        sqlite3_reset(stmt_last_row);
+        num_rows += 2;
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        record_write_lock(tid, lock_begin);
+
+        return 0;
+    };
+
+    if (start_new_blockset() != 0)
+    {
+        return_code = -1;
+        return;
+    }
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - 50)) // 50% chance to create a new entry
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                blockset_id};
+        }
+        else
+        {
+            entry = entries[i % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        auto op_begin = std::chrono::high_resolution_clock::now();
+        if (add_to_blockset_inner(entry) != 0)
+        {
+            return_code = -1;
+            return;
+        }
+        record_latency(tid, op_begin);
+
+        // With some probability, create a new blockset
+        if ((rng() % 100) < 5) // 5% chance to create a new blockset
+        {
+            if (start_new_blockset() != 0)
             {
                 return_code = -1;
                 return;
             }
-            count++;
         }
-        sqlite3_reset(stmt);
-        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-        // TODO this check is for verification
-        // if (!assert_value_matches(expected_count, count, "Blockset count check"))
-        //{
-        //     return_code = -1;
-        //     return;
-        // }
-        num_rows += count;
-        if (num_rows > runs)
-            break;
-    };
+    }
 
-    sqlite3_finalize(stmt);
+    sqlite3_finalize(stmt_start_blockset);
+    sqlite3_finalize(stmt_last_row);
+    sqlite3_finalize(stmt_check_block);
+    sqlite3_finalize(stmt_insert_block);
+    sqlite3_finalize(stmt_insert_blockset_entry);
+    sqlite3_finalize(stmt_update_blockset);
     sqlite3_close(db);
 
     return_code = 0;
     return;
 }
 
-void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+// new_blockset with Block and Blockset IDs taken from leased ranges, so no last_insert_rowid() lookups are needed while holding the write lock.
+void measure_new_blockset_leased(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
 {
     num_rows = 0;
     std::mt19937 rng(~2025'07'08 + tid);
@@ -555,19 +1535,19 @@ void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &prag
         return;
     }
     std::string
-        sql_start_blockset = "INSERT INTO Blockset (Length) VALUES (0);",
-        sql_last_row = "SELECT last_insert_rowid();",
+        sql_start_blockset = "INSERT INTO Blockset (ID, Length) VALUES (?, 0);",
+        sql_persist = "UPDATE IdLease SET NextID = MAX(NextID, ?) WHERE Name = ?;",
         sql_check_block = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
-        sql_insert_block = "INSERT INTO Block (Hash, Size) VALUES (?, ?);",
+        sql_insert_block = "INSERT INTO Block (ID, Hash, Size) VALUES (?, ?, ?);",
         sql_insert_blockset_entry = "INSERT OR IGNORE INTO BlocksetEntry (BlocksetID, BlockID) VALUES (?, ?);",
         sql_update_blockset = "UPDATE Blockset SET Length = Length + 1 WHERE ID = ?;";
-    sqlite3_stmt *stmt_start_blockset, *stmt_last_row, *stmt_check_block, *stmt_insert_block, *stmt_insert_blockset_entry, *stmt_update_blockset;
+    sqlite3_stmt *stmt_start_blockset, *stmt_persist, *stmt_check_block, *stmt_insert_block, *stmt_insert_blockset_entry, *stmt_update_blockset;
     if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_start_blockset.c_str(), -1, &stmt_start_blockset, nullptr), db, "Prepare start blockset statement"))
     {
         return_code = -1;
         return;
     }
-    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_last_row.c_str(), -1, &stmt_last_row, nullptr), db, "Prepare last row statement"))
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_persist.c_str(), -1, &stmt_persist, nullptr), db, "Prepare persist lease statement"))
     {
         return_code = -1;
         return;
@@ -587,19 +1567,228 @@ void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &prag
         return_code = -1;
         return;
     }
-    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_update_blockset.c_str(), -1, &stmt_update_blockset, nullptr), db, "Prepare update blockset statement"))
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_update_blockset.c_str(), -1, &stmt_update_blockset, nullptr), db, "Prepare update blockset statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    uint64_t blockset_id = 0;
+    IdRange block_range, blockset_range;
+
+    auto add_to_blockset_inner = [&](Entry &entry) -> int
+    {
+        int rc;
+        uint64_t found_id = 0;
+        std::chrono::high_resolution_clock::time_point lock_begin;
+        // The ID is only consumed if the block ends up being inserted
+        if (lease_id(tid, block_ids, block_range, db, stmt_persist) != 0)
+            return -1;
+        while (true)
+        {
+            bool wrote = false;
+            sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+            // Check if the block exists
+            sqlite3_bind_text(stmt_check_block, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_check_block, 2, entry.size);
+            do
+            {
+                rc = sqlite3_step(stmt_check_block);
+            } while (rc == SQLITE_BUSY);
+            if (!assert_sqlite_return_code(rc, db, "check block"))
+                return -1;
+            found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_check_block, 0) : -1;
+            sqlite3_reset(stmt_check_block);
+
+            if (found_id == -1)
+            {
+                // Block does not exist, insert it with the leased ID
+                sqlite3_bind_int64(stmt_insert_block, 1, block_range.next);
+                sqlite3_bind_text(stmt_insert_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+                sqlite3_bind_int64(stmt_insert_block, 3, entry.size);
+                lock_begin = std::chrono::high_resolution_clock::now();
+                rc = sqlite3_step(stmt_insert_block);
+                sqlite3_reset(stmt_insert_block);
+
+                if (rc == SQLITE_BUSY)
+                {
+                    // Statement is busy, the read values could be invalid
+                    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+                    continue;
+                }
+                if (!assert_sqlite_return_code(rc, db, "insert block"))
+                    return -1;
+                found_id = block_range.next++;
+                num_rows++;
+                wrote = true;
+            }
+            num_rows++;
+            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+            if (wrote)
+                record_write_lock(tid, lock_begin);
+            break;
+        }
+
+        // Insert the blockset entry
+        sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
+        lock_begin = std::chrono::high_resolution_clock::now();
+        sqlite3_bind_int64(stmt_insert_blockset_entry, 1, entry.blockset_id);
+        sqlite3_bind_int64(stmt_insert_blockset_entry, 2, found_id);
+        do
+        {
+            rc = sqlite3_step(stmt_insert_blockset_entry);
+        } while (rc == SQLITE_BUSY);
+
+        if (!assert_sqlite_return_code(rc, db, "insert blockset entry"))
+            return -1;
+        sqlite3_reset(stmt_insert_blockset_entry);
+        num_rows++;
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        record_write_lock(tid, lock_begin);
+
+        // Increment the blockset
+        sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
+        lock_begin = std::chrono::high_resolution_clock::now();
+        sqlite3_bind_int64(stmt_update_blockset, 1, entry.blockset_id);
+        do
+        {
+            rc = sqlite3_step(stmt_update_blockset);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "update blockset"))
+            return -1;
+        sqlite3_reset(stmt_update_blockset);
+        num_rows++;
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        record_write_lock(tid, lock_begin);
+
+        return 0;
+    };
+
+    auto start_new_blockset = [&]() -> int
+    {
+        if (lease_id(tid, blockset_ids, blockset_range, db, stmt_persist) != 0)
+            return -1;
+        blockset_id = blockset_range.next++;
+
+        int rc;
+        do
+        {
+            rc = sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
+        } while (rc == SQLITE_BUSY);
+        auto lock_begin = std::chrono::high_resolution_clock::now();
+
+        // Start a new blockset
+        sqlite3_bind_int64(stmt_start_blockset, 1, blockset_id);
+        do
+        {
+            rc = sqlite3_step(stmt_start_blockset);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "insert blockset"))
+            return -1;
+        sqlite3_reset(stmt_start_blockset);
+        num_rows++;
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        record_write_lock(tid, lock_begin);
+
+        return 0;
+    };
+
+    if (start_new_blockset() != 0)
+    {
+        return_code = -1;
+        return;
+    }
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - 50)) // 50% chance to create a new entry
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                blockset_id};
+        }
+        else
+        {
+            entry = entries[i % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (add_to_blockset_inner(entry) != 0)
+        {
+            return_code = -1;
+            return;
+        }
+
+        // With some probability, create a new blockset
+        if ((rng() % 100) < 5) // 5% chance to create a new blockset
+        {
+            if (start_new_blockset() != 0)
+            {
+                return_code = -1;
+                return;
+            }
+        }
+    }
+
+    sqlite3_finalize(stmt_start_blockset);
+    sqlite3_finalize(stmt_persist);
+    sqlite3_finalize(stmt_check_block);
+    sqlite3_finalize(stmt_insert_block);
+    sqlite3_finalize(stmt_insert_blockset_entry);
+    sqlite3_finalize(stmt_update_blockset);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+// Keeps the open blockset in memory and writes the Blockset row and its entries in one transaction when the blockset closes.
+void measure_new_blockset_deferred(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string
+        sql_check_block = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_insert_block = "INSERT INTO Block (Hash, Size) VALUES (?, ?) RETURNING ID;",
+        sql_insert_blockset = "INSERT INTO Blockset (Length) VALUES (?) RETURNING ID;",
+        sql_insert_blockset_entry = "INSERT OR IGNORE INTO BlocksetEntry (BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_check_block, *stmt_insert_block, *stmt_insert_blockset, *stmt_insert_blockset_entry;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_check_block.c_str(), -1, &stmt_check_block, nullptr), db, "Prepare check block statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_block.c_str(), -1, &stmt_insert_block, nullptr), db, "Prepare insert block statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_blockset.c_str(), -1, &stmt_insert_blockset, nullptr), db, "Prepare insert blockset statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_blockset_entry.c_str(), -1, &stmt_insert_blockset_entry, nullptr), db, "Prepare insert blockset entry statement"))
     {
         return_code = -1;
         return;
     }
-    uint64_t blockset_id = 0;
+    std::vector<uint64_t> block_ids;
 
     auto add_to_blockset_inner = [&](Entry &entry) -> int
     {
         int rc;
         uint64_t found_id = 0;
+        std::chrono::high_resolution_clock::time_point lock_begin;
         while (true)
         {
+            bool wrote = false;
             sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
             // Check if the block exists
             sqlite3_bind_text(stmt_check_block, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
@@ -615,10 +1804,13 @@ void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &prag
 
             if (found_id == -1)
             {
-                // Block does not exist, insert it
+                // Block does not exist, insert it and get the ID from the same statement
                 sqlite3_bind_text(stmt_insert_block, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
                 sqlite3_bind_int64(stmt_insert_block, 2, entry.size);
+                lock_begin = std::chrono::high_resolution_clock::now();
                 rc = sqlite3_step(stmt_insert_block);
+                if (rc == SQLITE_ROW)
+                    found_id = sqlite3_column_int64(stmt_insert_block, 0);
                 sqlite3_reset(stmt_insert_block);
 
                 if (rc == SQLITE_BUSY)
@@ -629,71 +1821,361 @@ void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &prag
                 }
                 if (!assert_sqlite_return_code(rc, db, "insert block"))
                     return -1;
-                // Get the last inserted row ID
-                if (!assert_sqlite_return_code(sqlite3_step(stmt_last_row), db, "get last row ID"))
-                    return -1;
-                found_id = sqlite3_column_int64(stmt_last_row, 0);
-                sqlite3_reset(stmt_last_row);
-                num_rows += 2;
+                num_rows += 2; // Counted as the insert and ID lookup of measure_new_blockset, so the reports are comparable
+                wrote = true;
             }
             num_rows++;
             sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+            if (wrote)
+                record_write_lock(tid, lock_begin);
             break;
         }
 
-        // Insert the blockset entry
-        sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
-        sqlite3_bind_int64(stmt_insert_blockset_entry, 1, entry.blockset_id);
-        sqlite3_bind_int64(stmt_insert_blockset_entry, 2, found_id);
+        block_ids.push_back(found_id);
+
+        return 0;
+    };
+
+    auto close_blockset = [&]() -> int
+    {
+        if (block_ids.empty())
+            return 0;
+
+        int rc;
         do
         {
-            rc = sqlite3_step(stmt_insert_blockset_entry);
+            rc = sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
         } while (rc == SQLITE_BUSY);
+        auto lock_begin = std::chrono::high_resolution_clock::now();
 
-        if (!assert_sqlite_return_code(rc, db, "insert blockset entry"))
+        // The length is known up front, so the blockset is written once
+        sqlite3_bind_int64(stmt_insert_blockset, 1, block_ids.size());
+        rc = sqlite3_step(stmt_insert_blockset);
+        if (!assert_sqlite_return_code(rc, db, "insert blockset"))
             return -1;
-        sqlite3_reset(stmt_insert_blockset_entry);
-        num_rows++;
+        uint64_t blockset_id = sqlite3_column_int64(stmt_insert_blockset, 0);
+        sqlite3_reset(stmt_insert_blockset);
+        num_rows += 2;
+
+        for (auto block_id : block_ids)
+        {
+            sqlite3_bind_int64(stmt_insert_blockset_entry, 1, blockset_id);
+            sqlite3_bind_int64(stmt_insert_blockset_entry, 2, block_id);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_insert_blockset_entry), db, "insert blockset entry"))
+                return -1;
+            sqlite3_reset(stmt_insert_blockset_entry);
+            num_rows += 2; // The entry, and the length increment measure_new_blockset does for it
+        }
         sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        record_write_lock(tid, lock_begin);
+        block_ids.clear();
 
-        // Increment the blockset
-        sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
-        sqlite3_bind_int64(stmt_update_blockset, 1, entry.blockset_id);
+        return 0;
+    };
+
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - 50)) // 50% chance to create a new entry
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[i % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (add_to_blockset_inner(entry) != 0)
+        {
+            return_code = -1;
+            return;
+        }
+
+        // With some probability, close the blockset and start a new one
+        if ((rng() % 100) < 5) // 5% chance to create a new blockset
+        {
+            if (close_blockset() != 0)
+            {
+                return_code = -1;
+                return;
+            }
+        }
+    }
+    if (close_blockset() != 0)
+    {
+        return_code = -1;
+        return;
+    }
+
+    sqlite3_finalize(stmt_check_block);
+    sqlite3_finalize(stmt_insert_block);
+    sqlite3_finalize(stmt_insert_blockset);
+    sqlite3_finalize(stmt_insert_blockset_entry);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+// xor1 in writer thread mode: the lookup runs on the thread's own connection, and only a miss is queued for the writer.
+void measure_xor1_writer(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string sql_select = "SELECT ID FROM Block WHERE (Hash = ? AND Size = ?);";
+    sqlite3_stmt *stmt_select;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor select statement"))
+    {
+        return_code = -1;
+        return;
+    }
+
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        auto op_begin = std::chrono::high_resolution_clock::now();
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        Entry entry;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_select, 2, entry.size);
+        int rc;
         do
         {
-            rc = sqlite3_step(stmt_update_blockset);
+            rc = sqlite3_step(stmt_select);
         } while (rc == SQLITE_BUSY);
-        if (!assert_sqlite_return_code(rc, db, "update blockset"))
+        if (!assert_sqlite_return_code(rc, db, "xor1 query execution " + std::to_string(i)))
+        {
+            return_code = -1;
+            return;
+        }
+        auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_select, 0) : -1;
+        sqlite3_reset(stmt_select);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+        if (found_id == -1)
+        {
+            // Not found, let the writer insert it
+            if (submit_write([&entry](Writer &w) -> int64_t
+                             { return writer_insert_block(w, entry); }) < 0)
+            {
+                return_code = -1;
+                return;
+            }
+            num_rows += 2;
+        }
+        else
+        {
+            if (!assert_value_matches(entry.id, (uint64_t)found_id, "xor1 ID check"))
+            {
+                return_code = -1;
+                return;
+            }
+            num_rows++;
+        }
+        record_latency(tid, op_begin);
+    }
+
+    sqlite3_finalize(stmt_select);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+// xor2 in writer thread mode: the INSERT OR IGNORE is queued for the writer, and the select runs once it has been committed.
+void measure_xor2_writer(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string
+        sql_insert = "INSERT OR IGNORE INTO Block (Hash, Size) VALUES (?, ?);",
+        sql_select = "SELECT * FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt_select;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor select statement"))
+    {
+        return_code = -1;
+        return;
+    }
+
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        auto op_begin = std::chrono::high_resolution_clock::now();
+        Entry entry;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        auto insert = [&entry, &sql_insert](Writer &w) -> int64_t
+        {
+            sqlite3_stmt *stmt = w.statement(sql_insert);
+            if (stmt == nullptr)
+                return -1;
+            sqlite3_bind_text(stmt, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt, 2, entry.size);
+            int rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            return assert_sqlite_return_code(rc, w.db, "xor2 writer insert") ? 0 : -1;
+        };
+        if (submit_write(insert) < 0)
+        {
+            return_code = -1;
+            return;
+        }
+
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_select, 2, entry.size);
+        int rc;
+        do
+        {
+            rc = sqlite3_step(stmt_select);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "xor2 select query execution " + std::to_string(i)))
+        {
+            return_code = -1;
+            return;
+        }
+        sqlite3_reset(stmt_select);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        record_latency(tid, op_begin);
+        num_rows += 2;
+    }
+
+    sqlite3_finalize(stmt_select);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+// new_blockset in writer thread mode: the block lookup runs on the thread's own connection, and the block insert, blockset entry and length update are queued as one request.
+void measure_new_blockset_writer(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db = open_connection(pragmas);
+    if (db == nullptr)
+    {
+        return_code = -1;
+        return;
+    }
+    std::string
+        sql_start_blockset = "INSERT INTO Blockset (Length) VALUES (0);",
+        sql_check_block = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_insert_blockset_entry = "INSERT OR IGNORE INTO BlocksetEntry (BlocksetID, BlockID) VALUES (?, ?);",
+        sql_update_blockset = "UPDATE Blockset SET Length = Length + 1 WHERE ID = ?;";
+    sqlite3_stmt *stmt_check_block;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_check_block.c_str(), -1, &stmt_check_block, nullptr), db, "Prepare check block statement"))
+    {
+        return_code = -1;
+        return;
+    }
+    int64_t blockset_id = 0;
+
+    auto add_to_blockset_inner = [&](Entry &entry) -> int
+    {
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        // Check if the block exists
+        sqlite3_bind_text(stmt_check_block, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_check_block, 2, entry.size);
+        int rc;
+        do
+        {
+            rc = sqlite3_step(stmt_check_block);
+        } while (rc == SQLITE_BUSY);
+        if (!assert_sqlite_return_code(rc, db, "check block"))
+            return -1;
+        int64_t found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_check_block, 0) : -1;
+        sqlite3_reset(stmt_check_block);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        num_rows += found_id == -1 ? 3 : 1;
+
+        auto add = [&](Writer &w) -> int64_t
+        {
+            int64_t block_id = found_id == -1 ? writer_insert_block(w, entry) : found_id;
+            sqlite3_stmt *stmt_insert_blockset_entry = w.statement(sql_insert_blockset_entry);
+            sqlite3_stmt *stmt_update_blockset = w.statement(sql_update_blockset);
+            if (block_id < 0 || stmt_insert_blockset_entry == nullptr || stmt_update_blockset == nullptr)
+                return -1;
+
+            sqlite3_bind_int64(stmt_insert_blockset_entry, 1, entry.blockset_id);
+            sqlite3_bind_int64(stmt_insert_blockset_entry, 2, block_id);
+            int rc = sqlite3_step(stmt_insert_blockset_entry);
+            sqlite3_reset(stmt_insert_blockset_entry);
+            if (!assert_sqlite_return_code(rc, w.db, "insert blockset entry"))
+                return -1;
+
+            sqlite3_bind_int64(stmt_update_blockset, 1, entry.blockset_id);
+            rc = sqlite3_step(stmt_update_blockset);
+            sqlite3_reset(stmt_update_blockset);
+            if (!assert_sqlite_return_code(rc, w.db, "update blockset"))
+                return -1;
+
+            return block_id;
+        };
+        if (submit_write(add) < 0)
             return -1;
-        sqlite3_reset(stmt_update_blockset);
-        num_rows++;
-        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        num_rows += 2;
 
         return 0;
     };
 
     auto start_new_blockset = [&]() -> int
     {
-        int rc;
-        do
-        {
-            rc = sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
-        } while (rc == SQLITE_BUSY);
-
-        // Start a new blockset
-        do
+        auto start = [&sql_start_blockset](Writer &w) -> int64_t
         {
-            rc = sqlite3_step(stmt_start_blockset);
-        } while (rc == SQLITE_BUSY);
-        if (!assert_sqlite_return_code(rc, db, "insert blockset"))
-            return -1;
-        sqlite3_reset(stmt_start_blockset);
-        if (!assert_sqlite_return_code(sqlite3_step(stmt_last_row), db, "get last row ID"))
+            sqlite3_stmt *stmt = w.statement(sql_start_blockset);
+            if (stmt == nullptr)
+                return -1;
+            int rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (!assert_sqlite_return_code(rc, w.db, "insert blockset"))
+                return -1;
+            return sqlite3_last_insert_rowid(w.db);
+        };
+        blockset_id = submit_write(start);
+        if (blockset_id < 0)
             return -1;
-        blockset_id = sqlite3_column_int64(stmt_last_row, 0);
-        sqlite3_reset(stmt_last_row);
         num_rows += 2;
-        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
 
         return 0;
     };
@@ -712,18 +2194,20 @@ void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &prag
                 (uint64_t)-1,
                 random_hash_string(rng, 44),
                 rng() % 1000,
-                blockset_id};
+                (uint64_t)blockset_id};
         }
         else
         {
             entry = entries[i % entries.size()]; // Reuse existing entries for warmup
         }
 
+        auto op_begin = std::chrono::high_resolution_clock::now();
         if (add_to_blockset_inner(entry) != 0)
         {
             return_code = -1;
             return;
         }
+        record_latency(tid, op_begin);
 
         // With some probability, create a new blockset
         if ((rng() % 100) < 5) // 5% chance to create a new blockset
@@ -736,26 +2220,124 @@ void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &prag
         }
     }
 
-    sqlite3_finalize(stmt_start_blockset);
-    sqlite3_finalize(stmt_last_row);
     sqlite3_finalize(stmt_check_block);
-    sqlite3_finalize(stmt_insert_block);
-    sqlite3_finalize(stmt_insert_blockset_entry);
-    sqlite3_finalize(stmt_update_blockset);
     sqlite3_close(db);
 
     return_code = 0;
     return;
 }
 
-int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config &, const std::vector<Entry> &, int &, int &)> f, std::vector<Entry> &entries, Config &config, std::string report_name, std::vector<std::string> &pragmas)
+// Long-lived reader mode: while the writers run, one connection holds a read transaction for config.reader_hold_ms, like a restore or
+// verify running during a backup. Checkpoints cannot get past its snapshot, so the WAL grows for as long as it is held. Lookups
+// through the held snapshot and through a fresh connection are timed at every sample, along with the WAL size and the highest
+// committed block ID, so the writer progress and the reader degradation can be followed over time.
+const std::chrono::milliseconds LONG_READER_SAMPLE_INTERVAL(10);
+
+struct LongReaderSample
+{
+    uint64_t elapsed_us;
+    bool holding;
+    uint64_t held_probe_ns; // 0 once the snapshot is released
+    uint64_t fresh_probe_ns;
+    uint64_t wal_bytes;
+    uint64_t committed_blocks;
+};
+
+// Times a lookup of the entry, returning the elapsed nanoseconds, or -1 on error
+int64_t probe_block(sqlite3 *db, sqlite3_stmt *stmt, const Entry &entry)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_bind_text(stmt, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, entry.size);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+        ;
+    sqlite3_reset(stmt);
+    if (!assert_sqlite_return_code(rc, db, "Probe block"))
+        return -1;
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+}
+
+void run_long_reader(std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, const std::atomic<bool> &writers_done, std::vector<LongReaderSample> &samples, int &return_code)
+{
+    return_code = -1;
+    std::mt19937 rng(2025'07'08);
+    sqlite3 *held = open_connection(pragmas, reader_open_flags), *fresh = open_connection(pragmas, reader_open_flags);
+    if (held == nullptr || fresh == nullptr)
+        return;
+    std::string
+        sql_probe = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_committed = "SELECT max(ID) FROM Block;";
+    sqlite3_stmt *stmt_held, *stmt_fresh, *stmt_committed;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(held, sql_probe.c_str(), -1, &stmt_held, nullptr), held, "Prepare held probe statement"))
+        return;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(fresh, sql_probe.c_str(), -1, &stmt_fresh, nullptr), fresh, "Prepare fresh probe statement"))
+        return;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(fresh, sql_committed.c_str(), -1, &stmt_committed, nullptr), fresh, "Prepare committed statement"))
+        return;
+
+    // The read transaction, and with it the snapshot, starts with the first lookup
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(held, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+    if (probe_block(held, stmt_held, entries[rng() % entries.size()]) < 0)
+        return;
+    bool holding = true;
+
+    while (!writers_done.load(std::memory_order_relaxed))
+    {
+        auto now = std::chrono::high_resolution_clock::now();
+        if (holding && now - begin >= std::chrono::milliseconds(config.reader_hold_ms))
+        {
+            sqlite3_exec(held, "COMMIT;", nullptr, nullptr, nullptr);
+            holding = false;
+        }
+
+        const Entry &entry = entries[rng() % entries.size()];
+        LongReaderSample sample = {(uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - begin).count(), holding, 0, 0, 0, 0};
+        if (holding)
+        {
+            int64_t held_ns = probe_block(held, stmt_held, entry);
+            if (held_ns < 0)
+                return;
+            sample.held_probe_ns = held_ns;
+        }
+        int64_t fresh_ns = probe_block(fresh, stmt_fresh, entry);
+        if (fresh_ns < 0)
+            return;
+        sample.fresh_probe_ns = fresh_ns;
+        std::error_code ec;
+        sample.wal_bytes = std::filesystem::file_size(DBPATH + "-wal", ec);
+        if (ec)
+            sample.wal_bytes = 0;
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_committed), fresh, "Get committed blocks"))
+            return;
+        sample.committed_blocks = sqlite3_column_int64(stmt_committed, 0);
+        sqlite3_reset(stmt_committed);
+        samples.push_back(sample);
+
+        std::this_thread::sleep_for(LONG_READER_SAMPLE_INTERVAL);
+    }
+
+    if (holding)
+        sqlite3_exec(held, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_finalize(stmt_held);
+    sqlite3_finalize(stmt_fresh);
+    sqlite3_finalize(stmt_committed);
+    sqlite3_close(held);
+    sqlite3_close(fresh);
+
+    return_code = 0;
+}
+
+int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config &, const std::vector<Entry> &, int &, int &)> f, std::vector<Entry> &entries, Config &config, std::string report_name, std::vector<std::string> &pragmas, const std::string &backup = DBPATH + ".backup", bool use_writer = false)
 {
     // Copy the backed up database
-    auto copy_db = []()
+    auto copy_db = [&backup]()
     {
         std::filesystem::remove(DBPATH + "-shm");
         std::filesystem::remove(DBPATH + "-wal");
-        std::filesystem::copy_file(DBPATH + ".backup", DBPATH, std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::copy_file(backup, DBPATH, std::filesystem::copy_options::overwrite_existing);
         sqlite3 *db;
         sqlite3_open(DBPATH.c_str(), &db);
         sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
@@ -764,20 +2346,62 @@ int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config
     };
     copy_db();
 
+    // The writer thread is restarted around each phase, so it never holds the database while it is being copied
+    std::thread writer_thread;
+    int writer_return_code = 0;
+    auto start_writer = [&]() -> int
+    {
+        if (!use_writer)
+            return 0;
+        writer.db = open_connection(pragmas);
+        if (writer.db == nullptr)
+            return -1;
+        writer.groups = 0;
+        writer.requests = 0;
+        writer.running = true;
+        writer_thread = std::thread(run_writer, std::ref(writer_return_code));
+        return 0;
+    };
+    auto stop_writer = [&]() -> int
+    {
+        if (!use_writer)
+            return 0;
+        writer.running = false;
+        writer.signal();
+        writer_thread.join();
+        return writer_return_code;
+    };
+
     std::vector<std::thread> threads;
     std::vector<int> return_codes(config.num_threads);
     std::vector<int> num_rows(config.num_threads);
+    thread_stats.assign(config.num_threads, ThreadStats());
 
+    if (start_writer() != 0)
+        return -1;
     for (int i = 0; i < config.num_threads; i++)
         threads.emplace_back(f, i, config.num_warmup / config.num_threads, std::ref(pragmas), std::ref(config), std::ref(entries), std::ref(return_codes[i]), std::ref(num_rows[i]));
     for (auto &thread : threads)
         thread.join();
     threads.clear();
+    if (stop_writer() != 0)
+        return -1;
     for (auto &return_code : return_codes)
         if (return_code != 0)
             return -1;
 
     copy_db();
+    thread_stats.assign(config.num_threads, ThreadStats());
+    if (start_writer() != 0)
+        return -1;
+
+    // The long-lived reader only runs alongside the measured phase
+    std::thread long_reader;
+    std::atomic<bool> writers_done = false;
+    std::vector<LongReaderSample> long_reader_samples;
+    int long_reader_return_code = 0;
+    if (config.reader_hold_ms > 0)
+        long_reader = std::thread(run_long_reader, std::ref(pragmas), std::ref(config), std::cref(entries), std::cref(writers_done), std::ref(long_reader_samples), std::ref(long_reader_return_code));
 
     auto begin = std::chrono::high_resolution_clock::now();
     for (int i = 0; i < config.num_threads; i++)
@@ -786,6 +2410,15 @@ int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config
         thread.join();
     auto end = std::chrono::high_resolution_clock::now();
     threads.clear();
+    writers_done = true;
+    if (long_reader.joinable())
+        long_reader.join();
+    if (long_reader_return_code != 0)
+        return -1;
+    if (stop_writer() != 0)
+        return -1;
+    if (use_writer)
+        std::cout << "Writer committed " << writer.requests << " requests in " << writer.groups << " groups" << std::endl;
 
     for (auto &return_code : return_codes)
         if (return_code != 0)
@@ -818,11 +2451,352 @@ int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config
                 << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << ","
                 << float(total_rows) / (float(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / 1000) << "\n";
 
+    // Only the workloads that track their write lock hold time get a lock report
+    uint64_t write_transactions = 0, write_lock_ns = 0;
+    for (auto &stats : thread_stats)
+    {
+        write_transactions += stats.write_transactions;
+        write_lock_ns += stats.write_lock_ns;
+    }
+    if (write_transactions > 0)
+    {
+        bool emit_lock_header = !std::filesystem::exists("reports/parallel_lock_" + report_name + ".csv");
+        std::ofstream lock_file("reports/parallel_lock_" + report_name + ".csv", std::ios::app);
+        if (emit_lock_header)
+        {
+            lock_file << "num_entries,num_warmup,num_repetitions,num_threads,write_transactions,lock_hold_us,avg_lock_hold_ns\n";
+        }
+
+        lock_file << config.num_entries << ","
+                  << config.num_warmup << ","
+                  << config.num_repetitions << ","
+                  << config.num_threads << ","
+                  << write_transactions << ","
+                  << write_lock_ns / 1000 << ","
+                  << float(write_lock_ns) / write_transactions << "\n";
+    }
+
+    if (!long_reader_samples.empty())
+    {
+        bool emit_long_reader_header = !std::filesystem::exists("reports/parallel_long_reader_" + report_name + ".csv");
+        std::ofstream long_reader_file("reports/parallel_long_reader_" + report_name + ".csv", std::ios::app);
+        if (emit_long_reader_header)
+        {
+            long_reader_file << "num_entries,num_threads,reader_hold_ms,elapsed_us,holding,held_probe_ns,fresh_probe_ns,wal_bytes,committed_blocks\n";
+        }
+
+        for (auto &sample : long_reader_samples)
+        {
+            long_reader_file << config.num_entries << ","
+                             << config.num_threads << ","
+                             << config.reader_hold_ms << ","
+                             << sample.elapsed_us << ","
+                             << sample.holding << ","
+                             << sample.held_probe_ns << ","
+                             << sample.fresh_probe_ns << ","
+                             << sample.wal_bytes << ","
+                             << sample.committed_blocks << "\n";
+        }
+    }
+
+    std::vector<uint64_t> latencies;
+    for (auto &stats : thread_stats)
+        latencies.insert(latencies.end(), stats.latencies.begin(), stats.latencies.end());
+    if (!latencies.empty())
+        report_stats(config, latencies, "parallel_latency_" + report_name + "_" + std::to_string(config.num_threads) + "_threads");
+
+    return 0;
+}
+
+#ifndef _WIN32
+// Multi-process mode: the workloads run in forked worker processes instead of threads, so the connections share the database through
+// the shm file and POSIX locks, like separate applications would. The workload is inherited through the fork, while the number of runs,
+// the start signal and the results are passed through an anonymous shared mapping.
+struct ProcessResult
+{
+    int return_code;
+    int num_rows;
+    uint64_t time_us;
+    uint64_t write_transactions;
+    uint64_t write_lock_ns;
+    uint64_t p50_latency_ns; // The latencies are 0 for the workloads that do not record them
+    uint64_t p99_latency_ns;
+    uint64_t max_latency_ns;
+};
+
+// Followed in the mapping by one ProcessResult per process
+struct ProcessDescriptor
+{
+    std::atomic<uint64_t> ready;
+    std::atomic<bool> start;
+    uint64_t runs; // Per process
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<bool>::is_always_lock_free, "Shared atomics must be lock free");
+static_assert(sizeof(ProcessDescriptor) % alignof(ProcessResult) == 0, "The results must be aligned after the descriptor");
+#endif
+
+int measure_processes(std::function<void(int, uint64_t, std::vector<std::string> &, Config &, const std::vector<Entry> &, int &, int &)> f, std::vector<Entry> &entries, Config &config, std::string report_name, std::vector<std::string> &pragmas, const std::string &backup = DBPATH + ".backup")
+{
+#ifdef _WIN32
+    std::cerr << "Multi-process mode requires fork, skipping " << report_name << std::endl;
+    return 0;
+#else
+    // Copy the backed up database
+    auto copy_db = [&backup]()
+    {
+        std::filesystem::remove(DBPATH + "-shm");
+        std::filesystem::remove(DBPATH + "-wal");
+        std::filesystem::copy_file(backup, DBPATH, std::filesystem::copy_options::overwrite_existing);
+        sqlite3 *db;
+        sqlite3_open(DBPATH.c_str(), &db);
+        sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+        sqlite3_wal_checkpoint(db, nullptr);
+        sqlite3_close(db);
+    };
+
+    size_t descriptor_size = sizeof(ProcessDescriptor) + config.num_processes * sizeof(ProcessResult);
+    void *mapping = mmap(nullptr, descriptor_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Unable to map the process descriptor" << std::endl;
+        return -1;
+    }
+    auto descriptor = new (mapping) ProcessDescriptor();
+    auto results = reinterpret_cast<ProcessResult *>(descriptor + 1);
+
+    // Forks the workers and releases them together once all have started, so the time excludes the forks. No connection may be open
+    // in this process while forking, as the children would inherit its locks.
+    auto run = [&](uint64_t runs, std::chrono::high_resolution_clock::time_point &begin, std::chrono::high_resolution_clock::time_point &end) -> int
+    {
+        descriptor->ready = 0;
+        descriptor->start = false;
+        descriptor->runs = runs;
+        std::fill(results, results + config.num_processes, ProcessResult{-1, 0, 0, 0, 0, 0, 0, 0});
+        thread_stats.assign(config.num_processes, ThreadStats());
+        std::vector<pid_t> pids;
+        for (int i = 0; i < config.num_processes; i++)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                descriptor->ready++;
+                while (!descriptor->start.load())
+                    std::this_thread::yield();
+                auto process_begin = std::chrono::high_resolution_clock::now();
+                ProcessResult &result = results[i];
+                f(i, descriptor->runs, pragmas, config, entries, result.return_code, result.num_rows);
+                auto process_end = std::chrono::high_resolution_clock::now();
+                result.time_us = std::chrono::duration_cast<std::chrono::microseconds>(process_end - process_begin).count();
+                result.write_transactions = thread_stats[i].write_transactions;
+                result.write_lock_ns = thread_stats[i].write_lock_ns;
+                auto &latencies = thread_stats[i].latencies;
+                if (!latencies.empty())
+                {
+                    std::sort(latencies.begin(), latencies.end());
+                    result.p50_latency_ns = latencies[latencies.size() / 2];
+                    result.p99_latency_ns = latencies[latencies.size() * 99 / 100];
+                    result.max_latency_ns = latencies.back();
+                }
+                _exit(0); // Skips the destructors and buffers inherited from the parent
+            }
+            if (pid < 0)
+            {
+                std::cerr << "Unable to fork worker process " << i << std::endl;
+                break;
+            }
+            pids.push_back(pid);
+        }
+        while (descriptor->ready.load() < pids.size())
+            std::this_thread::yield();
+
+        begin = std::chrono::high_resolution_clock::now();
+        descriptor->start = true;
+        bool failed = pids.size() != config.num_processes;
+        for (auto pid : pids)
+        {
+            int status;
+            if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed = true;
+        }
+        end = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < pids.size(); i++)
+            if (results[i].return_code != 0)
+                failed = true;
+        return failed ? -1 : 0;
+    };
+
+    std::chrono::high_resolution_clock::time_point begin, end;
+    copy_db();
+    if (run(config.num_warmup / config.num_processes, begin, end) != 0)
+    {
+        munmap(mapping, descriptor_size);
+        return -1;
+    }
+    copy_db();
+    if (run(config.num_repetitions / config.num_processes, begin, end) != 0)
+    {
+        munmap(mapping, descriptor_size);
+        return -1;
+    }
+
+    uint64_t total_rows = 0;
+    for (int i = 0; i < config.num_processes; i++)
+        total_rows += results[i].num_rows;
+
+    std::cout << "Parallel " << report_name << " with " << config.num_processes << " processes took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms ("
+              << float(total_rows) / std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " kop/s)" << std::endl;
+
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    // Same columns as the threaded report, so the two can be put side by side
+    bool emit_header = !std::filesystem::exists("reports/parallel_" + report_name + "_processes.csv");
+    std::ofstream report_file("reports/parallel_" + report_name + "_processes.csv", std::ios::app);
+    if (emit_header)
+    {
+        report_file << "num_entries,num_warmup,num_repetitions,num_processes,rows,time_us,kop_s\n";
+    }
+
+    report_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << config.num_processes << ","
+                << total_rows << ","
+                << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << ","
+                << float(total_rows) / (float(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / 1000) << "\n";
+
+    bool emit_process_header = !std::filesystem::exists("reports/parallel_process_" + report_name + ".csv");
+    std::ofstream process_file("reports/parallel_process_" + report_name + ".csv", std::ios::app);
+    if (emit_process_header)
+    {
+        process_file << "num_entries,num_warmup,num_repetitions,num_processes,process,rows,time_us,kop_s,avg_latency_ns,p50_latency_ns,p99_latency_ns,max_latency_ns,write_transactions,lock_hold_us\n";
+    }
+
+    for (int i = 0; i < config.num_processes; i++)
+    {
+        auto &result = results[i];
+        process_file << config.num_entries << ","
+                     << config.num_warmup << ","
+                     << config.num_repetitions << ","
+                     << config.num_processes << ","
+                     << i << ","
+                     << result.num_rows << ","
+                     << result.time_us << ","
+                     << float(result.num_rows) / (float(result.time_us) / 1000) << ","
+                     << float(result.time_us) * 1000 / std::max<uint64_t>(1, descriptor->runs) << ","
+                     << result.p50_latency_ns << ","
+                     << result.p99_latency_ns << ","
+                     << result.max_latency_ns << ","
+                     << result.write_transactions << ","
+                     << result.write_lock_ns / 1000 << "\n";
+    }
+
+    munmap(mapping, descriptor_size);
+    return 0;
+#endif
+}
+
+// Runs the workloads that do not share state between threads in worker processes. The writer thread and the leased IDs live in the
+// memory of a single process, so those variants are left out.
+int measure_process_modes(std::vector<Entry> &entries, Config &config, std::vector<std::string> &pragmas)
+{
+    if (measure_processes(measure_insert, entries, config, "insert", pragmas) != 0)
+        return -1;
+
+    if (measure_processes(measure_select, entries, config, "select", pragmas) != 0)
+        return -1;
+
+    if (measure_processes(measure_xor1, entries, config, "xor1", pragmas) != 0)
+        return -1;
+
+    if (measure_processes(measure_xor2, entries, config, "xor2", pragmas) != 0)
+        return -1;
+
+    if (measure_processes(measure_xor3, entries, config, "xor3", pragmas, DBPATH + ".unique") != 0)
+        return -1;
+
+    if (measure_processes(measure_join, entries, config, "join", pragmas) != 0)
+        return -1;
+
+    if (measure_processes(measure_new_blockset, entries, config, "new_blockset", pragmas) != 0)
+        return -1;
+
+    return 0;
+}
+
+// Report name suffix for the non-default threading mode and memory settings
+std::string settings_suffix(const Config &config)
+{
+    std::string suffix;
+    if (config.threading_mode != "default")
+        suffix += "_" + config.threading_mode;
+    if (config.allocator != "default")
+        suffix += "_" + config.allocator + "_allocator";
+    if (!config.memstatus)
+        suffix += "_memstatus_off";
+    if (config.lookaside != "default")
+        suffix += "_lookaside_" + config.lookaside;
+    return suffix;
+}
+
+// Runs the reader workloads with each combination of open flags. The threading mode, memory settings and flags are appended
+// to the report name, so the plain select and join reports from measure_all remain the default configuration.
+int measure_reader_modes(std::vector<Entry> &entries, Config &config, std::vector<std::string> &pragmas)
+{
+    std::vector<std::tuple<std::string, int>> open_modes = {
+        {"", 0},
+        {"nomutex", SQLITE_OPEN_NOMUTEX},
+        {"fullmutex", SQLITE_OPEN_FULLMUTEX},
+        {"sharedcache", SQLITE_OPEN_SHAREDCACHE},
+        {"readonly", SQLITE_OPEN_READONLY}};
+
+    std::string mode_suffix = settings_suffix(config);
+    for (auto &[name, flags] : open_modes)
+    {
+        std::string suffix = mode_suffix + (name.empty() ? "" : "_" + name);
+        if (suffix.empty())
+            continue;
+
+        reader_open_flags = flags & SQLITE_OPEN_READONLY ? flags : flags | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+        if (measure(measure_select, entries, config, "select" + suffix, pragmas) != 0)
+            return -1;
+        if (measure(measure_join, entries, config, "join" + suffix, pragmas) != 0)
+            return -1;
+    }
+    reader_open_flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+    return 0;
+}
+
+// Runs the writer workloads next to a long-lived reader, with the hold time appended to the report name
+int measure_long_reader(std::vector<Entry> &entries, Config &config, std::vector<std::string> &pragmas)
+{
+    std::string suffix = "_long_reader_" + std::to_string(config.reader_hold_ms) + "ms";
+    if (measure(measure_xor1, entries, config, "xor1" + suffix, pragmas) != 0)
+        return -1;
+    if (measure(measure_new_blockset, entries, config, "new_blockset" + suffix, pragmas) != 0)
+        return -1;
+
     return 0;
 }
 
 int measure_all(std::vector<Entry> &entries, Config &config, std::string &report_name, std::vector<std::string> &pragmas)
 {
+    if (config.num_processes > 0)
+        return measure_process_modes(entries, config, pragmas);
+
+    // The long-lived reader only covers the writer workloads it holds back
+    if (config.reader_hold_ms > 0)
+        return measure_long_reader(entries, config, pragmas);
+
+    // The other threading modes and memory settings only cover the reader workloads
+    if (!settings_suffix(config).empty())
+        return measure_reader_modes(entries, config, pragmas);
 
     if (measure(measure_insert, entries, config, "insert", pragmas) != 0)
         return -1;
@@ -833,15 +2807,55 @@ int measure_all(std::vector<Entry> &entries, Config &config, std::string &report
     if (measure(measure_xor1, entries, config, "xor1", pragmas) != 0)
         return -1;
 
+    if (measure(measure_xor1_writer, entries, config, "xor1_writer", pragmas, DBPATH + ".backup", true) != 0)
+        return -1;
+
+    if (measure(measure_xor1_leased, entries, config, "xor1_leased", pragmas) != 0)
+        return -1;
+
     if (measure(measure_xor2, entries, config, "xor2", pragmas) != 0)
         return -1;
 
+    if (measure(measure_xor2_writer, entries, config, "xor2_writer", pragmas, DBPATH + ".backup", true) != 0)
+        return -1;
+
+    if (measure(measure_insert, entries, config, "insert_unique", pragmas, DBPATH + ".unique") != 0)
+        return -1;
+
+    if (measure(measure_insert_staged, entries, config, "insert_staged", pragmas, DBPATH + ".unique") != 0)
+        return -1;
+
+    // The direct path on the same database as the staged one, which needs the UNIQUE index to merge
+    if (measure(measure_xor1, entries, config, "xor1_unique", pragmas, DBPATH + ".unique") != 0)
+        return -1;
+
+    if (measure(measure_xor1_staged, entries, config, "xor1_staged", pragmas, DBPATH + ".unique") != 0)
+        return -1;
+
+    if (measure(measure_xor3, entries, config, "xor3", pragmas, DBPATH + ".unique") != 0)
+        return -1;
+
+    if (measure(measure_xor3_update, entries, config, "xor3_update", pragmas, DBPATH + ".unique") != 0)
+        return -1;
+
     if (measure(measure_join, entries, config, "join", pragmas) != 0)
         return -1;
 
     if (measure(measure_new_blockset, entries, config, "new_blockset", pragmas) != 0)
         return -1;
 
+    if (measure(measure_new_blockset_writer, entries, config, "new_blockset_writer", pragmas, DBPATH + ".backup", true) != 0)
+        return -1;
+
+    if (measure(measure_new_blockset_deferred, entries, config, "new_blockset_deferred", pragmas) != 0)
+        return -1;
+
+    if (measure(measure_new_blockset_leased, entries, config, "new_blockset_leased", pragmas) != 0)
+        return -1;
+
+    if (measure_reader_modes(entries, config, pragmas) != 0)
+        return -1;
+
     return 0;
 }
 
@@ -849,6 +2863,22 @@ int main(int argc, char *argv[])
 {
     auto config = parse_args(argc, argv);
 
+    // The threading mode can only be changed before SQLite is initialized, which happens when the first connection is opened.
+    if (config.threading_mode != "default")
+    {
+        int option = config.threading_mode == "multithread" ? SQLITE_CONFIG_MULTITHREAD : config.threading_mode == "serialized" ? SQLITE_CONFIG_SERIALIZED
+                                                                                                                                 : -1;
+        if (option == -1 || sqlite3_config(option) != SQLITE_OK)
+        {
+            std::cerr << "Unable to set threading mode: " << config.threading_mode << std::endl;
+            return -1;
+        }
+    }
+    if ((config.allocator != "default" || !config.memstatus) && !configure_memory(config))
+        return -1;
+    connection_lookaside = config.lookaside;
+    connection_file_config = config;
+
     std::vector<std::tuple<std::string, std::vector<std::string>>> pragmas_to_run = {
         // {"normal", {}},
         // {"synch_off", {"PRAGMA synchronous = OFF;"}},
@@ -896,7 +2926,7 @@ int main(int argc, char *argv[])
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
     sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
@@ -906,10 +2936,28 @@ int main(int argc, char *argv[])
     std::mt19937 rng(2025'07'08);
     if (fill(db, rng, entries, config.num_entries) != 0)
         return -1;
+
+    // The leased workloads allocate IDs above everything fill() created
+    uint64_t max_blockset = 0;
+    for (auto &entry : entries)
+        max_blockset = std::max(max_blockset, entry.blockset_id);
+    block_ids.next = config.num_entries;
+    blockset_ids.next = max_blockset + 1;
+    std::string sql_idlease = CREATE_IDLEASE_TABLE +
+                              "INSERT INTO IdLease (Name, NextID) VALUES ('Block', " + std::to_string(block_ids.next) + "), ('Blockset', " + std::to_string(blockset_ids.next) + ");";
+    if (!assert_sqlite_return_code(sqlite3_exec(db, sql_idlease.c_str(), nullptr, nullptr, nullptr), db, "Create IdLease table"))
+        return -1;
     sqlite3_close(db);
 
     std::filesystem::copy(DBPATH, DBPATH + ".backup", std::filesystem::copy_options::overwrite_existing);
 
+    // The upsert workloads need a UNIQUE (Hash, Size) index, so they get their own copy of the database.
+    std::filesystem::copy(DBPATH, DBPATH + ".unique", std::filesystem::copy_options::overwrite_existing);
+    sqlite3_open((DBPATH + ".unique").c_str(), &db);
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "DROP INDEX BlockHashSize; CREATE UNIQUE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr), db, "Create unique index"))
+        return -1;
+    sqlite3_close(db);
+
     for (auto &[report_name, pragmas] : pragmas_to_run)
     {
         int ret = measure_all(entries, config, report_name, pragmas);
@@ -920,7 +2968,7 @@ int main(int argc, char *argv[])
         }
     }
 
-    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal", DBPATH + ".backup"};
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal", DBPATH + ".backup", DBPATH + ".unique"};
     for (const auto &f : files)
     {
         if (std::filesystem::exists(f))
@@ -0,0 +1,881 @@
+#include "shared.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+// Page cache module (SQLITE_CONFIG_PCACHE2) storing all pages of a cache in one contiguous arena of fixed size slots, backed by huge pages
+// when available. Pages are found through an open addressing hash table, and evicted with the CLOCK policy. In shared mode, all caches
+// with the same slot size take their slots from a single arena.
+const uint32_t NO_SLOT = UINT32_MAX;
+
+struct PageHeader
+{
+    sqlite3_pcache_page page; // Must be first, SQLite hands it back to the module
+    uint32_t key;
+    uint32_t ring_index; // Position in the CLOCK ring of the owning cache
+    bool pinned;
+    bool referenced;
+};
+
+// Header, page buffer and extra space are kept on 64 byte boundaries
+const size_t SLOT_HEADER_SIZE = (sizeof(PageHeader) + 63) & ~size_t(63);
+
+struct Arena
+{
+    char *base = nullptr;
+    size_t bytes = 0;
+    size_t slot_size = 0;
+    uint32_t capacity = 0;
+    uint32_t next_unused = 0;
+    std::vector<uint32_t> free_slots;
+    std::string backing;
+    bool shared = false;
+    std::mutex mutex; // Only taken in shared mode
+
+    bool map(size_t slot_size, uint32_t capacity)
+    {
+        this->slot_size = slot_size;
+        this->capacity = capacity;
+        bytes = slot_size * capacity;
+#ifdef _WIN32
+        base = (char *)VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        backing = "virtualalloc";
+        return base != nullptr;
+#else
+        void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        // Explicit huge pages need to be reserved by the administrator, so this usually fails and falls back to transparent huge pages.
+        // MAP_NORESERVE is left out here, as touching an unreserved huge page raises SIGBUS instead of failing the mapping.
+        size_t huge_bytes = (bytes + (2 << 20) - 1) & ~size_t((2 << 20) - 1);
+        p = mmap(nullptr, huge_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            bytes = huge_bytes;
+            backing = "hugetlb";
+        }
+#endif
+        if (p == MAP_FAILED)
+        {
+            p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (p == MAP_FAILED)
+                return false;
+            backing = "regular";
+#ifdef MADV_HUGEPAGE
+            if (madvise(p, bytes, MADV_HUGEPAGE) == 0)
+                backing = "thp";
+#endif
+        }
+        base = (char *)p;
+        return true;
+#endif
+    }
+
+    void unmap()
+    {
+#ifdef _WIN32
+        VirtualFree(base, 0, MEM_RELEASE);
+#else
+        munmap(base, bytes);
+#endif
+        base = nullptr;
+    }
+
+    PageHeader *slot(uint32_t index)
+    {
+        return (PageHeader *)(base + (size_t)index * slot_size);
+    }
+
+    bool allocate(uint32_t &index)
+    {
+        std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+        if (shared)
+            lock.lock();
+        if (!free_slots.empty())
+        {
+            index = free_slots.back();
+            free_slots.pop_back();
+            return true;
+        }
+        if (next_unused == capacity)
+            return false;
+        index = next_unused++;
+        return true;
+    }
+
+    void release(uint32_t index)
+    {
+        std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+        if (shared)
+            lock.lock();
+        free_slots.push_back(index);
+    }
+};
+
+struct PcacheSettings
+{
+    uint32_t arena_pages = 0; // Slots per arena, must cover the largest cache_size used
+    bool shared = false;
+    Arena *shared_arena = nullptr;
+    std::string last_backing; // Backing of the most recently mapped arena, for the report
+    std::mutex mutex;         // Guards the two above, as connections on several threads create their caches at once
+};
+
+PcacheSettings pcache_settings;
+
+struct ClockCache
+{
+    Arena *arena;
+    bool owns_arena;
+    int page_size;
+    int extra_size;
+    bool purgeable;
+    uint32_t max_pages = 100;
+    uint32_t num_pages = 0;
+    std::vector<uint32_t> ring; // Slots held by this cache, swept by the CLOCK hand
+    size_t hand = 0;
+    std::vector<uint64_t> table; // Open addressing with linear probing, entries are key << 32 | slot, 0 is empty
+    uint64_t mask = 0;
+
+    uint64_t bucket(uint32_t key) const { return (key * 0x9E3779B97F4A7C15ULL >> 32) & mask; }
+
+    uint32_t find(uint32_t key) const
+    {
+        for (uint64_t i = bucket(key);; i = (i + 1) & mask)
+        {
+            uint64_t entry = table[i];
+            if (entry == 0)
+                return NO_SLOT;
+            if (entry >> 32 == key)
+                return (uint32_t)entry;
+        }
+    }
+
+    void insert(uint32_t key, uint32_t slot)
+    {
+        if ((num_pages + 1) * 2 > table.size())
+            grow();
+        uint64_t i = bucket(key);
+        while (table[i] != 0)
+            i = (i + 1) & mask;
+        table[i] = (uint64_t)key << 32 | slot;
+    }
+
+    // Backward shift deletion, so no tombstones are needed
+    void erase(uint32_t key)
+    {
+        uint64_t i = bucket(key);
+        while (table[i] >> 32 != key)
+            i = (i + 1) & mask;
+        uint64_t j = i;
+        while (true)
+        {
+            j = (j + 1) & mask;
+            if (table[j] == 0)
+                break;
+            uint64_t home = bucket(table[j] >> 32);
+            // Move the entry back if its home bucket is not within (i, j]
+            if (((j - home) & mask) >= ((j - i) & mask))
+            {
+                table[i] = table[j];
+                i = j;
+            }
+        }
+        table[i] = 0;
+    }
+
+    void grow()
+    {
+        std::vector<uint64_t> old = std::move(table);
+        table.assign(std::max<size_t>(old.size() * 2, 64), 0);
+        mask = table.size() - 1;
+        for (uint64_t entry : old)
+        {
+            if (entry == 0)
+                continue;
+            uint64_t i = bucket(entry >> 32);
+            while (table[i] != 0)
+                i = (i + 1) & mask;
+            table[i] = entry;
+        }
+    }
+
+    // Finds an unpinned page that has not been referenced since the hand last passed it
+    bool find_victim(size_t &ring_index)
+    {
+        for (size_t steps = 0; steps < 2 * ring.size(); steps++)
+        {
+            size_t i = hand;
+            hand = (hand + 1) % ring.size();
+            PageHeader *header = arena->slot(ring[i]);
+            if (header->pinned)
+                continue;
+            if (header->referenced)
+            {
+                header->referenced = false;
+                continue;
+            }
+            ring_index = i;
+            return true;
+        }
+        return false;
+    }
+
+    void remove(PageHeader *header)
+    {
+        erase(header->key);
+        uint32_t slot = ring[header->ring_index];
+        ring[header->ring_index] = ring.back();
+        arena->slot(ring.back())->ring_index = header->ring_index;
+        ring.pop_back();
+        if (hand >= ring.size())
+            hand = 0;
+        arena->release(slot);
+        num_pages--;
+    }
+};
+
+int clock_init(void *arg)
+{
+    return SQLITE_OK;
+}
+
+void clock_shutdown(void *arg)
+{
+    if (pcache_settings.shared_arena != nullptr)
+    {
+        pcache_settings.shared_arena->unmap();
+        delete pcache_settings.shared_arena;
+        pcache_settings.shared_arena = nullptr;
+    }
+}
+
+sqlite3_pcache *clock_create(int page_size, int extra_size, int purgeable)
+{
+    auto cache = new ClockCache();
+    cache->page_size = page_size;
+    cache->extra_size = extra_size;
+    cache->purgeable = purgeable;
+    cache->grow();
+
+    size_t slot_size = (SLOT_HEADER_SIZE + page_size + extra_size + 63) & ~size_t(63);
+    std::lock_guard<std::mutex> lock(pcache_settings.mutex);
+    if (pcache_settings.shared && pcache_settings.shared_arena == nullptr)
+    {
+        pcache_settings.shared_arena = new Arena();
+        pcache_settings.shared_arena->shared = true;
+        if (!pcache_settings.shared_arena->map(slot_size, pcache_settings.arena_pages))
+        {
+            delete pcache_settings.shared_arena;
+            pcache_settings.shared_arena = nullptr;
+        }
+    }
+
+    // Caches with another page size than the shared arena was created for get their own arena
+    if (pcache_settings.shared && pcache_settings.shared_arena != nullptr && pcache_settings.shared_arena->slot_size == slot_size)
+    {
+        cache->arena = pcache_settings.shared_arena;
+        cache->owns_arena = false;
+    }
+    else
+    {
+        cache->arena = new Arena();
+        cache->owns_arena = true;
+        if (!cache->arena->map(slot_size, pcache_settings.arena_pages))
+        {
+            delete cache->arena;
+            delete cache;
+            return nullptr;
+        }
+    }
+    pcache_settings.last_backing = cache->arena->backing;
+
+    return (sqlite3_pcache *)cache;
+}
+
+void clock_cachesize(sqlite3_pcache *p, int max_pages)
+{
+    auto cache = (ClockCache *)p;
+    cache->max_pages = std::min<uint32_t>(max_pages, cache->arena->capacity);
+    size_t ring_index;
+    while (cache->purgeable && cache->num_pages > cache->max_pages && cache->find_victim(ring_index))
+        cache->remove(cache->arena->slot(cache->ring[ring_index]));
+}
+
+int clock_pagecount(sqlite3_pcache *p)
+{
+    return ((ClockCache *)p)->num_pages;
+}
+
+sqlite3_pcache_page *clock_fetch(sqlite3_pcache *p, unsigned key, int create)
+{
+    auto cache = (ClockCache *)p;
+    uint32_t slot = cache->find(key);
+    if (slot != NO_SLOT)
+    {
+        PageHeader *header = cache->arena->slot(slot);
+        header->pinned = true;
+        header->referenced = true;
+        return &header->page;
+    }
+    if (create == 0)
+        return nullptr;
+
+    // Below the limit a new slot is taken from the arena, otherwise an unpinned page is replaced. When SQLite insists (create == 2),
+    // the cache may go over its limit as long as the arena has room.
+    bool fresh = false;
+    size_t ring_index;
+    if ((!cache->purgeable || cache->num_pages < cache->max_pages) && cache->arena->allocate(slot))
+        fresh = true;
+    else if (cache->find_victim(ring_index))
+    {
+        slot = cache->ring[ring_index];
+        cache->erase(cache->arena->slot(slot)->key);
+        cache->num_pages--;
+    }
+    else if (create == 2 && cache->arena->allocate(slot))
+        fresh = true;
+    else
+        return nullptr;
+
+    PageHeader *header = cache->arena->slot(slot);
+    if (fresh)
+    {
+        header->page.pBuf = (char *)header + SLOT_HEADER_SIZE;
+        header->page.pExtra = (char *)header->page.pBuf + cache->page_size;
+        header->ring_index = cache->ring.size();
+        cache->ring.push_back(slot);
+    }
+    // SQLite expects the extra space of a new page to start zeroed
+    std::memset(header->page.pExtra, 0, cache->extra_size);
+    header->key = key;
+    header->pinned = true;
+    header->referenced = true;
+    cache->insert(key, slot);
+    cache->num_pages++;
+
+    return &header->page;
+}
+
+void clock_unpin(sqlite3_pcache *p, sqlite3_pcache_page *page, int discard)
+{
+    auto cache = (ClockCache *)p;
+    auto header = (PageHeader *)page;
+    header->pinned = false;
+    if (discard || (cache->purgeable && cache->num_pages > cache->max_pages))
+        cache->remove(header);
+}
+
+void clock_rekey(sqlite3_pcache *p, sqlite3_pcache_page *page, unsigned old_key, unsigned new_key)
+{
+    auto cache = (ClockCache *)p;
+    auto header = (PageHeader *)page;
+    // Any page already using the new key is guaranteed to be unpinned, and must be discarded
+    uint32_t existing = cache->find(new_key);
+    if (existing != NO_SLOT)
+        cache->remove(cache->arena->slot(existing));
+    cache->erase(old_key);
+    header->key = new_key;
+    cache->insert(new_key, cache->ring[header->ring_index]);
+}
+
+void clock_truncate(sqlite3_pcache *p, unsigned limit)
+{
+    auto cache = (ClockCache *)p;
+    // Walk backwards, as remove() moves the last page of the ring into the removed position
+    for (size_t i = cache->ring.size(); i-- > 0;)
+    {
+        PageHeader *header = cache->arena->slot(cache->ring[i]);
+        if (header->key >= limit)
+            cache->remove(header);
+    }
+}
+
+void clock_destroy(sqlite3_pcache *p)
+{
+    auto cache = (ClockCache *)p;
+    if (cache->owns_arena)
+    {
+        cache->arena->unmap();
+        delete cache->arena;
+    }
+    else
+    {
+        for (uint32_t slot : cache->ring)
+            cache->arena->release(slot);
+    }
+    delete cache;
+}
+
+void clock_shrink(sqlite3_pcache *p)
+{
+    auto cache = (ClockCache *)p;
+    for (size_t i = cache->ring.size(); i-- > 0;)
+    {
+        PageHeader *header = cache->arena->slot(cache->ring[i]);
+        if (!header->pinned)
+            cache->remove(header);
+    }
+}
+
+sqlite3_pcache_methods2 clock_pcache_methods()
+{
+    sqlite3_pcache_methods2 methods = {};
+    methods.iVersion = 1;
+    methods.xInit = clock_init;
+    methods.xShutdown = clock_shutdown;
+    methods.xCreate = clock_create;
+    methods.xCachesize = clock_cachesize;
+    methods.xPagecount = clock_pagecount;
+    methods.xFetch = clock_fetch;
+    methods.xUnpin = clock_unpin;
+    methods.xRekey = clock_rekey;
+    methods.xTruncate = clock_truncate;
+    methods.xDestroy = clock_destroy;
+    methods.xShrink = clock_shrink;
+    return methods;
+}
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+// The read workloads also run on several threads at once, which all report through report_stats
+std::mutex report_mutex;
+
+int measure(
+    sqlite3 *db,
+    Config &config,
+    std::mt19937 &rng,
+    const std::function<int(sqlite3 *, const Entry &, uint64_t, const std::string &)> &f,
+    const std::string &report_name,
+    const int create_entry, // Percentage probability of creating a new entry
+    const std::vector<Entry> &entries)
+{
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    uint64_t next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_warmup; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[i % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (f(db, entry, i, "Warmup") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    std::vector<uint64_t> times;
+    next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_repetitions; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()];
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        if (f(db, entry, i, "Actual") != 0)
+            return -1;
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    std::lock_guard<std::mutex> lock(report_mutex);
+    report_stats(config, times, report_name);
+
+    return 0;
+}
+
+int measure_select(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string sql = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare select statement"))
+        return -1;
+
+    auto select_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_text(stmt, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt), db, prefix + " query execution " + std::to_string(i)))
+            return -1;
+        if (!assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt, 0), prefix + " ID check"))
+            return -1;
+        sqlite3_reset(stmt);
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, select_inner, report_name, -1, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt);
+
+    return 0;
+}
+
+int measure_xor1(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string
+        sql_select = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_insert = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);";
+    sqlite3_stmt *stmt_select, *stmt_insert;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor select statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert.c_str(), -1, &stmt_insert, nullptr), db, "Prepare xor insert statement"))
+        return -1;
+
+    auto xor_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_select, 2, entry.size);
+        auto rc = sqlite3_step(stmt_select);
+        if (!assert_sqlite_return_code(rc, db, prefix + " xor1 query execution " + std::to_string(i)))
+            return -1;
+        auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_select, 0) : -1;
+        sqlite3_reset(stmt_select);
+
+        if (found_id == -1)
+        {
+            // Not found, insert
+            sqlite3_bind_int64(stmt_insert, 1, entry.id);
+            sqlite3_bind_text(stmt_insert, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_insert, 3, entry.size);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_insert), db, prefix + " xor1 insert " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_insert);
+        }
+        else
+        {
+            if (!assert_value_matches(entry.id, (uint64_t)found_id, prefix + " xor1 ID check"))
+                return -1;
+        }
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, xor_inner, report_name, 50, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt_select);
+    sqlite3_finalize(stmt_insert);
+
+    return 0;
+}
+
+uint64_t blockset_count(uint64_t blockset_id, const std::vector<Entry> &entries)
+{
+    uint64_t count = 0;
+    for (const auto &entry : entries)
+    {
+        if (entry.blockset_id == blockset_id)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+int measure_join(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string sql = "SELECT Block.ID, Block.Hash, Block.Size FROM Block JOIN BlocksetEntry ON BlocksetEntry.BlockID = Block.ID WHERE BlocksetEntry.BlocksetID = ?;";
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare join statement"))
+        return -1;
+
+    uint64_t max_blockset = 0;
+    for (auto &entry : entries)
+    {
+        max_blockset = std::max(max_blockset, entry.blockset_id);
+    }
+
+    auto join_inner = [=](sqlite3 *db, uint64_t blockset_id, uint64_t expected_count, const std::string &prefix) -> int
+    {
+        sqlite3_bind_int64(stmt, 1, blockset_id);
+        uint64_t count = 0;
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            // Process the row
+            auto found_id = sqlite3_column_int64(stmt, 0);
+            auto found_hash = std::string((const char *)sqlite3_column_text(stmt, 1));
+            auto found_size = (uint64_t)sqlite3_column_int64(stmt, 2);
+            auto entry = entries[found_id];
+            if (!assert_value_matches(entry.hash, found_hash, "Hash check"))
+                return -1;
+            if (!assert_value_matches(entry.size, found_size, "Size check"))
+                return -1;
+            if (!assert_value_matches(entry.blockset_id, blockset_id, "Blockset ID check"))
+                return -1;
+            count++;
+        }
+        if (!assert_value_matches(expected_count, count, "Blockset count check"))
+            return -1;
+        sqlite3_reset(stmt);
+
+        return 0;
+    };
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    for (uint64_t i = 0; i < config.num_warmup; i++)
+    {
+        uint64_t blockset_id = (rng() % max_blockset) + 1;
+        uint64_t expected_count = blockset_count(blockset_id, entries);
+        if (join_inner(db, blockset_id, expected_count, "Warmup") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    std::vector<uint64_t> times;
+    uint64_t total_rows = 0;
+    while (total_rows < config.num_repetitions)
+    {
+        uint64_t blockset_id = (rng() % max_blockset) + 1;
+        uint64_t expected_count = blockset_count(blockset_id, entries);
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        if (join_inner(db, blockset_id, expected_count, "Actual") != 0)
+            return -1;
+        auto end = std::chrono::high_resolution_clock::now();
+
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / expected_count);
+        total_rows += expected_count;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_finalize(stmt);
+
+    std::lock_guard<std::mutex> lock(report_mutex);
+    report_stats(config, times, report_name);
+
+    return 0;
+}
+
+// Runs the read workloads on config.num_threads connections at once, so their caches are in use at the same time. Only then do the
+// caches of the shared mode compete for the slots and the lock of the shared arena. Every connection appends its own row to the reports.
+int measure_concurrent(Config &config, const std::vector<Entry> &entries, int cache_size, const std::string &suffix)
+{
+    std::vector<std::thread> threads;
+    std::vector<int> return_codes(config.num_threads, 0);
+    std::string report_suffix = suffix + "_" + std::to_string(config.num_threads) + "_connections";
+    for (int tid = 0; tid < config.num_threads; tid++)
+    {
+        threads.emplace_back([&, tid]()
+                             {
+            sqlite3 *db;
+            sqlite3_open(DBPATH.c_str(), &db);
+            std::mt19937 rng(~2025'07'08 + tid);
+            std::string pragma = "PRAGMA cache_size = " + std::to_string(cache_size) + ";";
+            sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr);
+            if (measure_select(db, config, rng, entries, "pcache_select_" + report_suffix) != 0 ||
+                measure_join(db, config, rng, entries, "pcache_join_" + report_suffix) != 0)
+                return_codes[tid] = -1;
+            sqlite3_close(db); });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    for (auto return_code : return_codes)
+        if (return_code != 0)
+            return -1;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    std::vector<std::tuple<std::string, int>> cache_sizes = {
+        {"cache_size_2M", -2000},
+        {"cache_size_8M", -8000},
+        {"cache_size_32M", -32000},
+        {"cache_size_128M", -128000},
+        {"cache_size_512M", -512000}};
+
+    // The arenas must hold the largest cache, plus the pages SQLite may pin beyond the limit
+    pcache_settings.arena_pages = 512'000'000 / 4096 + 4096;
+
+    // The default page cache has to be saved before any other is configured
+    sqlite3_pcache_methods2 default_methods, clock_methods = clock_pcache_methods();
+    sqlite3_config(SQLITE_CONFIG_GETPCACHE2, &default_methods);
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    auto db = setup_database(table_queries, config);
+
+    sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetBlocksetID ON Blockset(ID);", nullptr, nullptr, nullptr);
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(db, rng, entries, config.num_entries) != 0)
+        return -1;
+    sqlite3_close(db);
+
+    std::vector<std::tuple<std::string, sqlite3_pcache_methods2 *, bool>> implementations = {
+        {"default", &default_methods, false},
+        {"clock", &clock_methods, false},
+        {"clock_shared", &clock_methods, true}};
+
+    for (auto &[implementation, methods, shared] : implementations)
+    {
+        // The page cache can only be swapped while SQLite is shut down
+        sqlite3_shutdown();
+        pcache_settings.shared = shared;
+        if (sqlite3_config(SQLITE_CONFIG_PCACHE2, methods) != SQLITE_OK || sqlite3_initialize() != SQLITE_OK || !slow_vfs::install())
+        {
+            std::cerr << "Unable to install page cache " << implementation << std::endl;
+            return -1;
+        }
+
+        for (auto &[cache_name, cache_size] : cache_sizes)
+        {
+            sqlite3_open(DBPATH.c_str(), &db);
+            rng.seed(~2025'07'08);
+            std::string pragma = "PRAGMA cache_size = " + std::to_string(cache_size) + ";";
+            sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr);
+
+            std::string suffix = implementation + "_" + cache_name;
+            if (measure_select(db, config, rng, entries, "pcache_select_" + suffix) != 0)
+                return -1;
+            if (measure_xor1(db, config, rng, entries, "pcache_xor1_" + suffix) != 0)
+                return -1;
+            if (measure_join(db, config, rng, entries, "pcache_join_" + suffix) != 0)
+                return -1;
+
+            sqlite3_close(db);
+
+            if (measure_concurrent(config, entries, cache_size, suffix) != 0)
+                return -1;
+        }
+
+        if (implementation != "default")
+            std::cout << "Page cache " << implementation << " used " << pcache_settings.last_backing << " arena pages" << std::endl;
+    }
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
@@ -0,0 +1,656 @@
+#include "shared.hpp"
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+const uint64_t
+    CHANNEL_CAPACITY = 1024,  // Slots in each channel, a power of two
+    MAX_FILE_BLOCKS = 64,     // Files have between 1 and this many blocks
+    VOLUME_COST_NS = 1000;    // CPU time the volume writer spends compressing and writing each new block
+const std::chrono::milliseconds SAMPLE_INTERVAL(10);
+
+// Emulates the channel pipeline of a backup: file enumeration -> block hashing -> block lookup -> volume writer -> database insert.
+// The hashing stage runs on --num-threads threads, the others on one thread each. Half of the hashed blocks already exist in the
+// database, as in xor1, and the database stage adds the new blocks and a blockset per file, as in new_blockset.
+struct File
+{
+    uint64_t id;
+    uint64_t num_blocks;
+};
+
+struct Block
+{
+    uint64_t file_id;
+    uint64_t index;
+    bool last;
+    std::string hash;
+    uint64_t size;
+    int64_t id; // Found by the lookup stage, -1 for new blocks
+};
+
+// Bounded single-producer single-consumer ring buffer
+template <typename T>
+struct SpscChannel
+{
+    std::unique_ptr<T[]> slots = std::make_unique<T[]>(CHANNEL_CAPACITY);
+    alignas(64) std::atomic<uint64_t> head = 0; // Next slot to pop
+    alignas(64) std::atomic<uint64_t> tail = 0; // Next slot to push
+    std::atomic<bool> closed = false;
+
+    bool try_push(T &value)
+    {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == CHANNEL_CAPACITY)
+            return false;
+        slots[t & (CHANNEL_CAPACITY - 1)] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &value)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        value = std::move(slots[h & (CHANNEL_CAPACITY - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t depth() { return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed); }
+};
+
+// Bounded multi-producer multi-consumer ring buffer (Vyukov), where each slot carries a sequence number telling whose turn it is
+template <typename T>
+struct MpmcChannel
+{
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+    std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(CHANNEL_CAPACITY);
+    alignas(64) std::atomic<uint64_t> head = 0;
+    alignas(64) std::atomic<uint64_t> tail = 0;
+    std::atomic<bool> closed = false;
+
+    MpmcChannel()
+    {
+        for (uint64_t i = 0; i < CHANNEL_CAPACITY; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool try_push(T &value)
+    {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = slots[t & (CHANNEL_CAPACITY - 1)];
+            int64_t diff = (int64_t)slot.sequence.load(std::memory_order_acquire) - (int64_t)t;
+            if (diff == 0 && tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed))
+            {
+                slot.value = std::move(value);
+                slot.sequence.store(t + 1, std::memory_order_release);
+                return true;
+            }
+            if (diff < 0)
+                return false; // Full
+            if (diff > 0)
+                t = tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool try_pop(T &value)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = slots[h & (CHANNEL_CAPACITY - 1)];
+            int64_t diff = (int64_t)slot.sequence.load(std::memory_order_acquire) - (int64_t)(h + 1);
+            if (diff == 0 && head.compare_exchange_weak(h, h + 1, std::memory_order_relaxed))
+            {
+                value = std::move(slot.value);
+                slot.sequence.store(h + CHANNEL_CAPACITY, std::memory_order_release);
+                return true;
+            }
+            if (diff < 0)
+                return false; // Empty
+            if (diff > 0)
+                h = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t depth()
+    {
+        uint64_t h = head.load(std::memory_order_relaxed), t = tail.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+};
+
+// Time a stage spends working, waiting for room downstream (backpressure), and waiting for input (starvation), summed over its threads
+struct alignas(64) StageStats
+{
+    std::string name;
+    uint64_t threads = 1;
+    std::atomic<uint64_t> items = 0, busy_ns = 0, full_ns = 0, empty_ns = 0;
+};
+
+uint64_t elapsed_ns(std::chrono::high_resolution_clock::time_point begin)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - begin).count();
+}
+
+// Gives up when a stage has failed, as the stages after it may no longer consume
+template <typename Channel, typename T>
+void push(Channel &channel, T &value, StageStats &stats, const std::atomic<bool> &failed)
+{
+    if (channel.try_push(value))
+        return;
+    auto begin = std::chrono::high_resolution_clock::now();
+    while (!channel.try_push(value) && !failed.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+    stats.full_ns.fetch_add(elapsed_ns(begin), std::memory_order_relaxed);
+}
+
+// Returns false once the channel is closed and drained, or when a stage has failed
+template <typename Channel, typename T>
+bool pop(Channel &channel, T &value, StageStats &stats, const std::atomic<bool> &failed)
+{
+    if (channel.try_pop(value))
+        return true;
+    auto begin = std::chrono::high_resolution_clock::now();
+    bool popped = false;
+    while (!(popped = channel.try_pop(value)))
+    {
+        if (failed.load(std::memory_order_relaxed))
+            break;
+        if (channel.closed.load(std::memory_order_acquire))
+        {
+            popped = channel.try_pop(value); // Items pushed right before closing
+            break;
+        }
+        std::this_thread::yield();
+    }
+    stats.empty_ns.fetch_add(elapsed_ns(begin), std::memory_order_relaxed);
+    return popped;
+}
+
+void spin_for(uint64_t ns)
+{
+    auto deadline = std::chrono::high_resolution_clock::now() + std::chrono::nanoseconds(ns);
+    while (std::chrono::high_resolution_clock::now() < deadline)
+        ;
+}
+
+struct Pipeline
+{
+    MpmcChannel<File> files;      // Enumeration to the hashing threads
+    MpmcChannel<Block> hashed;    // Hashing threads to lookup
+    SpscChannel<Block> looked_up; // Lookup to the volume writer
+    SpscChannel<Block> written;   // Volume writer to the database
+    StageStats enumerate, hash, lookup, volume, database;
+    std::atomic<uint64_t> hashers_running = 0;
+    std::atomic<bool> failed = false;
+};
+
+void run_enumerate(Pipeline &pipeline, uint64_t num_blocks)
+{
+    std::mt19937 rng(2025'07'08);
+    uint64_t blocks = 0;
+    for (uint64_t id = 0; blocks < num_blocks; id++)
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        File file = {id, std::min<uint64_t>(1 + rng() % MAX_FILE_BLOCKS, num_blocks - blocks)};
+        blocks += file.num_blocks;
+        pipeline.enumerate.busy_ns.fetch_add(elapsed_ns(begin), std::memory_order_relaxed);
+        pipeline.enumerate.items.fetch_add(1, std::memory_order_relaxed);
+        push(pipeline.files, file, pipeline.enumerate, pipeline.failed);
+    }
+    pipeline.files.closed = true;
+}
+
+void run_hash(Pipeline &pipeline, int tid, Config &config, const std::vector<Entry> &entries)
+{
+    std::mt19937 rng(~2025'07'08 + tid);
+    File file;
+    while (pop(pipeline.files, file, pipeline.hash, pipeline.failed))
+    {
+        for (uint64_t i = 0; i < file.num_blocks; i++)
+        {
+            auto begin = std::chrono::high_resolution_clock::now();
+            Block block = {file.id, i, i + 1 == file.num_blocks, "", 0, -1};
+            if (rng() % 2 == 0) // 50% chance of a block that already exists
+            {
+                const Entry &entry = entries[rng() % entries.size()];
+                block.hash = entry.hash;
+                block.size = entry.size;
+            }
+            else
+            {
+                block.hash = random_hash_string(rng, 44);
+                block.size = rng() % 1000;
+            }
+            spin_for(config.hash_cost_ns);
+            pipeline.hash.busy_ns.fetch_add(elapsed_ns(begin), std::memory_order_relaxed);
+            pipeline.hash.items.fetch_add(1, std::memory_order_relaxed);
+            push(pipeline.hashed, block, pipeline.hash, pipeline.failed);
+        }
+    }
+    if (pipeline.hashers_running.fetch_sub(1) == 1)
+        pipeline.hashed.closed = true;
+}
+
+int lookup_blocks(Pipeline &pipeline, const std::vector<std::string> &pragmas)
+{
+    sqlite3 *db;
+    if (!assert_sqlite_return_code(sqlite3_open_v2(DBPATH.c_str(), &db, SQLITE_OPEN_READONLY, nullptr), db, "Open lookup connection"))
+        return -1;
+    for (const auto &pragma : pragmas)
+        sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr);
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;", -1, &stmt, nullptr), db, "Prepare lookup statement"))
+        return -1;
+
+    Block block;
+    while (pop(pipeline.hashed, block, pipeline.lookup, pipeline.failed))
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        sqlite3_bind_text(stmt, 1, block.hash.c_str(), block.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, block.size);
+        int rc = sqlite3_step(stmt);
+        if (!assert_sqlite_return_code(rc, db, "Lookup block"))
+            return -1;
+        block.id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+        sqlite3_reset(stmt);
+        pipeline.lookup.busy_ns.fetch_add(elapsed_ns(begin), std::memory_order_relaxed);
+        pipeline.lookup.items.fetch_add(1, std::memory_order_relaxed);
+        push(pipeline.looked_up, block, pipeline.lookup, pipeline.failed);
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return 0;
+}
+
+void run_lookup(Pipeline &pipeline, const std::vector<std::string> &pragmas, int &return_code)
+{
+    return_code = lookup_blocks(pipeline, pragmas);
+    if (return_code != 0)
+        pipeline.failed = true;
+    pipeline.looked_up.closed = true;
+}
+
+void run_volume(Pipeline &pipeline)
+{
+    Block block;
+    while (pop(pipeline.looked_up, block, pipeline.volume, pipeline.failed))
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        if (block.id == -1)
+            spin_for(VOLUME_COST_NS);
+        pipeline.volume.busy_ns.fetch_add(elapsed_ns(begin), std::memory_order_relaxed);
+        pipeline.volume.items.fetch_add(1, std::memory_order_relaxed);
+        push(pipeline.written, block, pipeline.volume, pipeline.failed);
+    }
+    pipeline.written.closed = true;
+}
+
+// Inserts the new blocks and the blocksets of the files. The files of the hashing threads interleave, so a blockset is kept open per
+// file until its last block arrives. Commits every --num-batch blocks, or when a file completes if it is 0.
+int insert_blocks(Pipeline &pipeline, const std::vector<std::string> &pragmas, Config &config)
+{
+    sqlite3 *db;
+    if (!assert_sqlite_return_code(sqlite3_open_v2(DBPATH.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr), db, "Open database connection"))
+        return -1;
+    for (const auto &pragma : pragmas)
+        sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr);
+    std::string
+        sql_insert_block = "INSERT INTO Block (Hash, Size) VALUES (?, ?);",
+        sql_start_blockset = "INSERT INTO Blockset (Length) VALUES (0);",
+        sql_insert_blockset_entry = "INSERT INTO BlocksetEntry (BlocksetID, BlockID) VALUES (?, ?);",
+        sql_finish_blockset = "UPDATE Blockset SET Length = ? WHERE ID = ?;";
+    sqlite3_stmt *stmt_insert_block, *stmt_start_blockset, *stmt_insert_blockset_entry, *stmt_finish_blockset;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_block.c_str(), -1, &stmt_insert_block, nullptr), db, "Prepare insert block statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_start_blockset.c_str(), -1, &stmt_start_blockset, nullptr), db, "Prepare start blockset statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_blockset_entry.c_str(), -1, &stmt_insert_blockset_entry, nullptr), db, "Prepare insert blockset entry statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_finish_blockset.c_str(), -1, &stmt_finish_blockset, nullptr), db, "Prepare finish blockset statement"))
+        return -1;
+
+    std::unordered_map<uint64_t, uint64_t> open_blocksets; // File ID to blockset ID
+    uint64_t uncommitted = 0;
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    Block block;
+    while (pop(pipeline.written, block, pipeline.database, pipeline.failed))
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        if (block.id == -1)
+        {
+            sqlite3_bind_text(stmt_insert_block, 1, block.hash.c_str(), block.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_insert_block, 2, block.size);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_insert_block), db, "Insert block"))
+                return -1;
+            sqlite3_reset(stmt_insert_block);
+            block.id = sqlite3_last_insert_rowid(db);
+        }
+
+        auto it = open_blocksets.find(block.file_id);
+        if (it == open_blocksets.end())
+        {
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_start_blockset), db, "Start blockset"))
+                return -1;
+            sqlite3_reset(stmt_start_blockset);
+            it = open_blocksets.emplace(block.file_id, sqlite3_last_insert_rowid(db)).first;
+        }
+        sqlite3_bind_int64(stmt_insert_blockset_entry, 1, it->second);
+        sqlite3_bind_int64(stmt_insert_blockset_entry, 2, block.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_insert_blockset_entry), db, "Insert blockset entry"))
+            return -1;
+        sqlite3_reset(stmt_insert_blockset_entry);
+
+        if (block.last)
+        {
+            sqlite3_bind_int64(stmt_finish_blockset, 1, block.index + 1);
+            sqlite3_bind_int64(stmt_finish_blockset, 2, it->second);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_finish_blockset), db, "Finish blockset"))
+                return -1;
+            sqlite3_reset(stmt_finish_blockset);
+            open_blocksets.erase(it);
+        }
+
+        uncommitted++;
+        if (config.num_batch > 0 ? uncommitted >= config.num_batch : block.last)
+        {
+            if (!assert_sqlite_return_code(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr), db, "Commit"))
+                return -1;
+            sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+            uncommitted = 0;
+        }
+        pipeline.database.busy_ns.fetch_add(elapsed_ns(begin), std::memory_order_relaxed);
+        pipeline.database.items.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr), db, "Commit"))
+        return -1;
+
+    sqlite3_finalize(stmt_insert_block);
+    sqlite3_finalize(stmt_start_blockset);
+    sqlite3_finalize(stmt_insert_blockset_entry);
+    sqlite3_finalize(stmt_finish_blockset);
+    sqlite3_close(db);
+    return 0;
+}
+
+void run_database(Pipeline &pipeline, const std::vector<std::string> &pragmas, Config &config, int &return_code)
+{
+    return_code = insert_blocks(pipeline, pragmas, config);
+    if (return_code != 0)
+        pipeline.failed = true;
+}
+
+struct TimelineSample
+{
+    uint64_t elapsed_us;
+    std::vector<uint64_t> busy_ns; // Per stage, cumulative
+    std::vector<uint64_t> depths;  // Of the channel feeding each stage
+};
+
+// Runs the pipeline over num_blocks blocks. The timeline is sampled every SAMPLE_INTERVAL when given.
+int run_pipeline(Pipeline &pipeline, uint64_t num_blocks, Config &config, const std::vector<Entry> &entries, const std::vector<std::string> &pragmas, std::vector<TimelineSample> *timeline)
+{
+    std::vector<StageStats *> stages = {&pipeline.enumerate, &pipeline.hash, &pipeline.lookup, &pipeline.volume, &pipeline.database};
+    pipeline.hashers_running = config.num_threads;
+
+    std::atomic<bool> running = true;
+    std::thread sampler;
+    auto begin = std::chrono::high_resolution_clock::now();
+    if (timeline != nullptr)
+        sampler = std::thread([&]()
+                              {
+            while (running.load())
+            {
+                TimelineSample sample = {(uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - begin).count()};
+                for (auto stage : stages)
+                    sample.busy_ns.push_back(stage->busy_ns.load(std::memory_order_relaxed));
+                sample.depths = {0, pipeline.files.depth(), pipeline.hashed.depth(), pipeline.looked_up.depth(), pipeline.written.depth()};
+                timeline->push_back(sample);
+                std::this_thread::sleep_for(SAMPLE_INTERVAL);
+            } });
+
+    int lookup_rc, database_rc;
+    std::vector<std::thread> threads;
+    threads.emplace_back(run_enumerate, std::ref(pipeline), num_blocks);
+    for (int i = 0; i < config.num_threads; i++)
+        threads.emplace_back(run_hash, std::ref(pipeline), i, std::ref(config), std::cref(entries));
+    threads.emplace_back(run_lookup, std::ref(pipeline), std::cref(pragmas), std::ref(lookup_rc));
+    threads.emplace_back(run_volume, std::ref(pipeline));
+    threads.emplace_back(run_database, std::ref(pipeline), std::cref(pragmas), std::ref(config), std::ref(database_rc));
+    for (auto &thread : threads)
+        thread.join();
+
+    running = false;
+    if (sampler.joinable())
+        sampler.join();
+
+    return lookup_rc != 0 || database_rc != 0 ? -1 : 0;
+}
+
+int measure(std::vector<Entry> &entries, Config &config, const std::vector<std::string> &pragmas)
+{
+    // Copy the backed up database
+    auto copy_db = []()
+    {
+        std::filesystem::remove(DBPATH + "-shm");
+        std::filesystem::remove(DBPATH + "-wal");
+        std::filesystem::copy_file(DBPATH + ".backup", DBPATH, std::filesystem::copy_options::overwrite_existing);
+        sqlite3 *db;
+        sqlite3_open(DBPATH.c_str(), &db);
+        sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+        sqlite3_wal_checkpoint(db, nullptr);
+        sqlite3_close(db);
+    };
+
+    copy_db();
+    {
+        Pipeline warmup;
+        if (run_pipeline(warmup, config.num_warmup, config, entries, pragmas, nullptr) != 0)
+            return -1;
+    }
+
+    copy_db();
+    Pipeline pipeline;
+    pipeline.enumerate.name = "enumerate";
+    pipeline.hash.name = "hash";
+    pipeline.hash.threads = config.num_threads;
+    pipeline.lookup.name = "lookup";
+    pipeline.volume.name = "volume";
+    pipeline.database.name = "database";
+    std::vector<StageStats *> stages = {&pipeline.enumerate, &pipeline.hash, &pipeline.lookup, &pipeline.volume, &pipeline.database};
+    std::vector<TimelineSample> timeline;
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    if (run_pipeline(pipeline, config.num_repetitions, config, entries, pragmas, &timeline) != 0)
+        return -1;
+    auto end = std::chrono::high_resolution_clock::now();
+    uint64_t time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+
+    std::cout << "Pipeline with " << config.num_threads << " hashing threads, " << config.hash_cost_ns << " ns per hash: "
+              << float(config.num_repetitions) / (float(time_ns) / 1e6) << " kblocks/s, utilisation";
+    for (auto stage : stages)
+        std::cout << " " << stage->name << " " << 100.0 * stage->busy_ns / (time_ns * stage->threads) << "%";
+    std::cout << std::endl;
+
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    bool emit_header = !std::filesystem::exists("reports/pipeline.csv");
+    std::ofstream report_file("reports/pipeline.csv", std::ios::app);
+    if (emit_header)
+        report_file << "num_entries,num_warmup,num_repetitions,num_threads,hash_cost_ns,num_batch,time_us,kblocks_s,stage,stage_threads,items,busy_pct,full_pct,empty_pct\n";
+    for (auto stage : stages)
+    {
+        double stage_ns = double(time_ns) * stage->threads;
+        report_file << config.num_entries << ","
+                    << config.num_warmup << ","
+                    << config.num_repetitions << ","
+                    << config.num_threads << ","
+                    << config.hash_cost_ns << ","
+                    << config.num_batch << ","
+                    << time_ns / 1000 << ","
+                    << float(config.num_repetitions) / (float(time_ns) / 1e6) << ","
+                    << stage->name << ","
+                    << stage->threads << ","
+                    << stage->items << ","
+                    << 100.0 * stage->busy_ns / stage_ns << ","
+                    << 100.0 * stage->full_ns / stage_ns << ","
+                    << 100.0 * stage->empty_ns / stage_ns << "\n";
+    }
+
+    // Utilisation over each sample interval, and the depth of the channel feeding each stage at the start of it
+    emit_header = !std::filesystem::exists("reports/pipeline_timeline.csv");
+    std::ofstream timeline_file("reports/pipeline_timeline.csv", std::ios::app);
+    if (emit_header)
+        timeline_file << "num_entries,num_repetitions,num_threads,hash_cost_ns,num_batch,elapsed_us,stage,busy_pct,queue_depth\n";
+    for (size_t i = 0; i + 1 < timeline.size(); i++)
+    {
+        uint64_t interval_ns = (timeline[i + 1].elapsed_us - timeline[i].elapsed_us) * 1000;
+        for (size_t s = 0; s < stages.size(); s++)
+        {
+            timeline_file << config.num_entries << ","
+                          << config.num_repetitions << ","
+                          << config.num_threads << ","
+                          << config.hash_cost_ns << ","
+                          << config.num_batch << ","
+                          << timeline[i].elapsed_us << ","
+                          << stages[s]->name << ","
+                          << 100.0 * (timeline[i + 1].busy_ns[s] - timeline[i].busy_ns[s]) / (std::max<uint64_t>(1, interval_ns) * stages[s]->threads) << ","
+                          << timeline[i].depths[s] << "\n";
+        }
+    }
+
+    return 0;
+}
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    std::vector<std::string> pragmas = {"PRAGMA busy_timeout = 5000;", "PRAGMA synchronous = NORMAL;", "PRAGMA temp_store = MEMORY;", "PRAGMA cache_size = -64000;"};
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    auto db = setup_database(table_queries, config);
+    sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(db, rng, entries, config.num_entries) != 0)
+        return -1;
+    sqlite3_close(db);
+    std::filesystem::copy(DBPATH, DBPATH + ".backup", std::filesystem::copy_options::overwrite_existing);
+
+    if (measure(entries, config, pragmas) != 0)
+        return -1;
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal", DBPATH + ".backup"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
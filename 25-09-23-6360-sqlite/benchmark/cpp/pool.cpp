@@ -0,0 +1,595 @@
+#include "shared.hpp"
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+const size_t STATEMENT_CACHE_SIZE = 16;
+
+// Prepared statements keyed by their SQL text, evicting the least recently used one when full.
+struct StatementCache
+{
+    sqlite3 *db = nullptr;
+    std::list<std::pair<std::string, sqlite3_stmt *>> lru; // Most recently used first
+    std::unordered_map<std::string, std::list<std::pair<std::string, sqlite3_stmt *>>::iterator> index;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    sqlite3_stmt *get(const std::string &sql)
+    {
+        auto it = index.find(sql);
+        if (it != index.end())
+        {
+            hits++;
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->second;
+        }
+
+        misses++;
+        sqlite3_stmt *stmt;
+        if (!assert_sqlite_return_code(sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr), db, "Prepare " + sql))
+            return nullptr;
+        if (lru.size() == STATEMENT_CACHE_SIZE)
+        {
+            sqlite3_finalize(lru.back().second);
+            index.erase(lru.back().first);
+            lru.pop_back();
+        }
+        lru.emplace_front(sql, stmt);
+        index[sql] = lru.begin();
+        return stmt;
+    }
+
+    void clear()
+    {
+        for (auto &[sql, stmt] : lru)
+            sqlite3_finalize(stmt);
+        lru.clear();
+        index.clear();
+    }
+};
+
+struct Worker
+{
+    int tid;
+    sqlite3 *db = nullptr;
+    StatementCache statements;
+};
+
+// File growth settings for the worker connections, from the command line
+Config connection_file_config;
+
+sqlite3 *open_connection(const std::vector<std::string> &pragmas)
+{
+    sqlite3 *db;
+    sqlite3_open(DBPATH.c_str(), &db);
+
+    // Timeout is needed for some of the pragmas, as they can lock the database.
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "PRAGMA busy_timeout = 100;", nullptr, nullptr, nullptr), db, "Set busy_timeout"))
+        return nullptr;
+
+    for (const auto &pragma : pragmas)
+    {
+        if (!assert_sqlite_return_code(sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr), db, "Set pragma " + pragma))
+            return nullptr;
+    }
+
+    if (!apply_file_controls(db, connection_file_config))
+        return nullptr;
+
+    // The workloads spin on SQLITE_BUSY themselves
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "PRAGMA busy_timeout = 0;", nullptr, nullptr, nullptr), db, "Reset busy_timeout"))
+        return nullptr;
+
+    return db;
+}
+
+bool open_worker(Worker &worker, const std::vector<std::string> &pragmas)
+{
+    worker.db = open_connection(pragmas);
+    worker.statements.db = worker.db;
+    return worker.db != nullptr;
+}
+
+void close_worker(Worker &worker)
+{
+    worker.statements.clear();
+    sqlite3_close(worker.db);
+    worker.db = nullptr;
+}
+
+using Task = std::function<int(Worker &, uint64_t, int &)>;
+
+// Long-lived worker threads, each owning a connection and a statement cache. All threads are released together by a barrier for every run,
+// and the same barrier is used to wait for all of them to finish.
+class WorkerPool
+{
+public:
+    WorkerPool(uint64_t num_threads, const std::vector<std::string> &pragmas) : barrier(num_threads + 1), workers(num_threads), return_codes(num_threads), num_rows(num_threads)
+    {
+        for (uint64_t i = 0; i < num_threads; i++)
+            threads.emplace_back(&WorkerPool::worker_loop, this, i, std::cref(pragmas));
+        // Wait for every worker to have its connection ready
+        barrier.arrive_and_wait();
+    }
+
+    ~WorkerPool()
+    {
+        stopping = true;
+        barrier.arrive_and_wait();
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    // Runs the task on every worker and returns the total number of rows, or -1 if any worker failed.
+    int64_t run(const Task &task, uint64_t runs)
+    {
+        current_task = &task;
+        current_runs = runs;
+        barrier.arrive_and_wait();
+        barrier.arrive_and_wait();
+
+        int64_t total_rows = 0;
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            if (return_codes[i] != 0)
+                return -1;
+            total_rows += num_rows[i];
+        }
+        return total_rows;
+    }
+
+    void statement_stats(uint64_t &hits, uint64_t &misses)
+    {
+        hits = misses = 0;
+        for (auto &worker : workers)
+        {
+            hits += worker.statements.hits;
+            misses += worker.statements.misses;
+            worker.statements.hits = worker.statements.misses = 0;
+        }
+    }
+
+private:
+    std::barrier<> barrier;
+    std::vector<std::thread> threads;
+    std::vector<Worker> workers;
+    std::vector<int> return_codes;
+    std::vector<int> num_rows;
+    const Task *current_task = nullptr;
+    uint64_t current_runs = 0;
+    bool stopping = false; // Written before the barrier is passed, so the workers see it without further synchronization
+
+    void worker_loop(uint64_t tid, const std::vector<std::string> &pragmas)
+    {
+        Worker &worker = workers[tid];
+        worker.tid = tid;
+        bool ready = open_worker(worker, pragmas);
+        barrier.arrive_and_wait();
+
+        while (true)
+        {
+            barrier.arrive_and_wait();
+            if (stopping)
+                break;
+            num_rows[tid] = 0;
+            return_codes[tid] = ready ? (*current_task)(worker, current_runs, num_rows[tid]) : -1;
+            barrier.arrive_and_wait();
+        }
+
+        close_worker(worker);
+    }
+};
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+    sqlite3_wal_checkpoint(db, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+const std::string
+    SQL_SELECT = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+    SQL_INSERT = "INSERT INTO Block(Hash, Size) VALUES (?, ?);",
+    SQL_JOIN = "SELECT Block.ID, Block.Hash, Block.Size FROM Block JOIN BlocksetEntry ON BlocksetEntry.BlockID = Block.ID WHERE BlocksetEntry.BlocksetID = ?;";
+
+int task_select(Worker &worker, uint64_t runs, int &num_rows, const std::vector<Entry> &entries)
+{
+    std::mt19937 rng(~2025'07'08 + worker.tid);
+    sqlite3 *db = worker.db;
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        sqlite3_stmt *stmt = worker.statements.get(SQL_SELECT);
+        if (stmt == nullptr)
+            return -1;
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        auto &entry = entries[rng() % entries.size()];
+        sqlite3_bind_text(stmt, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, entry.size);
+        auto rc = sqlite3_step(stmt);
+        if (!assert_sqlite_return_code(rc, db, "query execution " + std::to_string(i)))
+            return -1;
+        if (!assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt, 0), "ID check"))
+            return -1;
+        sqlite3_reset(stmt);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        num_rows++;
+    }
+
+    return 0;
+}
+
+int task_xor1(Worker &worker, uint64_t runs, int &num_rows, const std::vector<Entry> &entries)
+{
+    std::mt19937 rng(~2025'07'08 + worker.tid);
+    sqlite3 *db = worker.db;
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        sqlite3_stmt *stmt_select = worker.statements.get(SQL_SELECT);
+        sqlite3_stmt *stmt_insert = worker.statements.get(SQL_INSERT);
+        if (stmt_select == nullptr || stmt_insert == nullptr)
+            return -1;
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        Entry entry;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()];
+        }
+
+        while (true)
+        {
+            sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_select, 2, entry.size);
+            int rc;
+            do
+            {
+                rc = sqlite3_step(stmt_select);
+            } while (rc == SQLITE_BUSY);
+            if (!assert_sqlite_return_code(rc, db, "xor1 query execution " + std::to_string(i)))
+                return -1;
+            auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_select, 0) : -1;
+            sqlite3_reset(stmt_select);
+
+            if (found_id != -1)
+            {
+                if (!assert_value_matches(entry.id, (uint64_t)found_id, "xor1 ID check"))
+                    return -1;
+                num_rows++;
+                break;
+            }
+
+            // Not found, insert
+            sqlite3_bind_text(stmt_insert, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_insert, 2, entry.size);
+            rc = sqlite3_step(stmt_insert);
+            sqlite3_reset(stmt_insert);
+            if (rc != SQLITE_BUSY)
+            {
+                if (!assert_sqlite_return_code(rc, db, "xor1 insert " + std::to_string(i)))
+                    return -1;
+                num_rows += 2;
+                break;
+            }
+
+            // Another connection is inserting, which means the read value is no longer valid
+            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        }
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+
+    return 0;
+}
+
+int task_join(Worker &worker, uint64_t runs, int &num_rows, const std::vector<Entry> &entries)
+{
+    std::mt19937 rng(~2025'07'08 + worker.tid);
+    sqlite3 *db = worker.db;
+    uint64_t max_blockset = entries.back().blockset_id;
+    while ((uint64_t)num_rows <= runs)
+    {
+        sqlite3_stmt *stmt = worker.statements.get(SQL_JOIN);
+        if (stmt == nullptr)
+            return -1;
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        uint64_t blockset_id = (rng() % max_blockset) + 1;
+        sqlite3_bind_int64(stmt, 1, blockset_id);
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            auto &entry = entries[sqlite3_column_int64(stmt, 0)];
+            if (!assert_value_matches(entry.blockset_id, blockset_id, "Blockset ID check"))
+                return -1;
+            num_rows++;
+        }
+        sqlite3_reset(stmt);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+
+    return 0;
+}
+
+void report(Config &config, const std::string &report_name, const std::string &mode, uint64_t setup_us, uint64_t total_us, int64_t rows, uint64_t hits, uint64_t misses)
+{
+    std::cout << "Pool " << report_name << " (" << mode << ") setup " << setup_us << " us, run "
+              << total_us << " us (" << float(rows) / (float(total_us) / 1000) << " kop/s)" << std::endl;
+
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    bool emit_header = !std::filesystem::exists("reports/pool_" + report_name + ".csv");
+    std::ofstream report_file("reports/pool_" + report_name + ".csv", std::ios::app);
+    if (emit_header)
+    {
+        report_file << "num_entries,num_warmup,num_repetitions,num_threads,mode,setup_us,time_us,rows,kop_s,statement_hits,statement_misses\n";
+    }
+
+    report_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << config.num_threads << ","
+                << mode << ","
+                << setup_us << ","
+                << total_us << ","
+                << rows << ","
+                << float(rows) / (float(total_us) / 1000) << ","
+                << hits << ","
+                << misses << "\n";
+}
+
+// Removes the blocks inserted by a run, so every run starts from the filled database.
+int reset_database(Config &config)
+{
+    sqlite3 *db;
+    sqlite3_open(DBPATH.c_str(), &db);
+    std::string sql = "DELETE FROM Block WHERE ID >= " + std::to_string(config.num_entries) + ";";
+    if (!assert_sqlite_return_code(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr), db, "Reset database"))
+        return -1;
+    sqlite3_close(db);
+    return 0;
+}
+
+// The way parallel.cpp runs: fresh threads that each open a connection, apply the pragmas and prepare their statements.
+// The setup time is the average time from spawning a thread until it has prepared its statements.
+int measure_fresh(const Task &task, const std::vector<std::string> &sql, Config &config, const std::string &report_name, const std::vector<std::string> &pragmas)
+{
+    auto run = [&](uint64_t runs, uint64_t &setup_ns, int64_t &total_rows, uint64_t &hits, uint64_t &misses) -> int
+    {
+        std::vector<std::thread> threads;
+        std::vector<int> return_codes(config.num_threads), num_rows(config.num_threads);
+        std::vector<uint64_t> setup_times(config.num_threads), statement_hits(config.num_threads), statement_misses(config.num_threads);
+        for (uint64_t i = 0; i < config.num_threads; i++)
+        {
+            auto spawned = std::chrono::high_resolution_clock::now();
+            threads.emplace_back([&, i, spawned]()
+                                 {
+                Worker worker;
+                worker.tid = i;
+                return_codes[i] = -1;
+                num_rows[i] = 0;
+                if (!open_worker(worker, pragmas))
+                    return;
+                for (const auto &s : sql)
+                    if (worker.statements.get(s) == nullptr)
+                        return;
+                setup_times[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - spawned).count();
+                return_codes[i] = task(worker, runs, num_rows[i]);
+                statement_hits[i] = worker.statements.hits;
+                statement_misses[i] = worker.statements.misses;
+                close_worker(worker); });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        setup_ns = total_rows = hits = misses = 0;
+        for (uint64_t i = 0; i < config.num_threads; i++)
+        {
+            if (return_codes[i] != 0)
+                return -1;
+            setup_ns += setup_times[i] / config.num_threads;
+            total_rows += num_rows[i];
+            hits += statement_hits[i];
+            misses += statement_misses[i];
+        }
+        return 0;
+    };
+
+    uint64_t setup_ns, hits, misses;
+    int64_t total_rows;
+    if (run(config.num_warmup / config.num_threads, setup_ns, total_rows, hits, misses) != 0 || reset_database(config) != 0)
+        return -1;
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    if (run(config.num_repetitions / config.num_threads, setup_ns, total_rows, hits, misses) != 0)
+        return -1;
+    auto end = std::chrono::high_resolution_clock::now();
+    if (reset_database(config) != 0)
+        return -1;
+
+    report(config, report_name, "fresh", setup_ns / 1000, std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count(), total_rows, hits, misses);
+
+    return 0;
+}
+
+// The pool is created once, so its setup time is paid up front and reported alongside every workload.
+int measure_pooled(WorkerPool &pool, uint64_t setup_us, const Task &task, Config &config, const std::string &report_name)
+{
+    uint64_t hits, misses;
+    if (pool.run(task, config.num_warmup / config.num_threads) < 0 || reset_database(config) != 0)
+        return -1;
+    pool.statement_stats(hits, misses);
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    int64_t total_rows = pool.run(task, config.num_repetitions / config.num_threads);
+    auto end = std::chrono::high_resolution_clock::now();
+    if (total_rows < 0 || reset_database(config) != 0)
+        return -1;
+    pool.statement_stats(hits, misses);
+
+    report(config, report_name, "pooled", setup_us, std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count(), total_rows, hits, misses);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+    connection_file_config = config;
+
+    std::vector<std::string> pragmas = {"PRAGMA synchronous = NORMAL;", "PRAGMA temp_store = MEMORY;", "PRAGMA cache_size = -64000;", "PRAGMA mmap_size = 64000000;", "PRAGMA threads = 8;"};
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    auto db = setup_database(table_queries, config);
+
+    sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetBlocksetID ON Blockset(ID);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA journal_mode = WAL;", nullptr, nullptr, nullptr);
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(db, rng, entries, config.num_entries) != 0)
+        return -1;
+    sqlite3_close(db);
+
+    std::vector<std::tuple<std::string, std::vector<std::string>, Task>> workloads = {
+        {"select", {SQL_SELECT}, [&entries](Worker &w, uint64_t runs, int &num_rows)
+         { return task_select(w, runs, num_rows, entries); }},
+        {"xor1", {SQL_SELECT, SQL_INSERT}, [&entries](Worker &w, uint64_t runs, int &num_rows)
+         { return task_xor1(w, runs, num_rows, entries); }},
+        {"join", {SQL_JOIN}, [&entries](Worker &w, uint64_t runs, int &num_rows)
+         { return task_join(w, runs, num_rows, entries); }}};
+
+    for (auto &[report_name, sql, task] : workloads)
+    {
+        if (measure_fresh(task, sql, config, report_name, pragmas) != 0)
+        {
+            std::cerr << "Error during fresh " << report_name << std::endl;
+            return -1;
+        }
+    }
+
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        WorkerPool pool(config.num_threads, pragmas);
+        auto end = std::chrono::high_resolution_clock::now();
+        uint64_t setup_us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+
+        for (auto &[report_name, sql, task] : workloads)
+        {
+            if (measure_pooled(pool, setup_us, task, config, report_name) != 0)
+            {
+                std::cerr << "Error during pooled " << report_name << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    // Always revert journal mode to delete prior to closing, so that others won't be in WAL mode.
+    sqlite3_open(DBPATH.c_str(), &db);
+    sqlite3_wal_checkpoint(db, nullptr);
+    sqlite3_exec(db, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
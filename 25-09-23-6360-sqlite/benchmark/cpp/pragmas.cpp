@@ -337,6 +337,83 @@ int measure_xor2(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vect
     return 0;
 }
 
+int measure_xor3(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string
+        sql_insert = "INSERT INTO Block (ID, Hash, Size) VALUES (?, ?, ?) ON CONFLICT (Hash, Size) DO NOTHING RETURNING ID;",
+        sql_select = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt_insert, *stmt_select;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert.c_str(), -1, &stmt_insert, nullptr), db, "Prepare xor3 insert statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor3 select statement"))
+        return -1;
+
+    auto xor_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_int64(stmt_insert, 1, entry.id);
+        sqlite3_bind_text(stmt_insert, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_insert, 3, entry.size);
+        auto rc = sqlite3_step(stmt_insert);
+        if (!assert_sqlite_return_code(rc, db, prefix + " xor3 insert query execution " + std::to_string(i)))
+            return -1;
+        auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_insert, 0) : -1;
+        sqlite3_reset(stmt_insert);
+
+        if (found_id == -1)
+        {
+            // Conflict, so the block already exists
+            sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_select, 2, entry.size);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_select), db, prefix + " xor3 select query execution " + std::to_string(i)))
+                return -1;
+            found_id = sqlite3_column_int64(stmt_select, 0);
+            sqlite3_reset(stmt_select);
+        }
+        if (!assert_value_matches(entry.id, (uint64_t)found_id, prefix + " xor3 ID check"))
+            return -1;
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, xor_inner, report_name, 50, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt_insert);
+    sqlite3_finalize(stmt_select);
+
+    return 0;
+}
+
+int measure_xor3_update(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    // The no-op update makes RETURNING yield the ID of an existing block too
+    std::string sql_upsert = "INSERT INTO Block (ID, Hash, Size) VALUES (?, ?, ?) ON CONFLICT (Hash, Size) DO UPDATE SET ID = ID RETURNING ID;";
+    sqlite3_stmt *stmt_upsert;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_upsert.c_str(), -1, &stmt_upsert, nullptr), db, "Prepare xor3 upsert statement"))
+        return -1;
+
+    auto xor_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_int64(stmt_upsert, 1, entry.id);
+        sqlite3_bind_text(stmt_upsert, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_upsert, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_upsert), db, prefix + " xor3 upsert query execution " + std::to_string(i)))
+            return -1;
+        if (!assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt_upsert, 0), prefix + " xor3 upsert ID check"))
+            return -1;
+        sqlite3_reset(stmt_upsert);
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, xor_inner, report_name, 50, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt_upsert);
+
+    return 0;
+}
+
 uint64_t blockset_count(uint64_t blockset_id, const std::vector<Entry> &entries)
 {
     uint64_t count = 0;
@@ -586,6 +663,159 @@ int measure_new_blockset(sqlite3 *db, Config &config, std::mt19937 &rng, const s
     return 0;
 }
 
+// Keeps the open blockset in memory and writes the Blockset row and its entries once the blockset closes.
+// The cost of closing a blockset is included in the timing of the block that closes it.
+int measure_new_blockset_deferred(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string
+        sql_check_block = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_insert_block = "INSERT INTO Block (Hash, Size) VALUES (?, ?) RETURNING ID;",
+        sql_insert_blockset = "INSERT INTO Blockset (Length) VALUES (?) RETURNING ID;",
+        sql_insert_blockset_entry = "INSERT INTO BlocksetEntry (BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_check_block, *stmt_insert_block, *stmt_insert_blockset, *stmt_insert_blockset_entry;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_check_block.c_str(), -1, &stmt_check_block, nullptr), db, "Prepare check block statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_block.c_str(), -1, &stmt_insert_block, nullptr), db, "Prepare insert block statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_blockset.c_str(), -1, &stmt_insert_blockset, nullptr), db, "Prepare insert blockset statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert_blockset_entry.c_str(), -1, &stmt_insert_blockset_entry, nullptr), db, "Prepare insert blockset entry statement"))
+        return -1;
+
+    std::vector<uint64_t> block_ids;
+
+    auto add_to_blockset_inner = [&](sqlite3 *db, Entry entry, const std::string &prefix) -> int
+    {
+        // Check if the block exists
+        sqlite3_bind_text(stmt_check_block, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_check_block, 2, entry.size);
+        auto rc = sqlite3_step(stmt_check_block);
+        if (!assert_sqlite_return_code(rc, db, prefix + " check block"))
+            return -1;
+        uint64_t found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_check_block, 0) : -1;
+        sqlite3_reset(stmt_check_block);
+
+        if (found_id == -1)
+        {
+            // Block does not exist, insert it and get the ID from the same statement
+            sqlite3_bind_text(stmt_insert_block, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_insert_block, 2, entry.size);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_insert_block), db, prefix + " insert block"))
+                return -1;
+            found_id = sqlite3_column_int64(stmt_insert_block, 0);
+            sqlite3_reset(stmt_insert_block);
+        }
+
+        block_ids.push_back(found_id);
+
+        return 0;
+    };
+
+    auto close_blockset = [&](sqlite3 *db, const std::string &prefix) -> int
+    {
+        if (block_ids.empty())
+            return 0;
+
+        // The length is known up front, so the blockset is written once
+        sqlite3_bind_int64(stmt_insert_blockset, 1, block_ids.size());
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_insert_blockset), db, prefix + " insert blockset"))
+            return -1;
+        uint64_t blockset_id = sqlite3_column_int64(stmt_insert_blockset, 0);
+        sqlite3_reset(stmt_insert_blockset);
+
+        for (auto block_id : block_ids)
+        {
+            sqlite3_bind_int64(stmt_insert_blockset_entry, 1, blockset_id);
+            sqlite3_bind_int64(stmt_insert_blockset_entry, 2, block_id);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_insert_blockset_entry), db, prefix + " insert blockset entry"))
+                return -1;
+            sqlite3_reset(stmt_insert_blockset_entry);
+        }
+        block_ids.clear();
+
+        return 0;
+    };
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    for (uint64_t i = 0; i < config.num_warmup; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - 50)) // 50% chance to create a new entry
+        {
+            entry = {
+                config.num_entries + i,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (add_to_blockset_inner(db, entry, "Warmup") != 0)
+            return -1;
+
+        // With some probability, close the blockset and start a new one
+        if ((rng() % 100) < 5) // 5% chance to create a new blockset
+        {
+            if (close_blockset(db, "Warmup") != 0)
+                return -1;
+        }
+    }
+    if (close_blockset(db, "Warmup") != 0)
+        return -1;
+
+    rollback(report_name, db, config);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::vector<uint64_t> times;
+    for (uint64_t i = 0; i < config.num_repetitions; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - 50)) // 50% chance to create a new entry
+        {
+            entry = {
+                config.num_entries + i,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        if (add_to_blockset_inner(db, entry, "Actual") != 0)
+            return -1;
+
+        // With some probability, close the blockset and start a new one
+        if ((rng() % 100) < 5) // 5% chance to create a new blockset
+        {
+            if (close_blockset(db, "Actual") != 0)
+                return -1;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+    }
+    if (close_blockset(db, "Actual") != 0)
+        return -1;
+
+    rollback(report_name, db, config);
+
+    sqlite3_finalize(stmt_check_block);
+    sqlite3_finalize(stmt_insert_block);
+    sqlite3_finalize(stmt_insert_blockset);
+    sqlite3_finalize(stmt_insert_blockset_entry);
+
+    report_stats(config, times, report_name);
+
+    return 0;
+}
+
 int measure_all(std::vector<Entry> &entries, Config &config, std::string &report_name, std::vector<std::string> &pragmas)
 {
     sqlite3 *db;
@@ -615,6 +845,39 @@ int measure_all(std::vector<Entry> &entries, Config &config, std::string &report
     if (measure_new_blockset(db, config, rng, entries, "pragmas_blockset_" + report_name) != 0)
         return -1;
 
+    if (measure_new_blockset_deferred(db, config, rng, entries, "pragmas_blockset_deferred_" + report_name) != 0)
+        return -1;
+
+    // Always revert journal mode to delete prior to closing, so that others won't be in WAL mode.
+    sqlite3_wal_checkpoint(db, nullptr);
+    sqlite3_exec(db, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, nullptr);
+
+    sqlite3_close(db);
+
+    return 0;
+}
+
+// The upsert workloads need a UNIQUE (Hash, Size) index, so they run in a separate pass after the index has been swapped.
+int measure_all_unique(std::vector<Entry> &entries, Config &config, std::string &report_name, std::vector<std::string> &pragmas)
+{
+    sqlite3 *db;
+    sqlite3_open(DBPATH.c_str(), &db);
+    std::mt19937 rng(~2025'07'08);
+
+    for (const auto &pragma : pragmas)
+    {
+        sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr);
+    }
+
+    if (measure_insert(db, config, rng, entries, "pragmas_insert_unique_" + report_name) != 0)
+        return -1;
+
+    if (measure_xor3(db, config, rng, entries, "pragmas_xor3_" + report_name) != 0)
+        return -1;
+
+    if (measure_xor3_update(db, config, rng, entries, "pragmas_xor3_update_" + report_name) != 0)
+        return -1;
+
     // Always revert journal mode to delete prior to closing, so that others won't be in WAL mode.
     sqlite3_wal_checkpoint(db, nullptr);
     sqlite3_exec(db, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, nullptr);
@@ -682,7 +945,7 @@ int main(int argc, char *argv[])
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
     sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
@@ -702,6 +965,19 @@ int main(int argc, char *argv[])
             return ret;
     }
 
+    sqlite3_open(DBPATH.c_str(), &db);
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "DROP INDEX BlockHashSize; CREATE UNIQUE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr), db, "Create unique index"))
+        return -1;
+    sqlite3_close(db);
+
+    for (auto &[report_name, pragmas] : pragmas_to_run)
+    {
+        std::cout << "Running " << report_name << " (unique)" << std::endl;
+        int ret = measure_all_unique(entries, config, report_name, pragmas);
+        if (ret != 0)
+            return ret;
+    }
+
     std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal"};
     for (const auto &f : files)
     {
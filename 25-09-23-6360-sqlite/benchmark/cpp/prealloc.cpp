@@ -0,0 +1,256 @@
+#include "shared.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+const uint64_t INSERT_BATCH = 100;
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+// Number of extents the file system uses for the file, or -1 where FIEMAP is not available. Pending writes are flushed first, so delayed
+// allocation does not hide the final layout.
+int64_t count_extents(const std::string &path)
+{
+#ifdef __linux__
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return -1;
+    fiemap request = {};
+    request.fm_length = FIEMAP_MAX_OFFSET;
+    request.fm_flags = FIEMAP_FLAG_SYNC;
+    request.fm_extent_count = 0; // Only count the extents
+    int rc = ioctl(fd, FS_IOC_FIEMAP, &request);
+    close(fd);
+    return rc < 0 ? -1 : request.fm_mapped_extents;
+#else
+    return -1;
+#endif
+}
+
+uint64_t file_size(const std::string &path)
+{
+    return std::filesystem::exists(path) ? std::filesystem::file_size(path) : 0;
+}
+
+// Inserts new blocks in transactions of INSERT_BATCH rows, and returns the time it took in microseconds, or -1 on error
+int64_t measure_insert(sqlite3 *db, Config &config, std::mt19937 &rng)
+{
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);", -1, &stmt, nullptr), db, "Prepare insert statement"))
+        return -1;
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    for (uint64_t i = 0; i < config.num_repetitions; i++)
+    {
+        std::string hash = random_hash_string(rng, 44);
+        sqlite3_bind_int64(stmt, 1, config.num_entries + i);
+        sqlite3_bind_text(stmt, 2, hash.c_str(), hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 3, rng() % 1000);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt), db, "Insert " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt);
+
+        if ((i + 1) % INSERT_BATCH == 0)
+        {
+            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+            sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+        }
+    }
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    sqlite3_finalize(stmt);
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    // The hints are sized from the files the run without preallocation ends up with, so they are filled in after the first setting
+    const uint64_t BASELINE = UINT64_MAX;
+    std::vector<std::tuple<std::string, uint64_t, uint64_t, uint64_t>> settings = {
+        {"none", 0, 0, 0},
+        {"chunk_1M", 1 << 20, 0, 0},
+        {"chunk_16M", 16 << 20, 0, 0},
+        {"size_hint", 0, BASELINE, 0},
+        {"size_hint_wal", 0, BASELINE, BASELINE},
+        {"chunk_16M_size_hint_wal", 16 << 20, BASELINE, BASELINE}};
+    uint64_t baseline_db_bytes = 0, baseline_wal_bytes = 0;
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    for (auto &[name, chunk_size, size_hint, wal_size_hint] : settings)
+    {
+        config.chunk_size = chunk_size;
+        config.size_hint = size_hint == BASELINE ? baseline_db_bytes : size_hint;
+        config.wal_size_hint = wal_size_hint == BASELINE ? baseline_wal_bytes : wal_size_hint;
+
+        auto db = setup_database(table_queries, config);
+        sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+        sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+        sqlite3_exec(db, "CREATE INDEX BlocksetBlocksetID ON Blockset(ID);", nullptr, nullptr, nullptr);
+
+        // The WAL only exists in WAL mode, so its hint is applied after switching
+        sqlite3_exec(db, "PRAGMA journal_mode = WAL;", nullptr, nullptr, nullptr);
+        if (!apply_file_controls(db, config))
+            return -1;
+
+        std::vector<Entry> entries;
+        std::mt19937 rng(2025'07'08);
+        auto fill_begin = std::chrono::high_resolution_clock::now();
+        if (fill(db, rng, entries, config.num_entries) != 0)
+            return -1;
+        auto fill_end = std::chrono::high_resolution_clock::now();
+        int64_t fill_us = std::chrono::duration_cast<std::chrono::microseconds>(fill_end - fill_begin).count();
+
+        int64_t insert_us = measure_insert(db, config, rng);
+        if (insert_us < 0)
+            return -1;
+
+        // The WAL is removed when the last connection closes, so the files are inspected while it is still open
+        uint64_t db_bytes = file_size(DBPATH), wal_bytes = file_size(DBPATH + "-wal");
+        int64_t db_extents = count_extents(DBPATH), wal_extents = count_extents(DBPATH + "-wal");
+        sqlite3_close(db);
+
+        if (name == "none")
+        {
+            baseline_db_bytes = db_bytes;
+            baseline_wal_bytes = wal_bytes;
+        }
+
+        std::cout << "Preallocation " << name << ": fill " << fill_us / 1000 << " ms, insert " << insert_us / 1000 << " ms, "
+                  << db_extents << " database extents, " << wal_extents << " WAL extents" << std::endl;
+
+        bool emit_header = !std::filesystem::exists("reports/prealloc.csv");
+        std::ofstream report_file("reports/prealloc.csv", std::ios::app);
+        if (emit_header)
+            report_file << "num_entries,num_warmup,num_repetitions,setting,chunk_size,size_hint,wal_size_hint,fill_us,fill_kop_s,insert_us,insert_kop_s,db_bytes,db_extents,wal_bytes,wal_extents\n";
+        report_file << config.num_entries << ","
+                    << config.num_warmup << ","
+                    << config.num_repetitions << ","
+                    << name << ","
+                    << config.chunk_size << ","
+                    << config.size_hint << ","
+                    << config.wal_size_hint << ","
+                    << fill_us << ","
+                    << float(config.num_entries) / (float(fill_us) / 1000) << ","
+                    << insert_us << ","
+                    << float(config.num_repetitions) / (float(insert_us) / 1000) << ","
+                    << db_bytes << ","
+                    << db_extents << ","
+                    << wal_bytes << ","
+                    << wal_extents << "\n";
+    }
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
@@ -105,7 +105,7 @@ int select_index_normal(Config &config)
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
 
@@ -176,7 +176,7 @@ int select_index_hash(Config &config)
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockHash ON Block(Hash);", nullptr, nullptr, nullptr);
 
@@ -265,7 +265,7 @@ int select_index_size(Config &config)
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockSize ON Block(Size);", nullptr, nullptr, nullptr);
 
@@ -114,7 +114,7 @@ int select_index_normal(Config &config)
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(h0, h1, h2, h3, Size);", nullptr, nullptr, nullptr);
 
@@ -191,7 +191,7 @@ int select_index_h0(Config &config)
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockH0 ON Block(h0);", nullptr, nullptr, nullptr);
 
@@ -288,7 +288,7 @@ int select_index_h0_size(Config &config)
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockH0 ON Block(h0, Size);", nullptr, nullptr, nullptr);
 
@@ -385,7 +385,7 @@ int select_index_size(Config &config)
         CREATE_BLOCKSETENTRY_TABLE,
         CREATE_BLOCK_TABLE};
 
-    auto db = setup_database(table_queries);
+    auto db = setup_database(table_queries, config);
 
     sqlite3_exec(db, "CREATE INDEX BlockSize ON Block(Size);", nullptr, nullptr, nullptr);
 
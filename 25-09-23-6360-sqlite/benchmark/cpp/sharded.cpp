@@ -0,0 +1,800 @@
+#include "shared.hpp"
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+// File growth settings for every shard connection, from the command line. The size hints apply to each shard file on its own.
+Config connection_file_config;
+
+// Block and Blockset IDs must be unique across all shards, so new rows take their ID from these counters instead of the rowid of their shard.
+std::atomic<uint64_t> next_block_id, next_blockset_id;
+
+std::string shard_path(uint64_t shard)
+{
+    return DBPATH + ".shard" + std::to_string(shard);
+}
+
+// Blocks are routed on the first two characters of their hash, while BlocksetEntry and Blockset rows follow their blockset.
+uint64_t block_shard(const std::string &hash, uint64_t num_shards)
+{
+    return (((uint8_t)hash[0] << 8) | (uint8_t)hash[1]) % num_shards;
+}
+
+uint64_t blockset_shard(uint64_t blockset_id, uint64_t num_shards)
+{
+    return blockset_id % num_shards;
+}
+
+sqlite3 *open_connection(const std::string &path, const std::vector<std::string> &pragmas)
+{
+    sqlite3 *db;
+    sqlite3_open(path.c_str(), &db);
+
+    // Timeout is needed for some of the pragmas, as they can lock the database.
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "PRAGMA busy_timeout = 100;", nullptr, nullptr, nullptr), db, "Set busy_timeout"))
+        return nullptr;
+
+    for (const auto &pragma : pragmas)
+    {
+        if (!assert_sqlite_return_code(sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr), db, "Set pragma " + pragma))
+            return nullptr;
+    }
+
+    if (!apply_file_controls(db, connection_file_config))
+        return nullptr;
+
+    // The shard writers spin on SQLITE_BUSY themselves
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "PRAGMA busy_timeout = 0;", nullptr, nullptr, nullptr), db, "Reset busy_timeout"))
+        return nullptr;
+
+    return db;
+}
+
+// The writes handed to a shard writer. Lookups that decide whether to insert run in the writer as well, so the check and the insert see the same state.
+enum class WriteOp
+{
+    insert_block,
+    find_or_insert_block,
+    start_blockset,
+    add_blockset_entry
+};
+
+// A write waiting for its shard writer. The worker owns it and blocks on done until the transaction holding it has committed.
+struct WriteRequest
+{
+    WriteOp op;
+    Entry entry;
+    uint64_t blockset_id = 0;
+    bool inserted = false;
+    std::promise<int> done;
+};
+
+// Each shard has a single writer thread with its own connection, so writes to a shard never contend for its WAL lock. The writer takes
+// everything queued since its last commit and applies it in one transaction.
+struct ShardWriter
+{
+    uint64_t shard;
+    sqlite3 *db = nullptr;
+    sqlite3_stmt *stmt_insert_block, *stmt_check_block, *stmt_start_blockset, *stmt_insert_blockset_entry, *stmt_update_blockset;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<WriteRequest *> queue;
+    bool closed = false;
+    std::thread thread;
+
+    // Hands a write to the writer and waits for it to be committed
+    int submit(WriteRequest &request)
+    {
+        auto done = request.done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(&request);
+        }
+        cv.notify_one();
+        return done.get();
+    }
+};
+
+std::vector<std::unique_ptr<ShardWriter>> shard_writers;
+
+int apply_write(ShardWriter &writer, WriteRequest &request)
+{
+    sqlite3 *db = writer.db;
+    Entry &entry = request.entry;
+    switch (request.op)
+    {
+    case WriteOp::find_or_insert_block:
+    {
+        sqlite3_bind_text(writer.stmt_check_block, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(writer.stmt_check_block, 2, entry.size);
+        int rc = sqlite3_step(writer.stmt_check_block);
+        if (!assert_sqlite_return_code(rc, db, "check block on shard " + std::to_string(writer.shard)))
+            return -1;
+        int64_t found_id = rc == SQLITE_ROW ? sqlite3_column_int64(writer.stmt_check_block, 0) : -1;
+        sqlite3_reset(writer.stmt_check_block);
+        if (found_id != -1)
+        {
+            if (entry.id != (uint64_t)-1 && !assert_value_matches(entry.id, (uint64_t)found_id, "find block ID check"))
+                return -1;
+            entry.id = found_id;
+            return 0;
+        }
+    }
+        [[fallthrough]];
+    case WriteOp::insert_block:
+        if (entry.id == (uint64_t)-1)
+            entry.id = next_block_id++;
+        sqlite3_bind_int64(writer.stmt_insert_block, 1, entry.id);
+        sqlite3_bind_text(writer.stmt_insert_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(writer.stmt_insert_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(writer.stmt_insert_block), db, "insert block on shard " + std::to_string(writer.shard)))
+            return -1;
+        sqlite3_reset(writer.stmt_insert_block);
+        request.inserted = true;
+        return 0;
+    case WriteOp::start_blockset:
+        sqlite3_bind_int64(writer.stmt_start_blockset, 1, request.blockset_id);
+        if (!assert_sqlite_return_code(sqlite3_step(writer.stmt_start_blockset), db, "insert blockset on shard " + std::to_string(writer.shard)))
+            return -1;
+        sqlite3_reset(writer.stmt_start_blockset);
+        return 0;
+    case WriteOp::add_blockset_entry:
+        sqlite3_bind_int64(writer.stmt_insert_blockset_entry, 1, request.blockset_id);
+        sqlite3_bind_int64(writer.stmt_insert_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(writer.stmt_insert_blockset_entry), db, "insert blockset entry on shard " + std::to_string(writer.shard)))
+            return -1;
+        sqlite3_reset(writer.stmt_insert_blockset_entry);
+        sqlite3_bind_int64(writer.stmt_update_blockset, 1, request.blockset_id);
+        if (!assert_sqlite_return_code(sqlite3_step(writer.stmt_update_blockset), db, "update blockset on shard " + std::to_string(writer.shard)))
+            return -1;
+        sqlite3_reset(writer.stmt_update_blockset);
+        return 0;
+    }
+    return -1;
+}
+
+void run_shard_writer(ShardWriter &writer)
+{
+    std::deque<WriteRequest *> batch;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(writer.mutex);
+            writer.cv.wait(lock, [&writer]
+                           { return !writer.queue.empty() || writer.closed; });
+            if (writer.queue.empty())
+                return;
+            batch.swap(writer.queue);
+        }
+
+        // The join readers are the only other connections, and they never block the writer in WAL mode
+        int rc;
+        do
+        {
+            rc = sqlite3_exec(writer.db, "BEGIN IMMEDIATE TRANSACTION;", nullptr, nullptr, nullptr);
+        } while (rc == SQLITE_BUSY);
+        int return_code = assert_sqlite_return_code(rc, writer.db, "Begin shard writer transaction") ? 0 : -1;
+        for (auto request : batch)
+        {
+            if (return_code == 0)
+                return_code = apply_write(writer, *request);
+        }
+        if (return_code == 0)
+        {
+            do
+            {
+                rc = sqlite3_exec(writer.db, "COMMIT;", nullptr, nullptr, nullptr);
+            } while (rc == SQLITE_BUSY);
+            if (!assert_sqlite_return_code(rc, writer.db, "Commit shard writer transaction"))
+                return_code = -1;
+        }
+        else
+        {
+            sqlite3_exec(writer.db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        }
+
+        for (auto request : batch)
+            request->done.set_value(return_code);
+        batch.clear();
+    }
+}
+
+bool start_shard_writers(const Config &config, const std::vector<std::string> &pragmas)
+{
+    for (uint64_t shard = 0; shard < config.num_shards; shard++)
+    {
+        auto writer = std::make_unique<ShardWriter>();
+        writer->shard = shard;
+        writer->db = open_connection(shard_path(shard), pragmas);
+        if (writer->db == nullptr)
+            return false;
+        sqlite3 *db = writer->db;
+        if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, "INSERT INTO Block (ID, Hash, Size) VALUES (?, ?, ?);", -1, &writer->stmt_insert_block, nullptr), db, "Prepare insert block statement") ||
+            !assert_sqlite_return_code(sqlite3_prepare_v2(db, "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;", -1, &writer->stmt_check_block, nullptr), db, "Prepare check block statement") ||
+            !assert_sqlite_return_code(sqlite3_prepare_v2(db, "INSERT INTO Blockset (ID, Length) VALUES (?, 0);", -1, &writer->stmt_start_blockset, nullptr), db, "Prepare start blockset statement") ||
+            !assert_sqlite_return_code(sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO BlocksetEntry (BlocksetID, BlockID) VALUES (?, ?);", -1, &writer->stmt_insert_blockset_entry, nullptr), db, "Prepare insert blockset entry statement") ||
+            !assert_sqlite_return_code(sqlite3_prepare_v2(db, "UPDATE Blockset SET Length = Length + 1 WHERE ID = ?;", -1, &writer->stmt_update_blockset, nullptr), db, "Prepare update blockset statement"))
+            return false;
+        writer->thread = std::thread(run_shard_writer, std::ref(*writer));
+        shard_writers.push_back(std::move(writer));
+    }
+    return true;
+}
+
+void stop_shard_writers()
+{
+    for (auto &writer : shard_writers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(writer->mutex);
+            writer->closed = true;
+        }
+        writer->cv.notify_one();
+        writer->thread.join();
+        for (auto stmt : {writer->stmt_insert_block, writer->stmt_check_block, writer->stmt_start_blockset, writer->stmt_insert_blockset_entry, writer->stmt_update_blockset})
+            sqlite3_finalize(stmt);
+        sqlite3_close(writer->db);
+    }
+    shard_writers.clear();
+}
+
+void close_shards(std::vector<sqlite3 *> &dbs)
+{
+    for (auto db : dbs)
+        sqlite3_close(db);
+    dbs.clear();
+}
+
+bool prepare_shards(const std::vector<sqlite3 *> &dbs, const std::string &sql, std::vector<sqlite3_stmt *> &stmts, const std::string &context)
+{
+    stmts.resize(dbs.size());
+    for (size_t shard = 0; shard < dbs.size(); shard++)
+    {
+        if (!assert_sqlite_return_code(sqlite3_prepare_v2(dbs[shard], sql.c_str(), -1, &stmts[shard], nullptr), dbs[shard], context + " on shard " + std::to_string(shard)))
+            return false;
+    }
+    return true;
+}
+
+void finalize_shards(std::vector<sqlite3_stmt *> &stmts)
+{
+    for (auto stmt : stmts)
+        sqlite3_finalize(stmt);
+    stmts.clear();
+}
+
+int fill(std::vector<sqlite3 *> &dbs, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (auto db : dbs)
+        sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    std::vector<sqlite3_stmt *> stmt_block, stmt_blockset, stmt_blockset_entry;
+    if (!prepare_shards(dbs, sql_block, stmt_block, "Prepare fill block statement"))
+        return -1;
+    if (!prepare_shards(dbs, sql_blockset, stmt_blockset, "Prepare fill blockset statement"))
+        return -1;
+    if (!prepare_shards(dbs, sql_blockset_entry, stmt_blockset_entry, "Prepare fill blockset entry statement"))
+        return -1;
+
+    uint64_t
+        num_shards = dbs.size(),
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        uint64_t shard = block_shard(entry.hash, num_shards);
+        sqlite3_bind_int64(stmt_block[shard], 1, entry.id);
+        sqlite3_bind_text(stmt_block[shard], 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block[shard], 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block[shard]), dbs[shard], "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block[shard]);
+
+        // BlocksetEntry
+        shard = blockset_shard(blockset_id, num_shards);
+        sqlite3_bind_int64(stmt_blockset_entry[shard], 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry[shard], 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry[shard]), dbs[shard], "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry[shard]);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset[shard], 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset[shard], 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset[shard]), dbs[shard], "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset[shard]);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        uint64_t shard = blockset_shard(blockset_id, num_shards);
+        sqlite3_bind_int64(stmt_blockset[shard], 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset[shard], 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset[shard]), dbs[shard], "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset[shard]);
+    }
+
+    finalize_shards(stmt_block);
+    finalize_shards(stmt_blockset);
+    finalize_shards(stmt_blockset_entry);
+
+    for (auto db : dbs)
+    {
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries into " << num_shards << " shards in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+void measure_insert(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        WriteRequest request;
+        request.op = WriteOp::insert_block;
+        request.entry = {
+            (uint64_t)-1,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            0};
+        if (shard_writers[block_shard(request.entry.hash, config.num_shards)]->submit(request) != 0)
+        {
+            return_code = -1;
+            return;
+        }
+    }
+
+    num_rows = runs; // Number of rows inserted
+    return_code = 0;
+    return;
+}
+
+void measure_xor1(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        WriteRequest request;
+        request.op = WriteOp::find_or_insert_block;
+        bool create_new = (rng() % 100) >= 50;
+        if (create_new)
+        {
+            request.entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            request.entry = entries[rng() % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (shard_writers[block_shard(request.entry.hash, config.num_shards)]->submit(request) != 0)
+        {
+            return_code = -1;
+            return;
+        }
+        num_rows += request.inserted ? 2 : 1;
+    }
+
+    return_code = 0;
+    return;
+}
+
+// Reads go through a single connection with every shard attached. The entries of a blockset live in one shard, but its blocks can be in any of them.
+void measure_join(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    sqlite3 *db;
+    sqlite3_open(":memory:", &db);
+    for (uint64_t shard = 0; shard < config.num_shards; shard++)
+    {
+        std::string schema = "s" + std::to_string(shard);
+        std::string sql_attach = "ATTACH DATABASE '" + shard_path(shard) + "' AS " + schema + ";";
+        if (!assert_sqlite_return_code(sqlite3_exec(db, sql_attach.c_str(), nullptr, nullptr, nullptr), db, "Attach shard " + std::to_string(shard)))
+        {
+            return_code = -1;
+            return;
+        }
+        // Pragmas only apply to the main schema unless qualified
+        for (const auto &pragma : pragmas)
+        {
+            std::string sql_pragma = "PRAGMA " + schema + "." + pragma.substr(7);
+            if (!assert_sqlite_return_code(sqlite3_exec(db, sql_pragma.c_str(), nullptr, nullptr, nullptr), db, "Set pragma " + sql_pragma))
+            {
+                return_code = -1;
+                return;
+            }
+        }
+    }
+
+    // One statement per blockset shard, joining its BlocksetEntry against the Block table of every shard
+    std::vector<sqlite3_stmt *> stmts(config.num_shards);
+    for (uint64_t shard = 0; shard < config.num_shards; shard++)
+    {
+        std::string sql;
+        for (uint64_t block_shard = 0; block_shard < config.num_shards; block_shard++)
+        {
+            if (block_shard > 0)
+                sql += " UNION ALL ";
+            sql += "SELECT Block.ID, Block.Hash, Block.Size FROM s" + std::to_string(shard) + ".BlocksetEntry JOIN s" + std::to_string(block_shard) + ".Block ON BlocksetEntry.BlockID = Block.ID WHERE BlocksetEntry.BlocksetID = ?1";
+        }
+        sql += ";";
+        if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmts[shard], nullptr), db, "Prepare join statement"))
+        {
+            return_code = -1;
+            return;
+        }
+    }
+
+    uint64_t max_blockset = 0;
+    for (auto &entry : entries)
+    {
+        max_blockset = std::max(max_blockset, entry.blockset_id);
+    }
+
+    while (true)
+    {
+        sqlite3_exec(db, "BEGIN DEFERRED TRANSACTION;", nullptr, nullptr, nullptr);
+        uint64_t blockset_id = (rng() % max_blockset) + 1;
+        sqlite3_stmt *stmt = stmts[blockset_shard(blockset_id, config.num_shards)];
+        sqlite3_bind_int64(stmt, 1, blockset_id);
+        uint64_t count = 0;
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            // Process the row
+            auto found_id = sqlite3_column_int64(stmt, 0);
+            auto found_hash = std::string((const char *)sqlite3_column_text(stmt, 1));
+            auto found_size = (uint64_t)sqlite3_column_int64(stmt, 2);
+            auto entry = entries[found_id];
+            if (!assert_value_matches(entry.hash, found_hash, "Hash check"))
+            {
+                return_code = -1;
+                return;
+            }
+            if (!assert_value_matches(entry.size, found_size, "Size check"))
+            {
+                return_code = -1;
+                return;
+            }
+            if (!assert_value_matches(entry.blockset_id, blockset_id, "Blockset ID check"))
+            {
+                return_code = -1;
+                return;
+            }
+            count++;
+        }
+        sqlite3_reset(stmt);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        num_rows += count;
+        if (num_rows > runs)
+            break;
+    };
+
+    finalize_shards(stmts);
+    sqlite3_close(db);
+
+    return_code = 0;
+    return;
+}
+
+void measure_new_blockset(int tid, uint64_t runs, std::vector<std::string> &pragmas, Config &config, const std::vector<Entry> &entries, int &return_code, int &num_rows)
+{
+    num_rows = 0;
+    std::mt19937 rng(~2025'07'08 + tid);
+    uint64_t blockset_id = 0;
+
+    auto add_to_blockset_inner = [&](const Entry &entry) -> int
+    {
+        WriteRequest block_request;
+        block_request.op = WriteOp::find_or_insert_block;
+        block_request.entry = entry;
+        if (shard_writers[block_shard(entry.hash, config.num_shards)]->submit(block_request) != 0)
+            return -1;
+        num_rows += block_request.inserted ? 2 : 1;
+
+        // The blockset entry and length live in the shard of the blockset
+        WriteRequest entry_request;
+        entry_request.op = WriteOp::add_blockset_entry;
+        entry_request.entry = block_request.entry;
+        entry_request.blockset_id = blockset_id;
+        if (shard_writers[blockset_shard(blockset_id, config.num_shards)]->submit(entry_request) != 0)
+            return -1;
+        num_rows += 2;
+
+        return 0;
+    };
+
+    auto start_new_blockset = [&]() -> int
+    {
+        blockset_id = next_blockset_id++;
+        WriteRequest request;
+        request.op = WriteOp::start_blockset;
+        request.blockset_id = blockset_id;
+        if (shard_writers[blockset_shard(blockset_id, config.num_shards)]->submit(request) != 0)
+            return -1;
+        num_rows++;
+
+        return 0;
+    };
+
+    if (start_new_blockset() != 0)
+    {
+        return_code = -1;
+        return;
+    }
+    for (uint64_t i = 0; i < runs; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - 50)) // 50% chance to create a new entry
+        {
+            entry = {
+                (uint64_t)-1,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                blockset_id};
+        }
+        else
+        {
+            entry = entries[i % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (add_to_blockset_inner(entry) != 0)
+        {
+            return_code = -1;
+            return;
+        }
+
+        // With some probability, create a new blockset
+        if ((rng() % 100) < 5) // 5% chance to create a new blockset
+        {
+            if (start_new_blockset() != 0)
+            {
+                return_code = -1;
+                return;
+            }
+        }
+    }
+
+    return_code = 0;
+    return;
+}
+
+int measure(std::function<void(int, uint64_t, std::vector<std::string> &, Config &, const std::vector<Entry> &, int &, int &)> f, std::vector<Entry> &entries, Config &config, std::string report_name, std::vector<std::string> &pragmas)
+{
+    // Copy the backed up shards, and reset the ID counters to match
+    uint64_t max_blockset = 0;
+    for (auto &entry : entries)
+        max_blockset = std::max(max_blockset, entry.blockset_id);
+    auto copy_db = [&config, &entries, max_blockset]()
+    {
+        for (uint64_t shard = 0; shard < config.num_shards; shard++)
+        {
+            std::string path = shard_path(shard);
+            std::filesystem::remove(path + "-shm");
+            std::filesystem::remove(path + "-wal");
+            std::filesystem::copy_file(path + ".backup", path, std::filesystem::copy_options::overwrite_existing);
+            sqlite3 *db;
+            sqlite3_open(path.c_str(), &db);
+            sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+            sqlite3_wal_checkpoint(db, nullptr);
+            sqlite3_close(db);
+        }
+        next_block_id = entries.size();
+        next_blockset_id = max_blockset + 1;
+    };
+    copy_db();
+
+    std::vector<std::thread> threads;
+    std::vector<int> return_codes(config.num_threads);
+    std::vector<int> num_rows(config.num_threads);
+
+    if (!start_shard_writers(config, pragmas))
+    {
+        stop_shard_writers();
+        return -1;
+    }
+    for (int i = 0; i < config.num_threads; i++)
+        threads.emplace_back(f, i, config.num_warmup / config.num_threads, std::ref(pragmas), std::ref(config), std::ref(entries), std::ref(return_codes[i]), std::ref(num_rows[i]));
+    for (auto &thread : threads)
+        thread.join();
+    threads.clear();
+    stop_shard_writers();
+    for (auto &return_code : return_codes)
+        if (return_code != 0)
+            return -1;
+
+    copy_db();
+
+    if (!start_shard_writers(config, pragmas))
+    {
+        stop_shard_writers();
+        return -1;
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < config.num_threads; i++)
+        threads.emplace_back(f, i, config.num_repetitions / config.num_threads, std::ref(pragmas), std::ref(config), std::ref(entries), std::ref(return_codes[i]), std::ref(num_rows[i]));
+    for (auto &thread : threads)
+        thread.join();
+    auto end = std::chrono::high_resolution_clock::now();
+    threads.clear();
+    stop_shard_writers();
+
+    for (auto &return_code : return_codes)
+        if (return_code != 0)
+            return -1;
+    uint64_t total_rows = 0;
+    for (auto &num_row : num_rows)
+        total_rows += num_row;
+
+    std::cout << "Sharded " << report_name << " (" << config.num_shards << " shards) took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms ("
+              << float(total_rows) / std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " kop/s)" << std::endl;
+
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    bool emit_header = !std::filesystem::exists("reports/sharded_" + report_name + ".csv");
+    std::ofstream report_file("reports/sharded_" + report_name + ".csv", std::ios::app);
+    if (emit_header)
+    {
+        report_file << "num_entries,num_warmup,num_repetitions,num_threads,num_shards,rows,time_us,kop_s\n";
+    }
+
+    report_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << config.num_threads << ","
+                << config.num_shards << ","
+                << total_rows << ","
+                << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << ","
+                << float(total_rows) / (float(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / 1000) << "\n";
+
+    return 0;
+}
+
+int measure_all(std::vector<Entry> &entries, Config &config, std::string &report_name, std::vector<std::string> &pragmas)
+{
+    if (measure(measure_insert, entries, config, "insert", pragmas) != 0)
+        return -1;
+
+    if (measure(measure_xor1, entries, config, "xor1", pragmas) != 0)
+        return -1;
+
+    // The read connection attaches every shard
+    sqlite3 *db;
+    sqlite3_open(":memory:", &db);
+    uint64_t max_attached = sqlite3_limit(db, SQLITE_LIMIT_ATTACHED, -1);
+    sqlite3_close(db);
+    if (config.num_shards <= max_attached)
+    {
+        if (measure(measure_join, entries, config, "join", pragmas) != 0)
+            return -1;
+    }
+    else
+    {
+        std::cout << "Skipping join, " << config.num_shards << " shards exceeds the limit of " << max_attached << " attached databases" << std::endl;
+    }
+
+    if (measure(measure_new_blockset, entries, config, "new_blockset", pragmas) != 0)
+        return -1;
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+    connection_file_config = config;
+
+    // The shards are not created through setup_database, so the emulated disk is installed here
+    if (!slow_vfs::install())
+        return -1;
+
+    std::vector<std::tuple<std::string, std::vector<std::string>>> pragmas_to_run = {
+        {"combination", {"PRAGMA synchronous = NORMAL;", "PRAGMA temp_store = MEMORY;", "PRAGMA cache_size = -64000;", "PRAGMA mmap_size = 64000000;", "PRAGMA threads = 8;"}}
+        //
+    };
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE,
+        "CREATE INDEX BlockHashSize ON Block(Hash, Size);",
+        "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);",
+        "CREATE INDEX BlocksetBlocksetID ON Blockset(ID);"};
+
+    std::cout << "Creating " << config.num_shards << " shard files: " << shard_path(0) << " .. " << shard_path(config.num_shards - 1) << std::endl;
+    std::vector<sqlite3 *> dbs;
+    for (uint64_t shard = 0; shard < config.num_shards; shard++)
+    {
+        std::string path = shard_path(shard);
+        for (const auto &f : {path, path + "-wal", path + "-shm", path + ".backup"})
+            std::remove(f.c_str());
+
+        sqlite3 *db;
+        sqlite3_open(path.c_str(), &db);
+        for (const auto &query : table_queries)
+        {
+            if (!assert_sqlite_return_code(sqlite3_exec(db, query.c_str(), nullptr, nullptr, nullptr), db, "Create shard schema"))
+                return -1;
+        }
+        dbs.push_back(db);
+    }
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(dbs, rng, entries, config.num_entries) != 0)
+        return -1;
+    close_shards(dbs);
+
+    for (uint64_t shard = 0; shard < config.num_shards; shard++)
+        std::filesystem::copy(shard_path(shard), shard_path(shard) + ".backup", std::filesystem::copy_options::overwrite_existing);
+
+    for (auto &[report_name, pragmas] : pragmas_to_run)
+    {
+        int ret = measure_all(entries, config, report_name, pragmas);
+        if (ret != 0)
+        {
+            std::cerr << "Error during report name: " << report_name << std::endl;
+            return ret;
+        }
+    }
+
+    for (uint64_t shard = 0; shard < config.num_shards; shard++)
+    {
+        std::string path = shard_path(shard);
+        for (const auto &f : {path, path + "-shm", path + "-wal", path + ".backup"})
+        {
+            if (std::filesystem::exists(f))
+                std::filesystem::remove(f);
+        }
+    }
+
+    return 0;
+}
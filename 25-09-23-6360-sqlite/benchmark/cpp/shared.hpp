@@ -2,20 +2,34 @@
 #define SHARED_HPP
 
 #include <algorithm>
+#include <atomic>
+#include <barrier>
 #include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <list>
+#include <mutex>
 #include <numeric>
 #include <random>
 #include <sqlite3.h>
 #include <stdint.h>
 #include <string>
 #include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
+#include "slow_vfs.hpp"
+
 const std::string
     CREATE_BLOCKSET_TABLE = "CREATE TABLE Blockset(ID INTEGER PRIMARY KEY, Length INTEGER NOT NULL);",
     CREATE_BLOCKSETENTRY_TABLE = "CREATE TABLE BlocksetEntry(BlocksetID INTEGER NOT NULL, BlockID INTEGER NOT NULL);",
@@ -29,6 +43,22 @@ struct Config
     uint64_t num_repetitions = 10'000;
     uint64_t num_threads = 8;
     uint64_t num_batch = 0;
+    uint64_t num_shards = 4;
+    uint64_t num_processes = 0; // Worker processes in parallel, 0 runs the workloads on threads
+    std::string threading_mode = "default";
+    std::string allocator = "default"; // default or pool
+    bool memstatus = true;
+    std::string lookaside = "default"; // default, off or <slot size>x<slot count>
+    std::string vfs = "default";
+    std::string disk_profile = "none";   // none, hdd, sd or smb
+    uint64_t chunk_size = 0;             // Bytes the database file grows by, 0 grows it page by page
+    uint64_t size_hint = 0;              // Bytes to preallocate for the database file
+    uint64_t wal_size_hint = 0;          // Bytes to preallocate for the WAL file, in WAL mode
+    uint64_t reader_hold_ms = 0;         // Time a long-lived reader holds its snapshot while the writers run, 0 disables it
+    uint64_t hash_cost_ns = 2000;        // CPU time the pipeline spends hashing each block
+    std::string batch_policy = "static"; // static, time, adaptive or compare, for when batching commits
+    uint64_t commit_interval_ms = 100;   // Time between commits with the time policy
+    uint64_t commit_target_us = 5000;    // p99 commit latency the adaptive policy stays under
 };
 
 bool assert_sqlite_return_code(int rc, sqlite3 *db, const std::string &context)
@@ -68,9 +98,55 @@ Config parse_args(int argc, char *argv[])
             config.num_threads = std::stoi(argv[++i]);
         else if (std::string(argv[i]) == "--num-batch" && i + 1 < argc)
             config.num_batch = std::stoi(argv[++i]);
+        else if (std::string(argv[i]) == "--num-shards" && i + 1 < argc)
+            config.num_shards = std::stoi(argv[++i]);
+        else if (std::string(argv[i]) == "--num-processes" && i + 1 < argc)
+            config.num_processes = std::stoi(argv[++i]);
+        else if (std::string(argv[i]) == "--threading-mode" && i + 1 < argc)
+            config.threading_mode = argv[++i];
+        else if (std::string(argv[i]) == "--allocator" && i + 1 < argc)
+            config.allocator = argv[++i];
+        else if (std::string(argv[i]) == "--memstatus" && i + 1 < argc)
+            config.memstatus = std::string(argv[++i]) != "off";
+        else if (std::string(argv[i]) == "--lookaside" && i + 1 < argc)
+            config.lookaside = argv[++i];
+        else if (std::string(argv[i]) == "--vfs" && i + 1 < argc)
+            config.vfs = argv[++i];
+        else if (std::string(argv[i]) == "--chunk-size" && i + 1 < argc)
+            config.chunk_size = std::stoull(argv[++i]);
+        else if (std::string(argv[i]) == "--size-hint" && i + 1 < argc)
+            config.size_hint = std::stoull(argv[++i]);
+        else if (std::string(argv[i]) == "--wal-size-hint" && i + 1 < argc)
+            config.wal_size_hint = std::stoull(argv[++i]);
+        else if (std::string(argv[i]) == "--reader-hold-ms" && i + 1 < argc)
+            config.reader_hold_ms = std::stoull(argv[++i]);
+        else if (std::string(argv[i]) == "--hash-cost-ns" && i + 1 < argc)
+            config.hash_cost_ns = std::stoull(argv[++i]);
+        else if (std::string(argv[i]) == "--batch-policy" && i + 1 < argc)
+            config.batch_policy = argv[++i];
+        else if (std::string(argv[i]) == "--commit-interval-ms" && i + 1 < argc)
+            config.commit_interval_ms = std::stoull(argv[++i]);
+        else if (std::string(argv[i]) == "--commit-target-us" && i + 1 < argc)
+            config.commit_target_us = std::stoull(argv[++i]);
+        else if (std::string(argv[i]) == "--disk-profile" && i + 1 < argc)
+        {
+            config.disk_profile = argv[++i];
+            // Running without the emulation would file undelayed results under the profile's name
+            if (!slow_vfs::select_profile(config.disk_profile))
+            {
+                std::cerr << "Unknown disk profile: " << config.disk_profile << std::endl;
+                std::exit(1);
+            }
+        }
         else
             std::cerr << "Unknown argument: " << argv[i] << std::endl;
     }
+    // Rows are routed with a modulo on the shard count
+    if (config.num_shards < 1)
+    {
+        std::cerr << "--num-shards must be at least 1" << std::endl;
+        std::exit(1);
+    }
     return config;
 }
 
@@ -140,7 +216,246 @@ void report_stats(Config &config, std::vector<uint64_t> &times, std::string benc
                 << std::endl;
 }
 
-sqlite3 *setup_database(std::vector<std::string> &table_queries)
+// Size class pool allocator for SQLITE_CONFIG_MALLOC. Every thread keeps its own free lists, so allocations only take a lock when a
+// thread runs dry and refills from the blocks left behind by exited threads. Each block starts with a 16 byte header holding its size class.
+namespace pool_allocator
+{
+    const int NUM_CLASSES = 11; // 32 bytes to 32 KiB, larger allocations go directly to malloc
+    const int LARGE = NUM_CLASSES;
+    const size_t HEADER_SIZE = 16;
+    const size_t CHUNK_SIZE = 256 * 1024;
+
+    struct Block
+    {
+        Block *next;
+    };
+
+    struct Header
+    {
+        uint64_t size_class;
+        uint64_t usable_size;
+    };
+
+    // Free blocks of exited threads, picked up again by the next thread that runs dry
+    struct Depot
+    {
+        std::mutex mutex;
+        Block *free_lists[NUM_CLASSES] = {};
+    };
+
+    Depot depot;
+
+    struct ThreadCache
+    {
+        Block *free_lists[NUM_CLASSES] = {};
+
+        ~ThreadCache()
+        {
+            std::lock_guard<std::mutex> lock(depot.mutex);
+            for (int c = 0; c < NUM_CLASSES; c++)
+            {
+                while (free_lists[c] != nullptr)
+                {
+                    Block *block = free_lists[c];
+                    free_lists[c] = block->next;
+                    block->next = depot.free_lists[c];
+                    depot.free_lists[c] = block;
+                }
+            }
+        }
+    };
+
+    thread_local ThreadCache cache;
+
+    size_t class_size(int size_class) { return size_t(32) << size_class; }
+
+    int size_class_of(int n)
+    {
+        int c = 0;
+        while (c < NUM_CLASSES && class_size(c) < (size_t)n)
+            c++;
+        return c;
+    }
+
+    // Takes the whole depot list for the class if there is one, otherwise carves a new chunk into blocks
+    bool refill(int size_class)
+    {
+        {
+            std::lock_guard<std::mutex> lock(depot.mutex);
+            if (depot.free_lists[size_class] != nullptr)
+            {
+                cache.free_lists[size_class] = depot.free_lists[size_class];
+                depot.free_lists[size_class] = nullptr;
+                return true;
+            }
+        }
+
+        size_t block_size = HEADER_SIZE + class_size(size_class);
+        size_t count = std::max<size_t>(CHUNK_SIZE / block_size, 1);
+        char *chunk = (char *)std::malloc(block_size * count);
+        if (chunk == nullptr)
+            return false;
+        for (size_t i = 0; i < count; i++)
+        {
+            Block *block = (Block *)(chunk + i * block_size);
+            block->next = cache.free_lists[size_class];
+            cache.free_lists[size_class] = block;
+        }
+        return true;
+    }
+
+    void *pool_malloc(int n)
+    {
+        int size_class = size_class_of(n);
+        Header *header;
+        if (size_class == LARGE)
+        {
+            header = (Header *)std::malloc(HEADER_SIZE + n);
+            if (header == nullptr)
+                return nullptr;
+            header->usable_size = n;
+        }
+        else
+        {
+            if (cache.free_lists[size_class] == nullptr && !refill(size_class))
+                return nullptr;
+            Block *block = cache.free_lists[size_class];
+            cache.free_lists[size_class] = block->next;
+            header = (Header *)block;
+            header->usable_size = class_size(size_class);
+        }
+        header->size_class = size_class;
+        return (char *)header + HEADER_SIZE;
+    }
+
+    // Blocks are returned to the free list of the freeing thread, which is not necessarily the one that allocated them
+    void pool_free(void *p)
+    {
+        Header *header = (Header *)((char *)p - HEADER_SIZE);
+        if (header->size_class == LARGE)
+        {
+            std::free(header);
+            return;
+        }
+        // The list link overwrites the header, so the size class is read first
+        uint64_t size_class = header->size_class;
+        Block *block = (Block *)header;
+        block->next = cache.free_lists[size_class];
+        cache.free_lists[size_class] = block;
+    }
+
+    int pool_size(void *p)
+    {
+        return ((Header *)((char *)p - HEADER_SIZE))->usable_size;
+    }
+
+    void *pool_realloc(void *p, int n)
+    {
+        if (n <= pool_size(p))
+            return p;
+        void *q = pool_malloc(n);
+        if (q == nullptr)
+            return nullptr;
+        std::memcpy(q, p, pool_size(p));
+        pool_free(p);
+        return q;
+    }
+
+    int pool_roundup(int n)
+    {
+        int size_class = size_class_of(n);
+        return size_class == LARGE ? n : class_size(size_class);
+    }
+
+    int pool_init(void *) { return SQLITE_OK; }
+
+    void pool_shutdown(void *) {}
+
+    sqlite3_mem_methods methods = {pool_malloc, pool_free, pool_realloc, pool_size, pool_roundup, pool_init, pool_shutdown, nullptr};
+}
+
+// Installs the allocator and memory statistics setting from the config. Must be called before SQLite is initialized, or after sqlite3_shutdown.
+bool configure_memory(const Config &config)
+{
+    // The built-in allocator is saved on the first call, so it can be restored after the pool has been installed
+    static sqlite3_mem_methods default_methods;
+    static bool saved = false;
+    if (!saved)
+    {
+        sqlite3_config(SQLITE_CONFIG_GETMALLOC, &default_methods);
+        saved = true;
+    }
+
+    sqlite3_mem_methods *methods = config.allocator == "pool" ? &pool_allocator::methods : config.allocator == "default" ? &default_methods
+                                                                                                                          : nullptr;
+    if (methods == nullptr || sqlite3_config(SQLITE_CONFIG_MALLOC, methods) != SQLITE_OK)
+    {
+        std::cerr << "Unable to set allocator: " << config.allocator << std::endl;
+        return false;
+    }
+    if (sqlite3_config(SQLITE_CONFIG_MEMSTATUS, config.memstatus ? 1 : 0) != SQLITE_OK)
+    {
+        std::cerr << "Unable to set memstatus" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Sets the lookaside buffer of a freshly opened connection (default, off or <slot size>x<slot count>), before it has made any lookaside allocations.
+bool configure_lookaside(sqlite3 *db, const std::string &lookaside)
+{
+    if (lookaside == "default")
+        return true;
+
+    int slot_size = 0, slot_count = 0;
+    if (lookaside != "off")
+    {
+        auto x = lookaside.find('x');
+        if (x == std::string::npos)
+        {
+            std::cerr << "Invalid lookaside setting: " << lookaside << std::endl;
+            return false;
+        }
+        slot_size = std::stoi(lookaside.substr(0, x));
+        slot_count = std::stoi(lookaside.substr(x + 1));
+    }
+    return assert_sqlite_return_code(sqlite3_db_config(db, SQLITE_DBCONFIG_LOOKASIDE, nullptr, slot_size, slot_count), db, "Set lookaside " + lookaside);
+}
+
+// Applies the file growth settings to the files of a connection. The unix VFS only acts on a size hint when a chunk size is set, so a
+// hint without a chunk size uses 1 MiB chunks. The WAL is only reached in WAL mode, where it is opened by reading the schema.
+bool apply_file_controls(sqlite3 *db, const Config &config)
+{
+    int chunk_size = config.chunk_size > 0 ? config.chunk_size : 1024 * 1024;
+    if ((config.chunk_size > 0 || config.size_hint > 0) &&
+        !assert_sqlite_return_code(sqlite3_file_control(db, "main", SQLITE_FCNTL_CHUNK_SIZE, &chunk_size), db, "Set chunk size"))
+        return false;
+    if (config.size_hint > 0)
+    {
+        sqlite3_int64 size_hint = config.size_hint;
+        if (!assert_sqlite_return_code(sqlite3_file_control(db, "main", SQLITE_FCNTL_SIZE_HINT, &size_hint), db, "Set size hint"))
+            return false;
+    }
+
+    if (config.wal_size_hint > 0)
+    {
+        if (!assert_sqlite_return_code(sqlite3_exec(db, "PRAGMA schema_version;", nullptr, nullptr, nullptr), db, "Open WAL"))
+            return false;
+        sqlite3_file *wal = nullptr;
+        sqlite3_file_control(db, "main", SQLITE_FCNTL_JOURNAL_POINTER, &wal);
+        if (wal == nullptr || wal->pMethods == nullptr)
+            return true; // Not in WAL mode
+        sqlite3_int64 size_hint = config.wal_size_hint;
+        if (!assert_sqlite_return_code(wal->pMethods->xFileControl(wal, SQLITE_FCNTL_CHUNK_SIZE, &chunk_size), db, "Set WAL chunk size") ||
+            !assert_sqlite_return_code(wal->pMethods->xFileControl(wal, SQLITE_FCNTL_SIZE_HINT, &size_hint), db, "Set WAL size hint"))
+            return false;
+    }
+
+    return true;
+}
+
+// Creation pragmas (page_size, auto_vacuum, ...) only take effect on an empty database, so they run before the first table is created.
+sqlite3 *setup_database(std::vector<std::string> &table_queries, const Config &config, const std::vector<std::string> &creation_pragmas = {})
 {
     // Delete the database files if they exist
     std::cout << "Deleting database files: "
@@ -155,10 +470,20 @@ sqlite3 *setup_database(std::vector<std::string> &table_queries)
     std::remove((DBPATH + "-shm").c_str());
     std::remove((DBPATH + ".backup").c_str());
 
+    // The emulated disk is installed here, as registering a VFS initializes SQLite, after which it can no longer be configured
+    if (!slow_vfs::install())
+        std::cerr << "Unable to install the emulated disk" << std::endl;
+
     std::cout << "Creating database file: " << DBPATH << std::endl;
     sqlite3 *db;
     sqlite3_open(DBPATH.c_str(), &db);
 
+    for (const auto &pragma : creation_pragmas)
+    {
+        if (!assert_sqlite_return_code(sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr), db, "Set creation pragma " + pragma))
+            std::cerr << "Continuing without " << pragma << std::endl;
+    }
+
     for (auto query : table_queries)
     {
         char *errMsg = nullptr;
@@ -169,6 +494,10 @@ sqlite3 *setup_database(std::vector<std::string> &table_queries)
         }
     }
 
+    // Applied once the tables exist, as a file preallocated before the header is written is not a database
+    if (!apply_file_controls(db, config))
+        std::cerr << "Unable to apply the file growth settings" << std::endl;
+
     return db;
 }
 
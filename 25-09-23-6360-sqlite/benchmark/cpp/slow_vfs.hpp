@@ -0,0 +1,256 @@
+#ifndef SLOW_VFS_HPP
+#define SLOW_VFS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// VFS wrapping the default one, which delays every read, write and sync to emulate a slower device, so the benchmarks can be replayed on
+// low-end storage from a fast machine. All files share one emulated device with a timeline: each operation occupies the device for its
+// transfer time (size over bandwidth), plus a seek penalty when it does not continue where the previous operation ended, and plus its
+// per-operation latency on devices that serve one request at a time. On network mounts the latency is a round trip, and overlaps other
+// requests. Latencies are drawn from a lognormal distribution around the median.
+//
+// Memory mapped reads are refused, so every read is charged, as if the OS page cache was cold.
+namespace slow_vfs
+{
+    struct Latency
+    {
+        double median_us;
+        double sigma; // Of the underlying normal distribution, 0 for a constant latency
+    };
+
+    struct Profile
+    {
+        std::string name;
+        Latency read, write, sync;
+        double read_mb_s, write_mb_s;
+        double seek_us;
+        sqlite3_int64 sequential_window; // Accesses within this distance of the previous one do not seek
+        bool serialized;                 // Whether the per-operation latency occupies the device
+    };
+
+    const std::vector<Profile> PROFILES = {
+        // 7200 rpm disk: cheap sequential access, a seek and half a rotation otherwise, and a cache flush on sync
+        {"hdd", {100, 0.3}, {100, 0.3}, {10'000, 0.5}, 160, 150, 8'000, 128 * 1024, true},
+        // SD card in a single board computer: slow writes, worse when random because of the erase blocks, and long syncs
+        {"sd", {250, 0.4}, {1'500, 0.8}, {20'000, 0.8}, 40, 12, 2'000, 64 * 1024, true},
+        // SMB mount over gigabit ethernet: every operation is a round trip, seeks are free, and a sync is a round trip plus a server flush
+        {"smb", {500, 0.5}, {600, 0.5}, {3'000, 0.5}, 110, 100, 0, 0, false}};
+
+    const Profile *profile = nullptr;
+    sqlite3_vfs *wrapped = nullptr;
+
+    // Emulated device, shared by all files and threads
+    std::mutex device_mutex;
+    std::chrono::steady_clock::time_point busy_until;
+    const void *head_file = nullptr;
+    sqlite3_int64 head_offset = 0;
+
+    double sample(const Latency &latency)
+    {
+        thread_local std::mt19937 rng(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        if (latency.sigma == 0)
+            return latency.median_us;
+        std::lognormal_distribution<double> distribution(std::log(latency.median_us), latency.sigma);
+        return distribution(rng);
+    }
+
+    // Sleeps for the bulk of the wait, and spins the last part, as sleeps overshoot by tens of microseconds
+    void wait_until(std::chrono::steady_clock::time_point deadline)
+    {
+        auto slack = std::chrono::microseconds(100);
+        if (deadline - std::chrono::steady_clock::now() > slack)
+            std::this_thread::sleep_until(deadline - slack);
+        while (std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();
+    }
+
+    // Charges an operation of the given size at the given offset, or a sync when bytes is 0
+    void charge(const void *file, const Latency &latency, double mb_s, sqlite3_int64 offset, int bytes)
+    {
+        double latency_us = sample(latency);
+        double occupied_us = mb_s > 0 ? bytes / mb_s : 0; // Bytes per microsecond equals megabytes per second
+        if (profile->serialized)
+            occupied_us += latency_us;
+
+        std::chrono::steady_clock::time_point done;
+        {
+            std::lock_guard<std::mutex> lock(device_mutex);
+            if (bytes > 0)
+            {
+                if (file != head_file || std::abs(offset - head_offset) > profile->sequential_window)
+                    occupied_us += profile->seek_us;
+                head_file = file;
+                head_offset = offset + bytes;
+            }
+            busy_until = std::max(busy_until, std::chrono::steady_clock::now()) + std::chrono::nanoseconds((int64_t)(occupied_us * 1000));
+            done = busy_until;
+        }
+        if (!profile->serialized)
+            done += std::chrono::nanoseconds((int64_t)(latency_us * 1000));
+        wait_until(done);
+    }
+
+    struct File
+    {
+        sqlite3_file base; // Must be first, SQLite only knows this part
+        sqlite3_file *real; // File of the wrapped VFS, stored right after this struct
+    };
+
+    sqlite3_file *real(sqlite3_file *file) { return ((File *)file)->real; }
+
+    int x_close(sqlite3_file *file) { return real(file)->pMethods->xClose(real(file)); }
+
+    int x_read(sqlite3_file *file, void *buffer, int amount, sqlite3_int64 offset)
+    {
+        charge(file, profile->read, profile->read_mb_s, offset, amount);
+        return real(file)->pMethods->xRead(real(file), buffer, amount, offset);
+    }
+
+    int x_write(sqlite3_file *file, const void *buffer, int amount, sqlite3_int64 offset)
+    {
+        charge(file, profile->write, profile->write_mb_s, offset, amount);
+        return real(file)->pMethods->xWrite(real(file), buffer, amount, offset);
+    }
+
+    int x_truncate(sqlite3_file *file, sqlite3_int64 size) { return real(file)->pMethods->xTruncate(real(file), size); }
+
+    int x_sync(sqlite3_file *file, int flags)
+    {
+        charge(file, profile->sync, 0, 0, 0);
+        return real(file)->pMethods->xSync(real(file), flags);
+    }
+
+    int x_file_size(sqlite3_file *file, sqlite3_int64 *size) { return real(file)->pMethods->xFileSize(real(file), size); }
+    int x_lock(sqlite3_file *file, int lock) { return real(file)->pMethods->xLock(real(file), lock); }
+    int x_unlock(sqlite3_file *file, int lock) { return real(file)->pMethods->xUnlock(real(file), lock); }
+    int x_check_reserved_lock(sqlite3_file *file, int *out) { return real(file)->pMethods->xCheckReservedLock(real(file), out); }
+    int x_file_control(sqlite3_file *file, int op, void *arg) { return real(file)->pMethods->xFileControl(real(file), op, arg); }
+    int x_sector_size(sqlite3_file *file) { return real(file)->pMethods->xSectorSize(real(file)); }
+    int x_device_characteristics(sqlite3_file *file) { return real(file)->pMethods->xDeviceCharacteristics(real(file)); }
+    int x_shm_map(sqlite3_file *file, int page, int size, int extend, void volatile **out) { return real(file)->pMethods->xShmMap(real(file), page, size, extend, out); }
+    int x_shm_lock(sqlite3_file *file, int offset, int n, int flags) { return real(file)->pMethods->xShmLock(real(file), offset, n, flags); }
+    void x_shm_barrier(sqlite3_file *file) { real(file)->pMethods->xShmBarrier(real(file)); }
+    int x_shm_unmap(sqlite3_file *file, int delete_flag) { return real(file)->pMethods->xShmUnmap(real(file), delete_flag); }
+
+    int x_fetch(sqlite3_file *file, sqlite3_int64 offset, int amount, void **out)
+    {
+        *out = nullptr;
+        return SQLITE_OK;
+    }
+
+    int x_unfetch(sqlite3_file *file, sqlite3_int64 offset, void *p) { return SQLITE_OK; }
+
+    const sqlite3_io_methods io_methods = {
+        3,
+        x_close,
+        x_read,
+        x_write,
+        x_truncate,
+        x_sync,
+        x_file_size,
+        x_lock,
+        x_unlock,
+        x_check_reserved_lock,
+        x_file_control,
+        x_sector_size,
+        x_device_characteristics,
+        x_shm_map,
+        x_shm_lock,
+        x_shm_barrier,
+        x_shm_unmap,
+        x_fetch,
+        x_unfetch};
+
+    int x_open(sqlite3_vfs *vfs, const char *name, sqlite3_file *file, int flags, int *out_flags)
+    {
+        File *f = (File *)file;
+        f->real = (sqlite3_file *)(f + 1);
+        int rc = wrapped->xOpen(wrapped, name, f->real, flags, out_flags);
+        if (rc != SQLITE_OK)
+        {
+            if (f->real->pMethods != nullptr)
+                f->real->pMethods->xClose(f->real);
+            f->base.pMethods = nullptr;
+            return rc;
+        }
+        f->base.pMethods = &io_methods;
+        return SQLITE_OK;
+    }
+
+    int x_delete(sqlite3_vfs *vfs, const char *name, int sync_dir) { return wrapped->xDelete(wrapped, name, sync_dir); }
+    int x_access(sqlite3_vfs *vfs, const char *name, int flags, int *out) { return wrapped->xAccess(wrapped, name, flags, out); }
+    int x_full_pathname(sqlite3_vfs *vfs, const char *name, int size, char *out) { return wrapped->xFullPathname(wrapped, name, size, out); }
+    void *x_dl_open(sqlite3_vfs *vfs, const char *name) { return wrapped->xDlOpen(wrapped, name); }
+    void x_dl_error(sqlite3_vfs *vfs, int size, char *out) { wrapped->xDlError(wrapped, size, out); }
+    void (*x_dl_sym(sqlite3_vfs *vfs, void *handle, const char *symbol))(void) { return wrapped->xDlSym(wrapped, handle, symbol); }
+    void x_dl_close(sqlite3_vfs *vfs, void *handle) { wrapped->xDlClose(wrapped, handle); }
+    int x_randomness(sqlite3_vfs *vfs, int size, char *out) { return wrapped->xRandomness(wrapped, size, out); }
+    int x_sleep(sqlite3_vfs *vfs, int microseconds) { return wrapped->xSleep(wrapped, microseconds); }
+    int x_current_time(sqlite3_vfs *vfs, double *out) { return wrapped->xCurrentTime(wrapped, out); }
+    int x_get_last_error(sqlite3_vfs *vfs, int size, char *out) { return wrapped->xGetLastError(wrapped, size, out); }
+    int x_current_time_int64(sqlite3_vfs *vfs, sqlite3_int64 *out) { return wrapped->xCurrentTimeInt64(wrapped, out); }
+
+    sqlite3_vfs vfs;
+
+    // Picks the profile by name, without touching SQLite, so it can be called before SQLite is configured. "none" disables the emulation.
+    bool select_profile(const std::string &name)
+    {
+        profile = nullptr;
+        if (name == "none")
+            return true;
+        for (const auto &p : PROFILES)
+        {
+            if (p.name == name)
+                profile = &p;
+        }
+        return profile != nullptr;
+    }
+
+    // Registers the VFS as the default, if a profile is selected. Initializing SQLite registers its own VFS as the default again, so
+    // this has to be repeated after every sqlite3_initialize that follows a sqlite3_shutdown.
+    bool install()
+    {
+        if (profile == nullptr)
+            return true;
+        if (wrapped == nullptr)
+        {
+            wrapped = sqlite3_vfs_find(nullptr);
+            if (wrapped == nullptr)
+                return false;
+            vfs = {
+                2,
+                (int)(sizeof(File) + wrapped->szOsFile),
+                wrapped->mxPathname,
+                nullptr,
+                "slow",
+                nullptr,
+                x_open,
+                x_delete,
+                x_access,
+                x_full_pathname,
+                x_dl_open,
+                x_dl_error,
+                x_dl_sym,
+                x_dl_close,
+                x_randomness,
+                x_sleep,
+                x_current_time,
+                x_get_last_error,
+                x_current_time_int64};
+            std::cout << "Emulating disk profile: " << profile->name << std::endl;
+        }
+        return sqlite3_vfs_register(&vfs, 1) == SQLITE_OK;
+    }
+}
+
+#endif
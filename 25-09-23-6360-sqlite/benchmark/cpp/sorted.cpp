@@ -0,0 +1,321 @@
+#include "shared.hpp"
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+// A probe in a batch; the key is the first 8 bytes of the hash in big-endian order, which matches the BINARY collation order of the index.
+struct Probe
+{
+    uint64_t key;
+    uint32_t index;
+};
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+uint64_t hash_prefix(const std::string &hash)
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; i++)
+        key = (key << 8) | (i < hash.size() ? (uint8_t)hash[i] : 0);
+    return key;
+}
+
+// LSD radix sort on the 8 byte key, one byte per pass. Passes where every key has the same byte are skipped.
+void radix_sort(std::vector<Probe> &probes, std::vector<Probe> &scratch)
+{
+    scratch.resize(probes.size());
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t counts[256] = {0};
+        for (const auto &probe : probes)
+            counts[(probe.key >> shift) & 0xFF]++;
+        if (counts[(probes.front().key >> shift) & 0xFF] == probes.size())
+            continue;
+
+        size_t offset = 0;
+        for (auto &count : counts)
+        {
+            size_t c = count;
+            count = offset;
+            offset += c;
+        }
+        for (const auto &probe : probes)
+            scratch[counts[(probe.key >> shift) & 0xFF]++] = probe;
+        probes.swap(scratch);
+    }
+}
+
+int measure_sorted_select(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, uint64_t batch_size, const std::string &report_name)
+{
+    std::string sql = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;";
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare select statement"))
+        return -1;
+
+    std::vector<const Entry *> batch;
+    std::vector<Probe> probes, scratch;
+    std::vector<uint64_t> results;
+    batch.reserve(batch_size);
+    probes.reserve(batch_size);
+    results.reserve(batch_size);
+
+    // Buffers a batch of keys, sorts it by key, probes the index in key order, and scatters the results back to caller order.
+    auto run_batch = [&](const std::string &prefix) -> int
+    {
+        probes.clear();
+        for (uint32_t i = 0; i < batch.size(); i++)
+            probes.push_back({hash_prefix(batch[i]->hash), i});
+        if (probes.size() > 1)
+            radix_sort(probes, scratch);
+
+        results.assign(batch.size(), (uint64_t)-1);
+        for (const auto &probe : probes)
+        {
+            const Entry *entry = batch[probe.index];
+            sqlite3_bind_text(stmt, 1, entry->hash.c_str(), entry->hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt, 2, entry->size);
+            auto rc = sqlite3_step(stmt);
+            if (!assert_sqlite_return_code(rc, db, prefix + " sorted select"))
+                return -1;
+            if (rc == SQLITE_ROW)
+                results[probe.index] = sqlite3_column_int64(stmt, 0);
+            sqlite3_reset(stmt);
+        }
+
+        return 0;
+    };
+
+    auto verify_batch = [&](const std::string &prefix) -> int
+    {
+        for (size_t i = 0; i < batch.size(); i++)
+            if (!assert_value_matches(batch[i]->id, results[i], prefix + " sorted ID check"))
+                return -1;
+        return 0;
+    };
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    for (uint64_t i = 0; i < config.num_warmup; i += batch_size)
+    {
+        batch.clear();
+        for (uint64_t j = 0; j < batch_size; j++)
+            batch.push_back(&entries[rng() % entries.size()]);
+        if (run_batch("Warmup") != 0 || verify_batch("Warmup") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+    int cache_hit, cache_miss, highwater;
+    sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_HIT, &cache_hit, &highwater, 1);
+    sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &cache_miss, &highwater, 1);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    uint64_t total_time = 0, total_rows = 0;
+    while (total_rows < config.num_repetitions)
+    {
+        batch.clear();
+        for (uint64_t j = 0; j < batch_size; j++)
+            batch.push_back(&entries[rng() % entries.size()]);
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        if (run_batch("Actual") != 0)
+            return -1;
+        auto end = std::chrono::high_resolution_clock::now();
+        total_time += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        total_rows += batch.size();
+
+        if (verify_batch("Actual") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+    sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_HIT, &cache_hit, &highwater, 1);
+    sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &cache_miss, &highwater, 1);
+
+    sqlite3_finalize(stmt);
+
+    double miss_ratio = (cache_hit + cache_miss) > 0 ? double(cache_miss) / (cache_hit + cache_miss) : 0.0;
+    std::cout << "Sorted " << report_name << " batch " << batch_size << " took "
+              << total_time / 1000000 << " ms ("
+              << float(total_rows) / (float(total_time) / 1000000) << " kop/s, "
+              << cache_miss << " cache misses)" << std::endl;
+
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    bool emit_header = !std::filesystem::exists("reports/sorted_" + report_name + ".csv");
+    std::ofstream report_file("reports/sorted_" + report_name + ".csv", std::ios::app);
+    if (emit_header)
+    {
+        report_file << "num_entries,num_warmup,num_repetitions,batch,rows,cache_hit,cache_miss,miss_ratio,time_us,kop_s\n";
+    }
+
+    report_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << batch_size << ","
+                << total_rows << ","
+                << cache_hit << ","
+                << cache_miss << ","
+                << miss_ratio << ","
+                << total_time / 1000 << ","
+                << float(total_rows) / (float(total_time) / 1000000) << "\n";
+
+    return 0;
+}
+
+int measure_all(std::vector<Entry> &entries, Config &config, const std::string &report_name, std::vector<std::string> &pragmas, std::vector<uint64_t> &batch_sizes)
+{
+    for (auto batch_size : batch_sizes)
+    {
+        // Reopen for every batch size, so each run starts with a cold page cache.
+        sqlite3 *db;
+        sqlite3_open(DBPATH.c_str(), &db);
+        std::mt19937 rng(~2025'07'08);
+
+        for (const auto &pragma : pragmas)
+        {
+            sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr);
+        }
+
+        if (measure_sorted_select(db, config, rng, entries, batch_size, report_name) != 0)
+            return -1;
+
+        sqlite3_close(db);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    std::vector<std::tuple<std::string, std::vector<std::string>>> pragmas_to_run = {
+        {"cache_size_2M", {"PRAGMA cache_size = -2000;"}},
+        {"cache_size_64M", {"PRAGMA cache_size = -64000;"}},
+        //
+    };
+
+    // A batch size of 1 is the unsorted baseline, as every probe is issued in caller order.
+    std::vector<uint64_t> batch_sizes = {1, 16, 256, 4096, 65536};
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    auto db = setup_database(table_queries, config);
+
+    sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetBlocksetID ON Blockset(ID);", nullptr, nullptr, nullptr);
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(db, rng, entries, config.num_entries) != 0)
+        return -1;
+    sqlite3_close(db);
+
+    for (auto &[report_name, pragmas] : pragmas_to_run)
+    {
+        std::cout << "Running " << report_name << std::endl;
+        int ret = measure_all(entries, config, report_name, pragmas, batch_sizes);
+        if (ret != 0)
+            return ret;
+    }
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
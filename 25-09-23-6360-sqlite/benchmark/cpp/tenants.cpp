@@ -0,0 +1,457 @@
+#include "shared.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+const std::vector<uint64_t> TENANT_COUNTS = {1, 2, 4, 8, 16, 32, 64, 128, 256};
+const uint64_t
+    TASK_OPS = 16,             // Operations a worker runs on a tenant before moving on to the next one
+    MIN_TENANT_ENTRIES = 1000; // Tenant sizes are lognormal around --num-entries, clamped to this and 10 times the median
+const double TENANT_SIZE_SIGMA = 1.0;
+
+// One backup job: its own database, and the connection the pool threads use for it, one thread at a time.
+struct Tenant
+{
+    std::string path;
+    uint64_t num_entries = 0;
+    uint64_t num_blocksets = 0;
+    sqlite3 *db = nullptr;
+    sqlite3_stmt *stmt_select = nullptr, *stmt_check = nullptr, *stmt_insert = nullptr, *stmt_join = nullptr;
+    std::mutex mutex;
+    std::mt19937 rng;
+    uint64_t ops = 0;
+    uint64_t busy_ns = 0;
+    std::vector<uint64_t> latencies;
+};
+
+std::string tenant_path(uint64_t tenant)
+{
+    return DBPATH + ".tenant" + std::to_string(tenant);
+}
+
+// Fills a tenant like fill() in the other benchmarks, without keeping the entries, as all the tenants together would not fit in memory.
+// The workloads find existing blocks through their ID instead. Returns the number of blocksets, or -1 on error.
+int64_t fill(sqlite3 *db, std::mt19937 &rng, uint64_t num_entries)
+{
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        std::string hash = random_hash_string(rng, 44);
+        sqlite3_bind_int64(stmt_block, 1, i);
+        sqlite3_bind_text(stmt_block, 2, hash.c_str(), hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, rng() % 1000);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, i);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+    else
+        blockset_id--;
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    return blockset_id;
+}
+
+bool open_tenant(Tenant &tenant, const std::vector<std::string> &pragmas)
+{
+    if (!assert_sqlite_return_code(sqlite3_open_v2(tenant.path.c_str(), &tenant.db, SQLITE_OPEN_READWRITE, nullptr), tenant.db, "Open " + tenant.path))
+        return false;
+    for (const auto &pragma : pragmas)
+    {
+        if (!assert_sqlite_return_code(sqlite3_exec(tenant.db, pragma.c_str(), nullptr, nullptr, nullptr), tenant.db, "Set pragma " + pragma))
+            return false;
+    }
+
+    std::string
+        sql_select = "SELECT ID FROM Block WHERE Hash = (SELECT Hash FROM Block WHERE ID = ?1) AND Size = (SELECT Size FROM Block WHERE ID = ?1);",
+        sql_check = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_insert = "INSERT INTO Block (Hash, Size) VALUES (?, ?);",
+        sql_join = "SELECT Block.Hash, Block.Size FROM BlocksetEntry JOIN Block ON Block.ID = BlocksetEntry.BlockID WHERE BlocksetEntry.BlocksetID = ?;";
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(tenant.db, sql_select.c_str(), -1, &tenant.stmt_select, nullptr), tenant.db, "Prepare select statement"))
+        return false;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(tenant.db, sql_check.c_str(), -1, &tenant.stmt_check, nullptr), tenant.db, "Prepare check statement"))
+        return false;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(tenant.db, sql_insert.c_str(), -1, &tenant.stmt_insert, nullptr), tenant.db, "Prepare insert statement"))
+        return false;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(tenant.db, sql_join.c_str(), -1, &tenant.stmt_join, nullptr), tenant.db, "Prepare join statement"))
+        return false;
+
+    return true;
+}
+
+void close_tenant(Tenant &tenant)
+{
+    sqlite3_finalize(tenant.stmt_select);
+    sqlite3_finalize(tenant.stmt_check);
+    sqlite3_finalize(tenant.stmt_insert);
+    sqlite3_finalize(tenant.stmt_join);
+    sqlite3_close(tenant.db);
+    tenant.db = nullptr;
+}
+
+// Runs one operation of the mix on the tenant: 60% lookups of existing blocks, 30% xor1 style inserts of new blocks, and 10% joins of a
+// blockset with its blocks. Must be called with the tenant locked.
+int run_operation(Tenant &tenant)
+{
+    sqlite3 *db = tenant.db;
+    uint64_t kind = tenant.rng() % 100;
+    int rc;
+    if (kind < 60)
+    {
+        sqlite3_bind_int64(tenant.stmt_select, 1, tenant.rng() % tenant.num_entries);
+        while ((rc = sqlite3_step(tenant.stmt_select)) == SQLITE_ROW)
+            ;
+        sqlite3_reset(tenant.stmt_select);
+        if (!assert_sqlite_return_code(rc, db, "Select block"))
+            return -1;
+    }
+    else if (kind < 90)
+    {
+        std::string hash = random_hash_string(tenant.rng, 44);
+        uint64_t size = tenant.rng() % 1000;
+        sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+        sqlite3_bind_text(tenant.stmt_check, 1, hash.c_str(), hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(tenant.stmt_check, 2, size);
+        rc = sqlite3_step(tenant.stmt_check);
+        sqlite3_reset(tenant.stmt_check);
+        if (!assert_sqlite_return_code(rc, db, "Check block"))
+            return -1;
+        if (rc == SQLITE_DONE)
+        {
+            sqlite3_bind_text(tenant.stmt_insert, 1, hash.c_str(), hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(tenant.stmt_insert, 2, size);
+            rc = sqlite3_step(tenant.stmt_insert);
+            sqlite3_reset(tenant.stmt_insert);
+            if (!assert_sqlite_return_code(rc, db, "Insert block"))
+                return -1;
+        }
+        if (!assert_sqlite_return_code(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr), db, "Commit insert"))
+            return -1;
+    }
+    else
+    {
+        sqlite3_bind_int64(tenant.stmt_join, 1, 1 + tenant.rng() % tenant.num_blocksets);
+        while ((rc = sqlite3_step(tenant.stmt_join)) == SQLITE_ROW)
+            ;
+        sqlite3_reset(tenant.stmt_join);
+        if (!assert_sqlite_return_code(rc, db, "Join blockset"))
+            return -1;
+    }
+    return 0;
+}
+
+// Pool thread: claims TASK_OPS operations at a time from the shared budget, and runs them on the next tenant in round robin order.
+void run_worker(std::vector<Tenant> &tenants, uint64_t num_tenants, uint64_t total_ops, std::atomic<uint64_t> &claimed, std::atomic<uint64_t> &next_tenant, int &return_code)
+{
+    return_code = 0;
+    while (true)
+    {
+        uint64_t start = claimed.fetch_add(TASK_OPS);
+        if (start >= total_ops)
+            break;
+        uint64_t ops = std::min(TASK_OPS, total_ops - start);
+        Tenant &tenant = tenants[next_tenant.fetch_add(1) % num_tenants];
+
+        std::lock_guard<std::mutex> lock(tenant.mutex);
+        for (uint64_t i = 0; i < ops; i++)
+        {
+            auto begin = std::chrono::high_resolution_clock::now();
+            if (run_operation(tenant) != 0)
+            {
+                return_code = -1;
+                return;
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+            tenant.latencies.push_back(elapsed);
+            tenant.busy_ns += elapsed;
+            tenant.ops++;
+        }
+    }
+}
+
+int run_pool(std::vector<Tenant> &tenants, uint64_t num_tenants, uint64_t total_ops, uint64_t num_threads)
+{
+    std::atomic<uint64_t> claimed = 0, next_tenant = 0;
+    std::vector<std::thread> threads;
+    std::vector<int> return_codes(num_threads);
+    for (uint64_t i = 0; i < num_threads; i++)
+        threads.emplace_back(run_worker, std::ref(tenants), num_tenants, total_ops, std::ref(claimed), std::ref(next_tenant), std::ref(return_codes[i]));
+    for (auto &thread : threads)
+        thread.join();
+    for (auto return_code : return_codes)
+        if (return_code != 0)
+            return -1;
+    return 0;
+}
+
+// Jain's fairness index, 1 when all values are equal, and 1/n when one tenant gets everything
+double jain_index(const std::vector<double> &values)
+{
+    double sum = 0, sum_squares = 0;
+    for (double value : values)
+    {
+        sum += value;
+        sum_squares += value * value;
+    }
+    return sum_squares > 0 ? sum * sum / (values.size() * sum_squares) : 1;
+}
+
+// Resident set size of the process, or 0 where it is not available
+uint64_t resident_bytes()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+// Open file descriptors of the process, or -1 where they cannot be listed
+int64_t open_descriptors()
+{
+#ifdef __linux__
+    std::error_code ec;
+    int64_t count = 0;
+    for (auto it = std::filesystem::directory_iterator("/proc/self/fd", ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+        count++;
+    return ec ? -1 : count - 1; // Minus the descriptor of the listing itself
+#else
+    return -1;
+#endif
+}
+
+int measure(std::vector<Tenant> &tenants, uint64_t num_tenants, Config &config, const std::vector<std::string> &pragmas)
+{
+    // Restore the tenants from their backups, so every tenant count starts from the same databases
+    for (uint64_t t = 0; t < num_tenants; t++)
+    {
+        std::filesystem::remove(tenants[t].path + "-shm");
+        std::filesystem::remove(tenants[t].path + "-wal");
+        std::filesystem::copy_file(tenants[t].path + ".backup", tenants[t].path, std::filesystem::copy_options::overwrite_existing);
+    }
+
+    uint64_t fds_before = open_descriptors(), resident_before = resident_bytes();
+    sqlite3_memory_highwater(1);
+    for (uint64_t t = 0; t < num_tenants; t++)
+    {
+        tenants[t].rng.seed(2025'07'08 + t);
+        if (!open_tenant(tenants[t], pragmas))
+            return -1;
+    }
+
+    if (run_pool(tenants, num_tenants, config.num_warmup, config.num_threads) != 0)
+        return -1;
+    for (uint64_t t = 0; t < num_tenants; t++)
+    {
+        tenants[t].ops = 0;
+        tenants[t].busy_ns = 0;
+        tenants[t].latencies.clear();
+    }
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    if (run_pool(tenants, num_tenants, config.num_repetitions, config.num_threads) != 0)
+        return -1;
+    auto end = std::chrono::high_resolution_clock::now();
+    int64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+
+    // Measured with every connection still open, as their page caches are what adds up across tenants
+    uint64_t memory_used = sqlite3_memory_used(), memory_highwater = sqlite3_memory_highwater(0);
+    int64_t fds = open_descriptors() - fds_before;
+    uint64_t resident = resident_bytes() - std::min(resident_before, resident_bytes());
+    for (uint64_t t = 0; t < num_tenants; t++)
+        close_tenant(tenants[t]);
+
+    std::vector<uint64_t> latencies;
+    std::vector<double> tenant_ops, tenant_rates;
+    uint64_t tenant_entries = 0;
+    for (uint64_t t = 0; t < num_tenants; t++)
+    {
+        latencies.insert(latencies.end(), tenants[t].latencies.begin(), tenants[t].latencies.end());
+        tenant_ops.push_back(tenants[t].ops);
+        tenant_rates.push_back(tenants[t].busy_ns > 0 ? 1e6 * tenants[t].ops / tenants[t].busy_ns : 0);
+        tenant_entries += tenants[t].num_entries;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double min_rate = *std::min_element(tenant_rates.begin(), tenant_rates.end()), max_rate = *std::max_element(tenant_rates.begin(), tenant_rates.end());
+
+    std::cout << "Tenants " << num_tenants << ": " << float(config.num_repetitions) / (float(time_us) / 1000) << " kop/s, "
+              << memory_used / 1024 << " KiB SQLite memory, " << fds << " file descriptors, fairness "
+              << jain_index(tenant_ops) << " (operations) " << jain_index(tenant_rates) << " (rate)" << std::endl;
+
+    if (!std::filesystem::exists("reports"))
+        std::filesystem::create_directory("reports");
+
+    bool emit_header = !std::filesystem::exists("reports/tenants.csv");
+    std::ofstream report_file("reports/tenants.csv", std::ios::app);
+    if (emit_header)
+        report_file << "num_entries,num_warmup,num_repetitions,num_threads,num_tenants,tenant_entries,time_us,kop_s,median_ns,99th_ns,memory_used_bytes,memory_highwater_bytes,resident_growth_bytes,file_descriptors,jain_ops,jain_rate,min_tenant_kop_s,max_tenant_kop_s\n";
+    report_file << config.num_entries << ","
+                << config.num_warmup << ","
+                << config.num_repetitions << ","
+                << config.num_threads << ","
+                << num_tenants << ","
+                << tenant_entries << ","
+                << time_us << ","
+                << float(config.num_repetitions) / (float(time_us) / 1000) << ","
+                << latencies[latencies.size() / 2] << ","
+                << latencies[latencies.size() * 99 / 100] << ","
+                << memory_used << ","
+                << memory_highwater << ","
+                << resident << ","
+                << fds << ","
+                << jain_index(tenant_ops) << ","
+                << jain_index(tenant_rates) << ","
+                << min_rate << ","
+                << max_rate << "\n";
+
+    emit_header = !std::filesystem::exists("reports/tenants_per_tenant.csv");
+    std::ofstream tenant_file("reports/tenants_per_tenant.csv", std::ios::app);
+    if (emit_header)
+        tenant_file << "num_entries,num_threads,num_tenants,tenant,tenant_entries,ops,busy_us,kop_s,median_ns,99th_ns\n";
+    for (uint64_t t = 0; t < num_tenants; t++)
+    {
+        auto &tenant_latencies = tenants[t].latencies;
+        std::sort(tenant_latencies.begin(), tenant_latencies.end());
+        tenant_file << config.num_entries << ","
+                    << config.num_threads << ","
+                    << num_tenants << ","
+                    << t << ","
+                    << tenants[t].num_entries << ","
+                    << tenants[t].ops << ","
+                    << tenants[t].busy_ns / 1000 << ","
+                    << tenant_rates[t] << ","
+                    << (tenant_latencies.empty() ? 0 : tenant_latencies[tenant_latencies.size() / 2]) << ","
+                    << (tenant_latencies.empty() ? 0 : tenant_latencies[tenant_latencies.size() * 99 / 100]) << "\n";
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    // The tenants are not created through setup_database, so the emulated disk is installed here
+    if (!slow_vfs::install())
+        return -1;
+
+    std::vector<std::string> pragmas = {"PRAGMA journal_mode = WAL;", "PRAGMA synchronous = NORMAL;", "PRAGMA busy_timeout = 1000;"};
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE,
+        "CREATE INDEX BlockHashSize ON Block(Hash, Size);",
+        "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);"};
+
+    // The largest tenant count is created once, and the smaller counts use the first tenants
+    uint64_t max_tenants = TENANT_COUNTS.back();
+    std::vector<Tenant> tenants(max_tenants);
+    std::mt19937 rng(2025'07'08);
+    std::lognormal_distribution<double> size_distribution(std::log((double)config.num_entries), TENANT_SIZE_SIGMA);
+    uint64_t total_entries = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t t = 0; t < max_tenants; t++)
+    {
+        Tenant &tenant = tenants[t];
+        tenant.path = tenant_path(t);
+        tenant.num_entries = std::clamp<uint64_t>(size_distribution(rng), MIN_TENANT_ENTRIES, 10 * config.num_entries);
+        for (const auto &f : {tenant.path, tenant.path + "-wal", tenant.path + "-shm", tenant.path + ".backup"})
+            std::remove(f.c_str());
+
+        sqlite3 *db;
+        sqlite3_open(tenant.path.c_str(), &db);
+        for (const auto &query : table_queries)
+        {
+            if (!assert_sqlite_return_code(sqlite3_exec(db, query.c_str(), nullptr, nullptr, nullptr), db, "Create tenant schema"))
+                return -1;
+        }
+        int64_t num_blocksets = fill(db, rng, tenant.num_entries);
+        if (num_blocksets < 0)
+            return -1;
+        tenant.num_blocksets = num_blocksets;
+        sqlite3_close(db);
+        std::filesystem::copy(tenant.path, tenant.path + ".backup", std::filesystem::copy_options::overwrite_existing);
+        total_entries += tenant.num_entries;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Created " << max_tenants << " tenants with " << total_entries << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms." << std::endl;
+
+    for (auto num_tenants : TENANT_COUNTS)
+    {
+        if (measure(tenants, num_tenants, config, pragmas) != 0)
+        {
+            std::cerr << "Error with " << num_tenants << " tenants" << std::endl;
+            return -1;
+        }
+    }
+
+    for (uint64_t t = 0; t < max_tenants; t++)
+    {
+        for (const auto &f : {tenants[t].path, tenants[t].path + "-shm", tenants[t].path + "-wal", tenants[t].path + ".backup"})
+        {
+            if (std::filesystem::exists(f))
+                std::filesystem::remove(f);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,677 @@
+#ifndef URING_VFS_HPP
+#define URING_VFS_HPP
+
+#include "shared.hpp"
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// VFS wrapping the default one, which moves the reads, writes and syncs of the main database and WAL files to io_uring. Writes are copied
+// into registered buffers and queued on the submission ring, and are submitted when the buffers run out, when this connection reads the
+// file (a read, the file size, mmap), at xSync, where the fsync is chained behind them, and before other connections can see the changes.
+// The latter is when the wal-index is updated or a shared memory or file lock changes, at which point the queues of the main database and
+// of its WAL are both flushed, as a commit with synchronous = NORMAL does not sync the WAL. Locking, shared memory, truncation and file
+// controls are still handled by the wrapped VFS. The "uring_direct" variant opens the main database file with O_DIRECT.
+//
+// The wrapper needs its own descriptors, and closing any descriptor of a file drops every POSIX lock the process holds on it, including
+// those of other connections. Like the inode table of the unix VFS, the descriptors are therefore shared per inode, and only closed when
+// the last file of this VFS on that inode is closed. Connections on other VFSes must still not have the same file open at that time.
+namespace uring_vfs
+{
+    const unsigned QUEUE_DEPTH = 64;       // Number of writes that can be queued before they are flushed, the ring has room for twice that
+    const size_t BUFFER_SIZE = 64 * 1024;  // One registered buffer per queued write, fits the largest page size
+    const size_t DIRECT_ALIGNMENT = 4096;  // Offset, length and buffer alignment used for O_DIRECT
+    const uint64_t FSYNC_USER_DATA = ~0ULL; // The other entries carry their expected length as user data
+
+    struct Ring
+    {
+        int fd = -1;
+        unsigned entries = 0;
+        unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+        unsigned *cq_head, *cq_tail, *cq_mask;
+        io_uring_sqe *sqes = nullptr;
+        io_uring_cqe *cqes;
+        void *sq_ptr = MAP_FAILED, *cq_ptr = MAP_FAILED;
+        size_t sq_size = 0, cq_size = 0;
+        unsigned queued = 0; // Entries written to the submission ring, but not submitted yet
+
+        bool setup(unsigned depth)
+        {
+            io_uring_params params = {};
+            fd = syscall(__NR_io_uring_setup, depth, &params);
+            if (fd < 0)
+                return false;
+            entries = params.sq_entries;
+
+            sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap)
+                sq_size = cq_size = std::max(sq_size, cq_size);
+            sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sq_ptr == MAP_FAILED)
+                return false;
+            cq_ptr = single_mmap ? sq_ptr : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED)
+                return false;
+            void *sqes_ptr = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqes_ptr == MAP_FAILED)
+                return false;
+
+            sq_head = (unsigned *)((char *)sq_ptr + params.sq_off.head);
+            sq_tail = (unsigned *)((char *)sq_ptr + params.sq_off.tail);
+            sq_mask = (unsigned *)((char *)sq_ptr + params.sq_off.ring_mask);
+            sq_array = (unsigned *)((char *)sq_ptr + params.sq_off.array);
+            sqes = (io_uring_sqe *)sqes_ptr;
+            cq_head = (unsigned *)((char *)cq_ptr + params.cq_off.head);
+            cq_tail = (unsigned *)((char *)cq_ptr + params.cq_off.tail);
+            cq_mask = (unsigned *)((char *)cq_ptr + params.cq_off.ring_mask);
+            cqes = (io_uring_cqe *)((char *)cq_ptr + params.cq_off.cqes);
+            return true;
+        }
+
+        void teardown()
+        {
+            if (sqes != nullptr)
+                munmap(sqes, entries * sizeof(io_uring_sqe));
+            if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+                munmap(cq_ptr, cq_size);
+            if (sq_ptr != MAP_FAILED)
+                munmap(sq_ptr, sq_size);
+            if (fd >= 0)
+                close(fd);
+            fd = -1;
+            sqes = nullptr;
+            sq_ptr = cq_ptr = MAP_FAILED;
+        }
+
+        // Returns a cleared submission entry, which is queued once the function returns. The callers never queue more than the ring holds.
+        io_uring_sqe *next_sqe()
+        {
+            unsigned tail = *sq_tail;
+            unsigned index = tail & *sq_mask;
+            io_uring_sqe *sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sq_array[index] = index;
+            __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+            queued++;
+            return sqe;
+        }
+
+        // Submits everything queued and waits for all of it to complete. Returns false if any entry failed or was short, and for a
+        // single entry, its result is stored in last_result.
+        bool submit_and_wait(int64_t &last_result)
+        {
+            unsigned to_submit = queued, pending = queued;
+            queued = 0;
+            last_result = -1;
+            bool ok = true;
+            while (pending > 0)
+            {
+                int submitted = syscall(__NR_io_uring_enter, fd, to_submit, pending, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (submitted < 0 && errno != EINTR)
+                    return false;
+                if (submitted > 0)
+                    to_submit -= submitted;
+
+                unsigned head = *cq_head;
+                unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                for (; head != tail; head++, pending--)
+                {
+                    io_uring_cqe *cqe = &cqes[head & *cq_mask];
+                    last_result = cqe->res;
+                    if (cqe->res < 0 || (cqe->user_data != FSYNC_USER_DATA && (uint64_t)cqe->res != cqe->user_data))
+                        ok = false;
+                }
+                __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            }
+            return ok;
+        }
+    };
+
+    // Descriptors opened on one inode, by open flags, shared by all files of this VFS on it
+    struct Inode
+    {
+        dev_t dev;
+        ino_t ino;
+        unsigned refs = 0;
+        std::vector<std::pair<int, int>> fds;
+    };
+
+    struct PendingWrite
+    {
+        sqlite3_int64 offset;
+        int amount;
+    };
+
+    struct File
+    {
+        sqlite3_file base; // Must be first, SQLite only knows this part
+        sqlite3_file *real; // File of the wrapped VFS, stored right after this struct
+        int fd = -1;          // Descriptor for the ring, O_DIRECT for the main database in direct mode
+        int buffered_fd = -1; // Descriptor for the writes O_DIRECT cannot take, same as fd outside direct mode
+        Inode *inode = nullptr; // Owner of the descriptors
+        File *main = nullptr;   // For a WAL, the main database file of the same connection
+        File *wal = nullptr;    // For a main database, its open WAL
+        int publish_rc = SQLITE_OK; // Failure of a flush from xShmBarrier, which cannot report it, returned by the next xShmLock
+        bool direct = false;
+        bool registered = false;
+        Ring ring;
+        char *buffers = (char *)MAP_FAILED;
+        char *bounce = nullptr;
+        PendingWrite pending[QUEUE_DEPTH];
+        unsigned num_pending = 0;
+    };
+
+    std::mutex inodes_mutex;
+    std::list<Inode> inodes; // Few files are open at a time, and the list keeps the entries in place
+
+    // Finds or opens a descriptor with the given flags, or returns -1. Expects inodes_mutex to be held.
+    int inode_fd(Inode &inode, const char *name, int open_flags)
+    {
+        for (auto &[flags, fd] : inode.fds)
+        {
+            if (flags == open_flags)
+                return fd;
+        }
+        int fd = open(name, open_flags);
+        if (fd >= 0)
+            inode.fds.emplace_back(open_flags, fd);
+        return fd;
+    }
+
+    // Closes the descriptors of an inode once no file uses it anymore. Expects inodes_mutex to be held.
+    void release_inode(Inode *inode)
+    {
+        if (inode->refs > 0)
+            return;
+        for (auto &[flags, fd] : inode->fds)
+            close(fd);
+        inodes.remove_if([inode](const Inode &other)
+                         { return &other == inode; });
+    }
+
+    struct Settings
+    {
+        sqlite3_vfs *wrapped;
+        bool direct;
+    };
+
+    File *as_file(sqlite3_file *file) { return (File *)file; }
+
+    bool aligned(sqlite3_int64 value) { return value % DIRECT_ALIGNMENT == 0; }
+
+    // Submits the queued writes and waits for them to land
+    int flush(File *f)
+    {
+        if (f->num_pending == 0)
+            return SQLITE_OK;
+        f->num_pending = 0;
+        int64_t result;
+        return f->ring.submit_and_wait(result) ? SQLITE_OK : SQLITE_IOERR_WRITE;
+    }
+
+    // Flushes the main database and WAL queues of a connection, before its changes become visible to others
+    int publish(File *f)
+    {
+        int rc = flush(f);
+        if (f->wal != nullptr && flush(f->wal) != SQLITE_OK)
+            rc = SQLITE_IOERR_WRITE;
+        return rc;
+    }
+
+    int write_through(int fd, const void *buffer, int amount, sqlite3_int64 offset)
+    {
+        while (amount > 0)
+        {
+            ssize_t written = pwrite(fd, buffer, amount, offset);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return SQLITE_IOERR_WRITE;
+            buffer = (const char *)buffer + written;
+            amount -= written;
+            offset += written;
+        }
+        return SQLITE_OK;
+    }
+
+    // Releases the ring, descriptors and buffers, after which the file is only served by the wrapped VFS
+    void detach_ring(File *f)
+    {
+        f->ring.teardown();
+        if (f->buffers != MAP_FAILED)
+            munmap(f->buffers, QUEUE_DEPTH * BUFFER_SIZE);
+        f->buffers = (char *)MAP_FAILED;
+        std::free(f->bounce);
+        f->bounce = nullptr;
+        if (f->inode != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(inodes_mutex);
+            f->inode->refs--;
+            release_inode(f->inode);
+            f->inode = nullptr;
+        }
+        f->fd = f->buffered_fd = -1;
+        f->direct = false;
+    }
+
+    int x_close(sqlite3_file *file)
+    {
+        File *f = as_file(file);
+        flush(f);
+        if (f->main != nullptr)
+            f->main->wal = nullptr;
+        if (f->wal != nullptr)
+            f->wal->main = nullptr;
+        int rc = f->real->pMethods->xClose(f->real);
+        detach_ring(f);
+        f->~File();
+        return rc;
+    }
+
+    int x_read(sqlite3_file *file, void *buffer, int amount, sqlite3_int64 offset)
+    {
+        File *f = as_file(file);
+        if (f->fd < 0)
+            return f->real->pMethods->xRead(f->real, buffer, amount, offset);
+        if (flush(f) != SQLITE_OK)
+            return SQLITE_IOERR_READ;
+
+        // O_DIRECT reads go through an aligned bounce buffer covering the requested range
+        sqlite3_int64 read_offset = offset;
+        size_t read_length = amount;
+        char *target = (char *)buffer;
+        if (f->direct)
+        {
+            read_offset = offset & ~(sqlite3_int64)(DIRECT_ALIGNMENT - 1);
+            read_length = ((offset + amount + DIRECT_ALIGNMENT - 1) & ~(sqlite3_int64)(DIRECT_ALIGNMENT - 1)) - read_offset;
+            if (read_length > BUFFER_SIZE + DIRECT_ALIGNMENT)
+                return f->real->pMethods->xRead(f->real, buffer, amount, offset);
+            target = f->bounce;
+        }
+
+        io_uring_sqe *sqe = f->ring.next_sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = f->fd;
+        sqe->addr = (uint64_t)target;
+        sqe->len = read_length;
+        sqe->off = read_offset;
+        sqe->user_data = read_length;
+        int64_t result;
+        f->ring.submit_and_wait(result); // A short read at the end of the file is reported as a failure, and handled below
+        if (result < 0)
+            return SQLITE_IOERR_READ;
+
+        int available = std::max<int64_t>(0, std::min<int64_t>(amount, result - (offset - read_offset)));
+        if (f->direct)
+            std::memcpy(buffer, f->bounce + (offset - read_offset), available);
+        if (available < amount)
+        {
+            // SQLite requires the missing part of a short read to be zeroed
+            std::memset((char *)buffer + available, 0, amount - available);
+            return SQLITE_IOERR_SHORT_READ;
+        }
+        return SQLITE_OK;
+    }
+
+    int x_write(sqlite3_file *file, const void *buffer, int amount, sqlite3_int64 offset)
+    {
+        File *f = as_file(file);
+        if (f->fd < 0)
+            return f->real->pMethods->xWrite(f->real, buffer, amount, offset);
+
+        // Oversized writes, and unaligned writes in direct mode, are written synchronously
+        if ((size_t)amount > BUFFER_SIZE || (f->direct && !(aligned(offset) && aligned(amount))))
+        {
+            if (flush(f) != SQLITE_OK)
+                return SQLITE_IOERR_WRITE;
+            return write_through(f->buffered_fd, buffer, amount, offset);
+        }
+
+        // Queued writes may complete in any order, so a write overlapping a queued one waits for the queue first
+        bool overlaps = false;
+        for (unsigned i = 0; i < f->num_pending && !overlaps; i++)
+            overlaps = offset < f->pending[i].offset + f->pending[i].amount && f->pending[i].offset < offset + amount;
+        if ((overlaps || f->num_pending == QUEUE_DEPTH) && flush(f) != SQLITE_OK)
+            return SQLITE_IOERR_WRITE;
+
+        unsigned slot = f->num_pending++;
+        f->pending[slot] = {offset, amount};
+        char *staging = f->buffers + slot * BUFFER_SIZE;
+        std::memcpy(staging, buffer, amount);
+
+        io_uring_sqe *sqe = f->ring.next_sqe();
+        sqe->opcode = f->registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = f->fd;
+        sqe->addr = (uint64_t)staging;
+        sqe->len = amount;
+        sqe->off = offset;
+        sqe->buf_index = slot;
+        sqe->user_data = amount;
+        return SQLITE_OK;
+    }
+
+    int x_truncate(sqlite3_file *file, sqlite3_int64 size)
+    {
+        File *f = as_file(file);
+        if (flush(f) != SQLITE_OK)
+            return SQLITE_IOERR_TRUNCATE;
+        return f->real->pMethods->xTruncate(f->real, size);
+    }
+
+    int x_sync(sqlite3_file *file, int flags)
+    {
+        File *f = as_file(file);
+        if (f->fd < 0)
+            return f->real->pMethods->xSync(f->real, flags);
+
+        // The fsync is drained behind the queued writes, so the whole commit is a single submission
+        io_uring_sqe *sqe = f->ring.next_sqe();
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = f->fd;
+        sqe->flags = IOSQE_IO_DRAIN;
+        sqe->fsync_flags = flags & SQLITE_SYNC_DATAONLY ? IORING_FSYNC_DATASYNC : 0;
+        sqe->user_data = FSYNC_USER_DATA;
+        f->num_pending = 0;
+        int64_t result;
+        return f->ring.submit_and_wait(result) ? SQLITE_OK : SQLITE_IOERR_FSYNC;
+    }
+
+    int x_file_size(sqlite3_file *file, sqlite3_int64 *size)
+    {
+        File *f = as_file(file);
+        if (flush(f) != SQLITE_OK)
+            return SQLITE_IOERR_FSTAT;
+        return f->real->pMethods->xFileSize(f->real, size);
+    }
+
+    int x_lock(sqlite3_file *file, int lock) { return as_file(file)->real->pMethods->xLock(as_file(file)->real, lock); }
+    int x_check_reserved_lock(sqlite3_file *file, int *out) { return as_file(file)->real->pMethods->xCheckReservedLock(as_file(file)->real, out); }
+
+    // Locks are released even if the flush failed, so that the error does not leave them held
+    int x_unlock(sqlite3_file *file, int lock)
+    {
+        File *f = as_file(file);
+        int rc = publish(f);
+        int unlock_rc = f->real->pMethods->xUnlock(f->real, lock);
+        return rc != SQLITE_OK ? SQLITE_IOERR_UNLOCK : unlock_rc;
+    }
+
+    int x_file_control(sqlite3_file *file, int op, void *arg)
+    {
+        File *f = as_file(file);
+        if (flush(f) != SQLITE_OK)
+            return SQLITE_IOERR;
+        return f->real->pMethods->xFileControl(f->real, op, arg);
+    }
+
+    int x_sector_size(sqlite3_file *file) { return as_file(file)->real->pMethods->xSectorSize(as_file(file)->real); }
+    int x_device_characteristics(sqlite3_file *file) { return as_file(file)->real->pMethods->xDeviceCharacteristics(as_file(file)->real); }
+    int x_shm_map(sqlite3_file *file, int page, int size, int extend, void volatile **out) { return as_file(file)->real->pMethods->xShmMap(as_file(file)->real, page, size, extend, out); }
+
+    int x_shm_lock(sqlite3_file *file, int offset, int n, int flags)
+    {
+        File *f = as_file(file);
+        int rc = publish(f);
+        if (rc == SQLITE_OK)
+            rc = f->publish_rc;
+        f->publish_rc = SQLITE_OK;
+        if (rc == SQLITE_OK || (flags & SQLITE_SHM_UNLOCK))
+        {
+            int lock_rc = f->real->pMethods->xShmLock(f->real, offset, n, flags);
+            if (rc == SQLITE_OK)
+                return lock_rc;
+        }
+        return SQLITE_IOERR_SHMLOCK;
+    }
+
+    // Runs before the wal-index header is written, which is what publishes new WAL frames to the other connections
+    void x_shm_barrier(sqlite3_file *file)
+    {
+        File *f = as_file(file);
+        if (publish(f) != SQLITE_OK)
+            f->publish_rc = SQLITE_IOERR_WRITE;
+        f->real->pMethods->xShmBarrier(f->real);
+    }
+
+    int x_shm_unmap(sqlite3_file *file, int delete_flag) { return as_file(file)->real->pMethods->xShmUnmap(as_file(file)->real, delete_flag); }
+
+    // Memory mapped reads bypass the ring, so they need the queue flushed. In direct mode they are refused, and SQLite falls back to xRead.
+    int x_fetch(sqlite3_file *file, sqlite3_int64 offset, int amount, void **out)
+    {
+        File *f = as_file(file);
+        *out = nullptr;
+        if (f->direct)
+            return SQLITE_OK;
+        if (flush(f) != SQLITE_OK)
+            return SQLITE_IOERR_READ;
+        return f->real->pMethods->xFetch(f->real, offset, amount, out);
+    }
+
+    int x_unfetch(sqlite3_file *file, sqlite3_int64 offset, void *p)
+    {
+        File *f = as_file(file);
+        if (f->direct)
+            return SQLITE_OK;
+        return f->real->pMethods->xUnfetch(f->real, offset, p);
+    }
+
+    const sqlite3_io_methods io_methods = {
+        3,
+        x_close,
+        x_read,
+        x_write,
+        x_truncate,
+        x_sync,
+        x_file_size,
+        x_lock,
+        x_unlock,
+        x_check_reserved_lock,
+        x_file_control,
+        x_sector_size,
+        x_device_characteristics,
+        x_shm_map,
+        x_shm_lock,
+        x_shm_barrier,
+        x_shm_unmap,
+        x_fetch,
+        x_unfetch};
+
+    // Sets up the ring, descriptors and buffers of a main database or WAL file. On failure, the file is left to the wrapped VFS.
+    bool attach_ring(File *f, const char *name, int flags, bool direct)
+    {
+        int mode = flags & SQLITE_OPEN_READONLY ? O_RDONLY : O_RDWR;
+        f->direct = direct && (flags & SQLITE_OPEN_MAIN_DB);
+
+        // The wrapped VFS has already created the file, so it can be found by its inode
+        struct stat st;
+        if (stat(name, &st) != 0)
+            return false;
+        {
+            std::lock_guard<std::mutex> lock(inodes_mutex);
+            auto inode = std::find_if(inodes.begin(), inodes.end(), [&st](const Inode &other)
+                                      { return other.dev == st.st_dev && other.ino == st.st_ino; });
+            if (inode == inodes.end())
+                inode = inodes.insert(inodes.end(), Inode{st.st_dev, st.st_ino});
+            f->inode = &*inode;
+            f->inode->refs++;
+            f->buffered_fd = inode_fd(*f->inode, name, mode | O_CLOEXEC);
+            f->fd = f->direct ? inode_fd(*f->inode, name, mode | O_CLOEXEC | O_DIRECT) : f->buffered_fd;
+        }
+        if (f->buffered_fd < 0 || f->fd < 0 || !f->ring.setup(2 * QUEUE_DEPTH))
+            return false;
+
+        f->buffers = (char *)mmap(nullptr, QUEUE_DEPTH * BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (f->buffers == MAP_FAILED)
+            return false;
+        iovec iovecs[QUEUE_DEPTH];
+        for (unsigned i = 0; i < QUEUE_DEPTH; i++)
+            iovecs[i] = {f->buffers + i * BUFFER_SIZE, BUFFER_SIZE};
+        // Unregistered buffers still work, they are just pinned on every write
+        f->registered = syscall(__NR_io_uring_register, f->ring.fd, IORING_REGISTER_BUFFERS, iovecs, QUEUE_DEPTH) == 0;
+
+        if (f->direct)
+        {
+            f->bounce = (char *)std::aligned_alloc(DIRECT_ALIGNMENT, BUFFER_SIZE + 2 * DIRECT_ALIGNMENT);
+            if (f->bounce == nullptr)
+                return false;
+        }
+        return true;
+    }
+
+    int x_open(sqlite3_vfs *vfs, const char *name, sqlite3_file *file, int flags, int *out_flags)
+    {
+        auto settings = (Settings *)vfs->pAppData;
+        File *f = new (file) File();
+        f->real = (sqlite3_file *)(f + 1);
+        int rc = settings->wrapped->xOpen(settings->wrapped, name, f->real, flags, out_flags);
+        if (rc != SQLITE_OK)
+        {
+            if (f->real->pMethods != nullptr)
+                f->real->pMethods->xClose(f->real);
+            f->~File();
+            file->pMethods = nullptr;
+            return rc;
+        }
+
+        if (name != nullptr && (flags & (SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_WAL)) && !attach_ring(f, name, flags, settings->direct))
+            detach_ring(f);
+        f->base.pMethods = &io_methods;
+
+        // The main database file of a connection is opened before its WAL, and with this VFS
+        if (name != nullptr && (flags & SQLITE_OPEN_WAL))
+        {
+            sqlite3_file *main = sqlite3_database_file_object(name);
+            if (main != nullptr && main->pMethods == &io_methods)
+            {
+                f->main = as_file(main);
+                f->main->wal = f;
+            }
+        }
+        return SQLITE_OK;
+    }
+
+    sqlite3_vfs *wrapped(sqlite3_vfs *vfs) { return ((Settings *)vfs->pAppData)->wrapped; }
+
+    int x_delete(sqlite3_vfs *vfs, const char *name, int sync_dir) { return wrapped(vfs)->xDelete(wrapped(vfs), name, sync_dir); }
+    int x_access(sqlite3_vfs *vfs, const char *name, int flags, int *out) { return wrapped(vfs)->xAccess(wrapped(vfs), name, flags, out); }
+    int x_full_pathname(sqlite3_vfs *vfs, const char *name, int size, char *out) { return wrapped(vfs)->xFullPathname(wrapped(vfs), name, size, out); }
+    void *x_dl_open(sqlite3_vfs *vfs, const char *name) { return wrapped(vfs)->xDlOpen(wrapped(vfs), name); }
+    void x_dl_error(sqlite3_vfs *vfs, int size, char *out) { wrapped(vfs)->xDlError(wrapped(vfs), size, out); }
+    void (*x_dl_sym(sqlite3_vfs *vfs, void *handle, const char *symbol))(void) { return wrapped(vfs)->xDlSym(wrapped(vfs), handle, symbol); }
+    void x_dl_close(sqlite3_vfs *vfs, void *handle) { wrapped(vfs)->xDlClose(wrapped(vfs), handle); }
+    int x_randomness(sqlite3_vfs *vfs, int size, char *out) { return wrapped(vfs)->xRandomness(wrapped(vfs), size, out); }
+    int x_sleep(sqlite3_vfs *vfs, int microseconds) { return wrapped(vfs)->xSleep(wrapped(vfs), microseconds); }
+    int x_current_time(sqlite3_vfs *vfs, double *out) { return wrapped(vfs)->xCurrentTime(wrapped(vfs), out); }
+    int x_get_last_error(sqlite3_vfs *vfs, int size, char *out) { return wrapped(vfs)->xGetLastError(wrapped(vfs), size, out); }
+    int x_current_time_int64(sqlite3_vfs *vfs, sqlite3_int64 *out) { return wrapped(vfs)->xCurrentTimeInt64(wrapped(vfs), out); }
+
+    Settings settings[2];
+    sqlite3_vfs vfses[2];
+}
+
+// Registers the "uring" and "uring_direct" VFSes, without making them the default. Returns false if io_uring is not available.
+bool register_uring_vfs()
+{
+    using namespace uring_vfs;
+    static bool registered = false;
+    if (registered)
+        return true;
+
+    Ring probe;
+    bool available = probe.setup(2);
+    probe.teardown();
+    sqlite3_vfs *base = sqlite3_vfs_find(nullptr);
+    if (!available || base == nullptr)
+    {
+        std::cerr << "io_uring is not available" << std::endl;
+        return false;
+    }
+
+    const char *names[2] = {"uring", "uring_direct"};
+    for (int i = 0; i < 2; i++)
+    {
+        settings[i] = {base, i == 1};
+        vfses[i] = {
+            2,
+            (int)(sizeof(File) + base->szOsFile),
+            base->mxPathname,
+            nullptr,
+            names[i],
+            &settings[i],
+            x_open,
+            x_delete,
+            x_access,
+            x_full_pathname,
+            x_dl_open,
+            x_dl_error,
+            x_dl_sym,
+            x_dl_close,
+            x_randomness,
+            x_sleep,
+            x_current_time,
+            x_get_last_error,
+            x_current_time_int64};
+        if (sqlite3_vfs_register(&vfses[i], 0) != SQLITE_OK)
+            return false;
+    }
+    registered = true;
+    return true;
+}
+
+#else
+
+// io_uring is Linux only, so the VFS is never available elsewhere
+bool register_uring_vfs()
+{
+    std::cerr << "io_uring is not available" << std::endl;
+    return false;
+}
+
+#endif
+
+// Checks that a commit of one connection is visible to another one on the same VFS, in WAL mode with synchronous = NORMAL, where the
+// WAL is not synced at commit. Uses a scratch database at the given path, which is deleted afterwards.
+bool check_vfs_visibility(const char *vfs, const std::string &path)
+{
+    auto remove_files = [&path]()
+    {
+        std::remove(path.c_str());
+        std::remove((path + "-wal").c_str());
+        std::remove((path + "-shm").c_str());
+    };
+    remove_files();
+
+    sqlite3 *writer = nullptr, *reader = nullptr;
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    bool ok = assert_sqlite_return_code(sqlite3_open_v2(path.c_str(), &writer, flags, vfs), writer, "Open visibility check writer") &&
+              assert_sqlite_return_code(sqlite3_exec(writer, "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL; CREATE TABLE t (x);", nullptr, nullptr, nullptr), writer, "Create visibility check table") &&
+              assert_sqlite_return_code(sqlite3_open_v2(path.c_str(), &reader, flags, vfs), reader, "Open visibility check reader");
+
+    for (int expected = 1; ok && expected <= 2; expected++)
+    {
+        sqlite3_stmt *count = nullptr;
+        ok = assert_sqlite_return_code(sqlite3_exec(writer, "INSERT INTO t VALUES (1);", nullptr, nullptr, nullptr), writer, "Insert visibility check row") &&
+             assert_sqlite_return_code(sqlite3_prepare_v2(reader, "SELECT count(*) FROM t;", -1, &count, nullptr), reader, "Prepare visibility check count") &&
+             assert_value_matches(SQLITE_ROW, sqlite3_step(count), "Visibility check count step") &&
+             assert_value_matches(expected, sqlite3_column_int(count, 0), std::string("Rows seen by a second connection on ") + vfs);
+        if (!ok && count != nullptr)
+            std::cerr << "SQLite error in visibility check: " << sqlite3_errmsg(reader) << std::endl;
+        sqlite3_finalize(count);
+    }
+
+    sqlite3_close(reader);
+    sqlite3_close(writer);
+    remove_files();
+    return ok;
+}
+
+#endif
@@ -0,0 +1,758 @@
+#include "shared.hpp"
+
+#include <string_view>
+#include <unordered_map>
+
+const std::string CREATE_BLOCK_TABLE = "CREATE TABLE Block (ID INTEGER PRIMARY KEY, Hash TEXT NOT NULL, Size INTEGER NOT NULL);";
+
+struct Entry
+{
+    uint64_t id;
+    std::string hash;
+    uint64_t size;
+    uint64_t blockset_id;
+};
+
+// In-process hash index mapping (Hash, Size) to ID, exposed to SQL through the hashindex virtual table module.
+struct BlockKey
+{
+    std::string hash;
+    uint64_t size;
+};
+
+struct BlockKeyView
+{
+    std::string_view hash;
+    uint64_t size;
+};
+
+struct BlockKeyHasher
+{
+    using is_transparent = void;
+    size_t operator()(const BlockKeyView &key) const { return std::hash<std::string_view>()(key.hash) ^ (key.size * 0x9E3779B97F4A7C15ULL); }
+    size_t operator()(const BlockKey &key) const { return (*this)(BlockKeyView{key.hash, key.size}); }
+};
+
+struct BlockKeyEqual
+{
+    using is_transparent = void;
+    bool operator()(const BlockKeyView &a, const BlockKeyView &b) const { return a.size == b.size && a.hash == b.hash; }
+    bool operator()(const BlockKey &a, const BlockKeyView &b) const { return (*this)(BlockKeyView{a.hash, a.size}, b); }
+    bool operator()(const BlockKeyView &a, const BlockKey &b) const { return (*this)(a, BlockKeyView{b.hash, b.size}); }
+    bool operator()(const BlockKey &a, const BlockKey &b) const { return (*this)(BlockKeyView{a.hash, a.size}, BlockKeyView{b.hash, b.size}); }
+};
+
+struct UndoRecord
+{
+    bool inserted; // true if the record undoes an insert, false if it undoes a delete
+    uint64_t id;
+    BlockKey key;
+};
+
+struct HashIndex
+{
+    std::unordered_map<BlockKey, uint64_t, BlockKeyHasher, BlockKeyEqual> ids;
+    std::unordered_map<uint64_t, BlockKey> keys;
+    std::vector<UndoRecord> undo; // Changes made in the open transaction, replayed backwards on rollback
+
+    bool insert(uint64_t id, const BlockKey &key, bool log = true)
+    {
+        if (keys.contains(id) || ids.contains(key))
+            return false;
+        ids.emplace(key, id);
+        keys.emplace(id, key);
+        if (log)
+            undo.push_back({true, id, key});
+        return true;
+    }
+
+    bool erase(uint64_t id, bool log = true)
+    {
+        auto it = keys.find(id);
+        if (it == keys.end())
+            return false;
+        if (log)
+            undo.push_back({false, id, it->second});
+        ids.erase(it->second);
+        keys.erase(it);
+        return true;
+    }
+};
+
+struct HashIndexTable
+{
+    sqlite3_vtab base;
+    HashIndex *index;
+};
+
+struct HashIndexCursor
+{
+    sqlite3_vtab_cursor base;
+    int mode; // 0 = full scan, 1 = (Hash, Size) lookup, 2 = ID lookup
+    bool eof;
+    uint64_t id;
+    const BlockKey *key;
+    std::unordered_map<uint64_t, BlockKey>::const_iterator it;
+};
+
+int hashindex_connect(sqlite3 *db, void *aux, int argc, const char *const *argv, sqlite3_vtab **vtab, char **err)
+{
+    int rc = sqlite3_declare_vtab(db, "CREATE TABLE x(Hash TEXT, Size INTEGER, ID INTEGER);");
+    if (rc != SQLITE_OK)
+        return rc;
+    auto table = new HashIndexTable();
+    table->index = (HashIndex *)aux;
+    *vtab = &table->base;
+    return SQLITE_OK;
+}
+
+int hashindex_disconnect(sqlite3_vtab *vtab)
+{
+    delete (HashIndexTable *)vtab;
+    return SQLITE_OK;
+}
+
+int hashindex_best_index(sqlite3_vtab *vtab, sqlite3_index_info *info)
+{
+    auto table = (HashIndexTable *)vtab;
+    int hash_constraint = -1, size_constraint = -1, id_constraint = -1;
+    for (int i = 0; i < info->nConstraint; i++)
+    {
+        const auto &constraint = info->aConstraint[i];
+        if (!constraint.usable || constraint.op != SQLITE_INDEX_CONSTRAINT_EQ)
+            continue;
+        if (constraint.iColumn == 0)
+            hash_constraint = i;
+        else if (constraint.iColumn == 1)
+            size_constraint = i;
+        else if (constraint.iColumn == 2 || constraint.iColumn == -1)
+            id_constraint = i;
+    }
+
+    if (hash_constraint >= 0 && size_constraint >= 0)
+    {
+        info->idxNum = 1;
+        info->aConstraintUsage[hash_constraint].argvIndex = 1;
+        info->aConstraintUsage[hash_constraint].omit = 1;
+        info->aConstraintUsage[size_constraint].argvIndex = 2;
+        info->aConstraintUsage[size_constraint].omit = 1;
+        info->estimatedCost = 1;
+        info->estimatedRows = 1;
+        info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+    }
+    else if (id_constraint >= 0)
+    {
+        info->idxNum = 2;
+        info->aConstraintUsage[id_constraint].argvIndex = 1;
+        info->aConstraintUsage[id_constraint].omit = 1;
+        info->estimatedCost = 1;
+        info->estimatedRows = 1;
+        info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+    }
+    else
+    {
+        info->idxNum = 0;
+        info->estimatedCost = (double)table->index->keys.size() + 1;
+        info->estimatedRows = table->index->keys.size();
+    }
+
+    return SQLITE_OK;
+}
+
+int hashindex_open(sqlite3_vtab *vtab, sqlite3_vtab_cursor **cursor)
+{
+    auto c = new HashIndexCursor();
+    c->eof = true;
+    *cursor = &c->base;
+    return SQLITE_OK;
+}
+
+int hashindex_close(sqlite3_vtab_cursor *cursor)
+{
+    delete (HashIndexCursor *)cursor;
+    return SQLITE_OK;
+}
+
+int hashindex_filter(sqlite3_vtab_cursor *cursor, int idx_num, const char *idx_str, int argc, sqlite3_value **argv)
+{
+    auto c = (HashIndexCursor *)cursor;
+    auto index = ((HashIndexTable *)cursor->pVtab)->index;
+    c->mode = idx_num;
+    c->eof = true;
+
+    if (idx_num == 1)
+    {
+        auto hash = (const char *)sqlite3_value_text(argv[0]);
+        if (hash == nullptr)
+            return SQLITE_OK;
+        BlockKeyView key{std::string_view(hash, sqlite3_value_bytes(argv[0])), (uint64_t)sqlite3_value_int64(argv[1])};
+        auto it = index->ids.find(key);
+        if (it != index->ids.end())
+        {
+            c->id = it->second;
+            c->key = &it->first;
+            c->eof = false;
+        }
+    }
+    else if (idx_num == 2)
+    {
+        auto it = index->keys.find(sqlite3_value_int64(argv[0]));
+        if (it != index->keys.end())
+        {
+            c->id = it->first;
+            c->key = &it->second;
+            c->eof = false;
+        }
+    }
+    else
+    {
+        c->it = index->keys.cbegin();
+        c->eof = c->it == index->keys.cend();
+    }
+
+    return SQLITE_OK;
+}
+
+int hashindex_next(sqlite3_vtab_cursor *cursor)
+{
+    auto c = (HashIndexCursor *)cursor;
+    if (c->mode == 0)
+        c->eof = ++c->it == ((HashIndexTable *)cursor->pVtab)->index->keys.cend();
+    else
+        c->eof = true;
+    return SQLITE_OK;
+}
+
+int hashindex_eof(sqlite3_vtab_cursor *cursor)
+{
+    return ((HashIndexCursor *)cursor)->eof;
+}
+
+int hashindex_column(sqlite3_vtab_cursor *cursor, sqlite3_context *ctx, int column)
+{
+    auto c = (HashIndexCursor *)cursor;
+    uint64_t id = c->mode == 0 ? c->it->first : c->id;
+    const BlockKey &key = c->mode == 0 ? c->it->second : *c->key;
+    if (column == 0)
+        sqlite3_result_text(ctx, key.hash.data(), key.hash.size(), SQLITE_TRANSIENT);
+    else if (column == 1)
+        sqlite3_result_int64(ctx, key.size);
+    else
+        sqlite3_result_int64(ctx, id);
+    return SQLITE_OK;
+}
+
+int hashindex_rowid(sqlite3_vtab_cursor *cursor, sqlite3_int64 *rowid)
+{
+    auto c = (HashIndexCursor *)cursor;
+    *rowid = c->mode == 0 ? c->it->first : c->id;
+    return SQLITE_OK;
+}
+
+// argv[0] is the old rowid (NULL on insert), argv[1] the new rowid, and argv[2..4] are Hash, Size and ID.
+int hashindex_update(sqlite3_vtab *vtab, int argc, sqlite3_value **argv, sqlite3_int64 *rowid)
+{
+    auto index = ((HashIndexTable *)vtab)->index;
+
+    if (sqlite3_value_type(argv[0]) != SQLITE_NULL)
+        index->erase(sqlite3_value_int64(argv[0]));
+    if (argc == 1)
+        return SQLITE_OK;
+
+    sqlite3_value *id_value = sqlite3_value_type(argv[4]) != SQLITE_NULL ? argv[4] : argv[1];
+    auto hash = (const char *)sqlite3_value_text(argv[2]);
+    if (sqlite3_value_type(id_value) == SQLITE_NULL || hash == nullptr)
+        return SQLITE_CONSTRAINT_NOTNULL;
+    uint64_t id = sqlite3_value_int64(id_value);
+    if (!index->insert(id, {std::string(hash, sqlite3_value_bytes(argv[2])), (uint64_t)sqlite3_value_int64(argv[3])}))
+        return SQLITE_CONSTRAINT_UNIQUE;
+    *rowid = id;
+
+    return SQLITE_OK;
+}
+
+int hashindex_begin(sqlite3_vtab *vtab)
+{
+    ((HashIndexTable *)vtab)->index->undo.clear();
+    return SQLITE_OK;
+}
+
+int hashindex_sync(sqlite3_vtab *vtab)
+{
+    return SQLITE_OK;
+}
+
+int hashindex_commit(sqlite3_vtab *vtab)
+{
+    ((HashIndexTable *)vtab)->index->undo.clear();
+    return SQLITE_OK;
+}
+
+int hashindex_rollback(sqlite3_vtab *vtab)
+{
+    auto index = ((HashIndexTable *)vtab)->index;
+    for (auto it = index->undo.rbegin(); it != index->undo.rend(); ++it)
+    {
+        if (it->inserted)
+            index->erase(it->id, false);
+        else
+            index->insert(it->id, it->key, false);
+    }
+    index->undo.clear();
+    return SQLITE_OK;
+}
+
+sqlite3_module hashindex_module()
+{
+    sqlite3_module module = {};
+    module.iVersion = 1;
+    module.xCreate = hashindex_connect;
+    module.xConnect = hashindex_connect;
+    module.xBestIndex = hashindex_best_index;
+    module.xDisconnect = hashindex_disconnect;
+    module.xDestroy = hashindex_disconnect;
+    module.xOpen = hashindex_open;
+    module.xClose = hashindex_close;
+    module.xFilter = hashindex_filter;
+    module.xNext = hashindex_next;
+    module.xEof = hashindex_eof;
+    module.xColumn = hashindex_column;
+    module.xRowid = hashindex_rowid;
+    module.xUpdate = hashindex_update;
+    module.xBegin = hashindex_begin;
+    module.xSync = hashindex_sync;
+    module.xCommit = hashindex_commit;
+    module.xRollback = hashindex_rollback;
+    return module;
+}
+
+int fill(sqlite3 *db, std::mt19937 &rng, std::vector<Entry> &entries, uint64_t num_entries)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    std::string
+        sql_block = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);",
+        sql_blockset = "INSERT INTO Blockset(ID, Length) VALUES (?, ?);",
+        sql_blockset_entry = "INSERT INTO BlocksetEntry(BlocksetID, BlockID) VALUES (?, ?);";
+    sqlite3_stmt *stmt_block, *stmt_blockset, *stmt_blockset_entry;
+    sqlite3_prepare_v2(db, sql_block.c_str(), -1, &stmt_block, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset.c_str(), -1, &stmt_blockset, nullptr);
+    sqlite3_prepare_v2(db, sql_blockset_entry.c_str(), -1, &stmt_blockset_entry, nullptr);
+
+    uint64_t
+        blockset_id = 1,
+        blockset_count = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        // Block
+        Entry entry = {
+            i,
+            random_hash_string(rng, 44),
+            rng() % 1000,
+            blockset_id};
+        entries.push_back(entry);
+        sqlite3_bind_int64(stmt_block, 1, entry.id);
+        sqlite3_bind_text(stmt_block, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_block, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_block), db, "Insert entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_block);
+
+        // BlocksetEntry
+        sqlite3_bind_int64(stmt_blockset_entry, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset_entry, 2, entry.id);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset_entry), db, "Insert BlocksetEntry for entry " + std::to_string(i)))
+            return -1;
+        sqlite3_reset(stmt_blockset_entry);
+        blockset_count++;
+
+        // Blockset
+        if (rng() % 1000 > 995) // 0.5% chance to create a new Blockset
+        {
+            sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+            sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_blockset);
+            blockset_id++;
+            blockset_count = 0; // Reset count for the next Blockset
+        }
+    }
+
+    // Finish the current blockset, if it has blocksetentries.
+    if (blockset_count > 0)
+    {
+        sqlite3_bind_int64(stmt_blockset, 1, blockset_id);
+        sqlite3_bind_int64(stmt_blockset, 2, blockset_count);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt_blockset), db, "Insert Blockset for entry " + std::to_string(blockset_id)))
+            return -1;
+        sqlite3_reset(stmt_blockset);
+    }
+
+    sqlite3_finalize(stmt_block);
+    sqlite3_finalize(stmt_blockset);
+    sqlite3_finalize(stmt_blockset_entry);
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Inserted " << entries.size() << " entries in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    return 0;
+}
+
+int measure(
+    sqlite3 *db,
+    Config &config,
+    std::mt19937 &rng,
+    const std::function<int(sqlite3 *, const Entry &, uint64_t, const std::string &)> &f,
+    const std::string &report_name,
+    const int create_entry, // Percentage probability of creating a new entry
+    const std::vector<Entry> &entries)
+{
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    uint64_t next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_warmup; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[i % entries.size()]; // Reuse existing entries for warmup
+        }
+
+        if (f(db, entry, i, "Warmup") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    std::vector<uint64_t> times;
+    next_id = config.num_entries;
+    for (uint64_t i = 0; i < config.num_repetitions; i++)
+    {
+        Entry entry;
+        if ((rng() % 100) >= (100 - create_entry))
+        {
+            entry = {
+                next_id++,
+                random_hash_string(rng, 44),
+                rng() % 1000,
+                0};
+        }
+        else
+        {
+            entry = entries[rng() % entries.size()];
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        if (f(db, entry, i, "Actual") != 0)
+            return -1;
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    report_stats(config, times, report_name);
+
+    return 0;
+}
+
+int measure_insert(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &report_name)
+{
+    std::string sql = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);";
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare insert statement"))
+        return -1;
+
+    auto insert_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_int64(stmt, 1, entry.id);
+        sqlite3_bind_text(stmt, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 3, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt), db, prefix + " insert " + std::to_string(i) + " " + std::to_string(entry.id)))
+            return -1;
+        sqlite3_reset(stmt);
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, insert_inner, report_name, 100, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt);
+
+    return 0;
+}
+
+int measure_select(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &sql, const std::string &report_name)
+{
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare select statement"))
+        return -1;
+
+    auto select_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_text(stmt, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, entry.size);
+        if (!assert_sqlite_return_code(sqlite3_step(stmt), db, prefix + " query execution " + std::to_string(i)))
+            return -1;
+        if (!assert_value_matches(entry.id, (uint64_t)sqlite3_column_int64(stmt, 0), prefix + " ID check"))
+            return -1;
+        sqlite3_reset(stmt);
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, select_inner, report_name, -1, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt);
+
+    return 0;
+}
+
+// Inserts only go to Block; when the sync trigger is installed it keeps the hash index up to date.
+int measure_xor1(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &sql_select, const std::string &report_name)
+{
+    std::string sql_insert = "INSERT INTO Block(ID, Hash, Size) VALUES (?, ?, ?);";
+    sqlite3_stmt *stmt_select, *stmt_insert;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_select.c_str(), -1, &stmt_select, nullptr), db, "Prepare xor select statement"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql_insert.c_str(), -1, &stmt_insert, nullptr), db, "Prepare xor insert statement"))
+        return -1;
+
+    auto xor_inner = [=](sqlite3 *db, const Entry &entry, uint64_t i, const std::string &prefix) -> int
+    {
+        sqlite3_bind_text(stmt_select, 1, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt_select, 2, entry.size);
+        auto rc = sqlite3_step(stmt_select);
+        if (!assert_sqlite_return_code(rc, db, prefix + " xor1 query execution " + std::to_string(i)))
+            return -1;
+        auto found_id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt_select, 0) : -1;
+        sqlite3_reset(stmt_select);
+
+        if (found_id == -1)
+        {
+            // Not found, insert
+            sqlite3_bind_int64(stmt_insert, 1, entry.id);
+            sqlite3_bind_text(stmt_insert, 2, entry.hash.c_str(), entry.hash.size(), SQLITE_STATIC);
+            sqlite3_bind_int64(stmt_insert, 3, entry.size);
+            if (!assert_sqlite_return_code(sqlite3_step(stmt_insert), db, prefix + " xor1 insert " + std::to_string(i)))
+                return -1;
+            sqlite3_reset(stmt_insert);
+        }
+        else
+        {
+            if (!assert_value_matches(entry.id, (uint64_t)found_id, prefix + " xor1 ID check"))
+                return -1;
+        }
+
+        return 0;
+    };
+
+    if (measure(db, config, rng, xor_inner, report_name, 50, entries) != 0)
+        return -1;
+
+    sqlite3_finalize(stmt_select);
+    sqlite3_finalize(stmt_insert);
+
+    return 0;
+}
+
+uint64_t blockset_count(uint64_t blockset_id, const std::vector<Entry> &entries)
+{
+    uint64_t count = 0;
+    for (const auto &entry : entries)
+    {
+        if (entry.blockset_id == blockset_id)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+int measure_join(sqlite3 *db, Config &config, std::mt19937 &rng, const std::vector<Entry> &entries, const std::string &sql, const std::string &report_name)
+{
+    sqlite3_stmt *stmt;
+    if (!assert_sqlite_return_code(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr), db, "Prepare join statement"))
+        return -1;
+
+    uint64_t max_blockset = 0;
+    for (auto &entry : entries)
+    {
+        max_blockset = std::max(max_blockset, entry.blockset_id);
+    }
+
+    auto join_inner = [=](sqlite3 *db, uint64_t blockset_id, uint64_t expected_count, const std::string &prefix) -> int
+    {
+        sqlite3_bind_int64(stmt, 1, blockset_id);
+        uint64_t count = 0;
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            // Process the row
+            auto found_id = sqlite3_column_int64(stmt, 0);
+            auto found_hash = std::string((const char *)sqlite3_column_text(stmt, 1));
+            auto found_size = (uint64_t)sqlite3_column_int64(stmt, 2);
+            auto entry = entries[found_id];
+            if (!assert_value_matches(entry.hash, found_hash, "Hash check"))
+                return -1;
+            if (!assert_value_matches(entry.size, found_size, "Size check"))
+                return -1;
+            if (!assert_value_matches(entry.blockset_id, blockset_id, "Blockset ID check"))
+                return -1;
+            count++;
+        }
+        if (!assert_value_matches(expected_count, count, "Blockset count check"))
+            return -1;
+        sqlite3_reset(stmt);
+
+        return 0;
+    };
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    for (uint64_t i = 0; i < config.num_warmup; i++)
+    {
+        uint64_t blockset_id = (rng() % max_blockset) + 1;
+        uint64_t expected_count = blockset_count(blockset_id, entries);
+        if (join_inner(db, blockset_id, expected_count, "Warmup") != 0)
+            return -1;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    std::vector<uint64_t> times;
+    uint64_t total_rows = 0;
+    while (total_rows < config.num_repetitions)
+    {
+        uint64_t blockset_id = (rng() % max_blockset) + 1;
+        uint64_t expected_count = blockset_count(blockset_id, entries);
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        if (join_inner(db, blockset_id, expected_count, "Actual") != 0)
+            return -1;
+        auto end = std::chrono::high_resolution_clock::now();
+
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / expected_count);
+        total_rows += expected_count;
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_finalize(stmt);
+
+    report_stats(config, times, report_name);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto config = parse_args(argc, argv);
+
+    std::vector<std::string> pragmas = {"PRAGMA synchronous = NORMAL;", "PRAGMA temp_store = MEMORY;", "PRAGMA journal_mode = WAL;", "PRAGMA cache_size = -64000;", "PRAGMA mmap_size = 64000000;"};
+
+    std::string
+        sql_select_btree = "SELECT ID FROM Block WHERE Hash = ? AND Size = ?;",
+        sql_select_hash = "SELECT ID FROM temp.BlockHash WHERE Hash = ? AND Size = ?;",
+        sql_join_btree = "SELECT Block.ID, Block.Hash, Block.Size FROM Block JOIN BlocksetEntry ON BlocksetEntry.BlockID = Block.ID WHERE BlocksetEntry.BlocksetID = ?;",
+        sql_join_hash = "SELECT BlockHash.ID, BlockHash.Hash, BlockHash.Size FROM BlocksetEntry JOIN temp.BlockHash ON BlockHash.ID = BlocksetEntry.BlockID WHERE BlocksetEntry.BlocksetID = ?;";
+
+    std::vector<std::string> table_queries = {
+        CREATE_BLOCKSET_TABLE,
+        CREATE_BLOCKSETENTRY_TABLE,
+        CREATE_BLOCK_TABLE};
+
+    auto db = setup_database(table_queries, config);
+
+    sqlite3_exec(db, "CREATE INDEX BlockHashSize ON Block(Hash, Size);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetEntryBlocksetID ON BlocksetEntry(BlocksetID);", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "CREATE INDEX BlocksetBlocksetID ON Blockset(ID);", nullptr, nullptr, nullptr);
+
+    std::vector<Entry> entries;
+    std::mt19937 rng(2025'07'08);
+    if (fill(db, rng, entries, config.num_entries) != 0)
+        return -1;
+    sqlite3_close(db);
+
+    sqlite3_open(DBPATH.c_str(), &db);
+    rng.seed(~2025'07'08);
+    for (const auto &pragma : pragmas)
+    {
+        sqlite3_exec(db, pragma.c_str(), nullptr, nullptr, nullptr);
+    }
+
+    // The index lives in process memory, so the table is created in the temp schema to keep it out of the database file.
+    HashIndex index;
+    auto module = hashindex_module();
+    if (!assert_sqlite_return_code(sqlite3_create_module_v2(db, "hashindex", &module, &index, nullptr), db, "Create hashindex module"))
+        return -1;
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "CREATE VIRTUAL TABLE temp.BlockHash USING hashindex;", nullptr, nullptr, nullptr), db, "Create BlockHash table"))
+        return -1;
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    index.ids.reserve(entries.size());
+    index.keys.reserve(entries.size());
+    for (const auto &entry : entries)
+        index.insert(entry.id, {entry.hash, entry.size}, false);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Loaded " << index.keys.size() << " entries into the hash index in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()
+              << " ms." << std::endl;
+
+    // B-tree index baselines, the hash index is left untouched
+    if (measure_insert(db, config, rng, entries, "vtab_insert_btree") != 0)
+        return -1;
+    if (measure_select(db, config, rng, entries, sql_select_btree, "vtab_select_btree") != 0)
+        return -1;
+    if (measure_xor1(db, config, rng, entries, sql_select_btree, "vtab_xor1_btree") != 0)
+        return -1;
+    if (measure_join(db, config, rng, entries, sql_join_btree, "vtab_join_btree") != 0)
+        return -1;
+
+    // Keep the hash index in sync with Block, so the insert cost includes maintaining it
+    if (!assert_sqlite_return_code(sqlite3_exec(db, "CREATE TEMP TRIGGER BlockHashSync AFTER INSERT ON Block BEGIN INSERT INTO BlockHash (Hash, Size, ID) VALUES (new.Hash, new.Size, new.ID); END;", nullptr, nullptr, nullptr), db, "Create sync trigger"))
+        return -1;
+
+    if (measure_insert(db, config, rng, entries, "vtab_insert_synced") != 0)
+        return -1;
+    if (measure_select(db, config, rng, entries, sql_select_hash, "vtab_select_hash") != 0)
+        return -1;
+    if (measure_xor1(db, config, rng, entries, sql_select_hash, "vtab_xor1_hash") != 0)
+        return -1;
+    if (measure_join(db, config, rng, entries, sql_join_hash, "vtab_join_hash") != 0)
+        return -1;
+
+    sqlite3_exec(db, "DROP TRIGGER BlockHashSync;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "DROP TABLE temp.BlockHash;", nullptr, nullptr, nullptr);
+
+    // Always revert journal mode to delete prior to closing, so that others won't be in WAL mode.
+    sqlite3_wal_checkpoint(db, nullptr);
+    sqlite3_exec(db, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+
+    std::vector<std::string> files = {DBPATH, DBPATH + "-shm", DBPATH + "-wal"};
+    for (const auto &f : files)
+    {
+        if (std::filesystem::exists(f))
+            std::filesystem::remove(f);
+    }
+
+    return 0;
+}
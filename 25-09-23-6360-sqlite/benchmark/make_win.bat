@@ -36,7 +36,7 @@ if not exist %LIBS% (
 )
 
 : Define the targets
-set TARGETS=schema1 schema2 schema3 schema4 pragmas parallel batching
+set TARGETS=schema1 schema2 schema3 schema4 pragmas parallel batching sorted vtab sharded pool pcache allocator prealloc pagesize checkpoint tenants coroutine pipeline lockmanager bulkload
 set LINKFLAGS=/MACHINE:X64
 set COMPILEFLAGS=/std:c++20 /EHsc /favor:AMD64 /O2 /openmp
 
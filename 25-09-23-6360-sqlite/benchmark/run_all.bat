@@ -9,6 +9,39 @@ REM Define threads array
 set threads=1 2 4 8 16 32
 REM Define batches array
 set batches=0 1 2 4 8 16 32 64 128 256 512 1024 2048 4096 8192 16384 32768 65536
+REM Define p99 commit latency targets in microseconds for the adaptive batching comparison
+set commit_targets=1000 5000 20000
+REM Define rows per transaction for the checkpointing benchmark
+set checkpoint_batches=1 100
+REM Define connection threads for the coroutine executor
+set coroutine_threads=1 2 4 8
+REM Define per-block hashing costs in nanoseconds and hashing threads for the pipeline emulator
+set hash_costs=0 2000 20000
+set pipeline_threads=1 4 8
+REM Define threads for the lock manager benchmark
+set lock_threads=1 8 16 32
+REM Define sizes for the sorted probing benchmark
+set sorted_sizes=1000000 10000000 100000000
+REM Define sizes for the page size sweep
+set pagesize_sizes=10000000
+REM Define sizes for the bulk-load index ordering benchmark
+set bulkload_sizes=1000000 10000000 100000000
+REM Define median tenant sizes and pool threads for the multi-tenant benchmark
+set tenant_sizes=10000 100000
+set tenant_threads=1 8 32
+REM Define shards array
+set shards=1 2 4 8
+REM Define threading modes array
+set threading_modes=default multithread serialized
+REM Define lookaside settings array
+set lookasides=off 128x512 1200x500
+REM Define the times a long-lived reader holds its snapshot, in milliseconds
+set reader_holds=1000 10000 60000
+REM Define emulated disk profiles, and the subset replayed on them
+set disk_profiles=hdd sd smb
+set disk_sizes=10000 100000
+set disk_threads=1 8
+set disk_batches=0 256
 
 for %%s in (%sizes%) do (
     .\bin\schema1 --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
@@ -16,12 +49,83 @@ for %%s in (%sizes%) do (
     .\bin\schema3 --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
     .\bin\schema4 --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
     .\bin\pragmas --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
+    .\bin\vtab --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
+    .\bin\pcache --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
+    .\bin\allocator --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads 32
+    .\bin\prealloc --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
+    for %%t in (%coroutine_threads%) do (
+        .\bin\coroutine --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t
+    )
+    for %%c in (%hash_costs%) do (
+        for %%t in (%pipeline_threads%) do (
+            .\bin\pipeline --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t --hash-cost-ns %%c
+        )
+    )
+    for %%t in (%lock_threads%) do (
+        .\bin\lockmanager --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t
+    )
+    for %%b in (%checkpoint_batches%) do (
+        .\bin\checkpoint --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-batch %%b
+    )
     for %%t in (%threads%) do (
-        .\bin\parallel --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t
+        for %%m in (%threading_modes%) do (
+            .\bin\parallel --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t --threading-mode %%m
+        )
+        .\bin\parallel --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t --allocator pool --memstatus off
+        for %%l in (%lookasides%) do (
+            .\bin\parallel --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t --lookaside %%l
+        )
+        for %%r in (%reader_holds%) do (
+            .\bin\parallel --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t --reader-hold-ms %%r
+        )
+        .\bin\pool --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t
+    )
+    for %%h in (%shards%) do (
+        for %%t in (%threads%) do (
+            .\bin\sharded --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t --num-shards %%h
+        )
     )
     for %%b in (%batches%) do (
         .\bin\batching --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-batch %%b
     )
+    for %%c in (%commit_targets%) do (
+        .\bin\batching --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --batch-policy compare --commit-target-us %%c
+    )
+)
+
+for %%s in (%sorted_sizes%) do (
+    .\bin\sorted --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
+)
+
+for %%s in (%pagesize_sizes%) do (
+    .\bin\pagesize --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
+)
+
+for %%s in (%bulkload_sizes%) do (
+    .\bin\bulkload --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions%
+)
+
+for %%s in (%tenant_sizes%) do (
+    for %%t in (%tenant_threads%) do (
+        .\bin\tenants --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t
+    )
+)
+
+REM Replay a subset on emulated slow disks, each profile writing to its own reports directory
+for %%p in (%disk_profiles%) do (
+    if not exist disk\%%p mkdir disk\%%p
+    pushd disk\%%p
+    for %%s in (%disk_sizes%) do (
+        ..\..\bin\schema1 --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --disk-profile %%p
+        ..\..\bin\pragmas --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --disk-profile %%p
+        for %%t in (%disk_threads%) do (
+            ..\..\bin\parallel --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-threads %%t --disk-profile %%p
+        )
+        for %%b in (%disk_batches%) do (
+            ..\..\bin\batching --num-entries %%s --num-warmup %warmup% --num-repetitions %repetitions% --num-batch %%b --disk-profile %%p
+        )
+    )
+    popd
 )
 
 REM Build C# project
@@ -6,6 +6,26 @@ repetitions=100000
 sizes=(10000 100000 1000000 10000000)
 threads=(1 2 4 8 16 32)
 batches=(0 1 2 4 8 16 32 64 128 256 512 1024 2048 4096 8192 16384 32768 65536)
+commit_targets=(1000 5000 20000)
+checkpoint_batches=(1 100)
+coroutine_threads=(1 2 4 8)
+hash_costs=(0 2000 20000)
+pipeline_threads=(1 4 8)
+lock_threads=(1 8 16 32)
+sorted_sizes=(1000000 10000000 100000000)
+pagesize_sizes=(10000000)
+bulkload_sizes=(1000000 10000000 100000000)
+tenant_sizes=(10000 100000)
+tenant_threads=(1 8 32)
+shards=(1 2 4 8)
+threading_modes=(default multithread serialized)
+lookasides=(off 128x512 1200x500)
+reader_holds=(1000 10000 60000)
+vfses=(default uring uring_direct)
+disk_profiles=(hdd sd smb)
+disk_sizes=(10000 100000)
+disk_threads=(1 8)
+disk_batches=(0 256)
 
 for size in "${sizes[@]}"; do
     ./bin/schema1 --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
@@ -13,12 +33,86 @@ for size in "${sizes[@]}"; do
     ./bin/schema3 --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
     ./bin/schema4 --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
     ./bin/pragmas --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
+    ./bin/vtab --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
+    ./bin/pcache --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
+    ./bin/allocator --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads 32
+    ./bin/prealloc --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
+    for thread in "${coroutine_threads[@]}"; do
+        ./bin/coroutine --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread
+    done
+    for cost in "${hash_costs[@]}"; do
+        for thread in "${pipeline_threads[@]}"; do
+            ./bin/pipeline --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread --hash-cost-ns $cost
+        done
+    done
+    for thread in "${lock_threads[@]}"; do
+        ./bin/lockmanager --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread
+    done
+    for batch in "${checkpoint_batches[@]}"; do
+        ./bin/checkpoint --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-batch $batch
+    done
     for thread in "${threads[@]}"; do
-        ./bin/parallel --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread
+        for mode in "${threading_modes[@]}"; do
+            ./bin/parallel --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread --threading-mode $mode
+        done
+        ./bin/parallel --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread --allocator pool --memstatus off
+        for lookaside in "${lookasides[@]}"; do
+            ./bin/parallel --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread --lookaside $lookaside
+        done
+        ./bin/parallel --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-processes $thread
+        for hold in "${reader_holds[@]}"; do
+            ./bin/parallel --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread --reader-hold-ms $hold
+        done
+        ./bin/pool --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread
+    done
+    for shard in "${shards[@]}"; do
+        for thread in "${threads[@]}"; do
+            ./bin/sharded --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread --num-shards $shard
+        done
     done
     for batch in "${batches[@]}"; do
-        ./bin/batching --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-batch $batch
+        for vfs in "${vfses[@]}"; do
+            ./bin/batching --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-batch $batch --vfs $vfs
+        done
+    done
+    for target in "${commit_targets[@]}"; do
+        ./bin/batching --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --batch-policy compare --commit-target-us $target
+    done
+done
+
+for size in "${sorted_sizes[@]}"; do
+    ./bin/sorted --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
+done
+
+for size in "${pagesize_sizes[@]}"; do
+    ./bin/pagesize --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
+done
+
+for size in "${bulkload_sizes[@]}"; do
+    ./bin/bulkload --num-entries $size --num-warmup $warmup --num-repetitions $repetitions
+done
+
+for size in "${tenant_sizes[@]}"; do
+    for thread in "${tenant_threads[@]}"; do
+        ./bin/tenants --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread
+    done
+done
+
+# Replay a subset on emulated slow disks, each profile writing to its own reports directory
+for profile in "${disk_profiles[@]}"; do
+    mkdir -p disk/$profile
+    pushd disk/$profile > /dev/null
+    for size in "${disk_sizes[@]}"; do
+        ../../bin/schema1 --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --disk-profile $profile
+        ../../bin/pragmas --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --disk-profile $profile
+        for thread in "${disk_threads[@]}"; do
+            ../../bin/parallel --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-threads $thread --disk-profile $profile
+        done
+        for batch in "${disk_batches[@]}"; do
+            ../../bin/batching --num-entries $size --num-warmup $warmup --num-repetitions $repetitions --num-batch $batch --disk-profile $profile
+        done
     done
+    popd > /dev/null
 done
 
 dotnet build -c Release csharp